@@ -0,0 +1,214 @@
+// Headless shared-arena runner: many AI snakes in one arena, their
+// decisions spread over all cores, and a fingerprint of the final state.
+//
+//   snake_arena [--snakes N] [--apples A] [--threads T] [--seed S]
+//               [--arena A] [--obstacles O] [--ticks M] [--policy greedy|cautious]
+//
+// Every tick resolves in snake order on one thread, so the same options
+// print the same hash for any --threads.
+
+#include "arena_simulation.h"
+#include "task_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+enum class ArenaPolicy {
+    GREEDY,
+    CAUTIOUS
+};
+
+struct ArenaOptions {
+    int snakes = 200;
+    int apples = 100;
+    unsigned int threads = 0;
+    std::uint64_t seed = 1;
+    int arenaSize = 100;
+    int obstacles = 375;  // Default arena density
+    unsigned long long ticks = 10000;
+    ArenaPolicy policy = ArenaPolicy::GREEDY;
+};
+
+static const Direction directions[4] = { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT };
+
+static int DistanceToNearestApple(const ArenaSimulation& arena, const Cell& cell) {
+    int best = -1;
+    for (const auto& apple : arena.GetApples()) {
+        int distance = std::abs(apple.x - cell.x) + std::abs(apple.z - cell.z);
+        if (best < 0 || distance < best) {
+            best = distance;
+        }
+    }
+    return best;
+}
+
+// Free cells reachable from start, counting stops at limit. Scratch is per
+// thread, since policies run on every pool worker at once.
+static int ReachableCells(const ArenaSimulation& arena, const Cell& start, int limit) {
+    static thread_local std::vector<unsigned int> visited;
+    static thread_local std::vector<int> queue;
+    static thread_local unsigned int stamp = 0;
+
+    const OccupancyGrid& grid = arena.GetGrid();
+    if (visited.size() != static_cast<std::size_t>(grid.CellCount())) {
+        visited.assign(grid.CellCount(), 0);
+        stamp = 0;
+    }
+    stamp++;
+
+    queue.clear();
+    queue.push_back(grid.IndexOf(start));
+    visited[queue.back()] = stamp;
+
+    const int steps[4] = { -grid.GetWidth(), grid.GetWidth(), -1, 1 };
+    for (std::size_t next = 0; next < queue.size() && static_cast<int>(queue.size()) < limit; ++next) {
+        for (int step : steps) {
+            int neighbor = queue[next] + step;
+            if (visited[neighbor] != stamp && !grid.IsBlocked(neighbor)) {
+                visited[neighbor] = stamp;
+                queue.push_back(neighbor);
+            }
+        }
+    }
+    return static_cast<int>(queue.size());
+}
+
+// Steps to the free neighbor closest to the nearest apple, picking at
+// random among equals. Cautious also skips moves into pockets too small
+// for the body while any other move is open.
+static Direction ChooseDirection(const ArenaSimulation& arena, int index, RandomStream& random, bool cautious) {
+    const ArenaSnake& snake = arena.GetSnake(index);
+    const Cell head = snake.body.Head();
+    const int length = static_cast<int>(snake.body.Size());
+
+    Direction best = snake.direction;
+    int bestScore = -1;
+    int ties = 0;
+
+    for (Direction direction : directions) {
+        Cell next = Neighbor(head, direction);
+        if (arena.IsBlocked(next)) continue;
+
+        int distance = DistanceToNearestApple(arena, next);
+        int score = 1 << 20;
+        if (distance >= 0) {
+            score -= distance;
+        }
+        if (cautious && ReachableCells(arena, next, length * 2 + 8) <= length) {
+            score -= 1 << 19;
+        }
+
+        // Reservoir pick among equal scores keeps the choice uniform
+        if (score > bestScore) {
+            best = direction;
+            bestScore = score;
+            ties = 1;
+        } else if (score == bestScore && random.NextBelow(static_cast<std::uint32_t>(++ties)) == 0) {
+            best = direction;
+        }
+    }
+
+    return best;
+}
+
+static bool ParseOptions(int argc, char** argv, ArenaOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--snakes") == 0) options.snakes = std::atoi(value);
+        else if (std::strcmp(arg, "--apples") == 0) options.apples = std::atoi(value);
+        else if (std::strcmp(arg, "--threads") == 0) options.threads = static_cast<unsigned int>(std::atoi(value));
+        else if (std::strcmp(arg, "--seed") == 0) options.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--arena") == 0) options.arenaSize = std::atoi(value);
+        else if (std::strcmp(arg, "--obstacles") == 0) options.obstacles = std::atoi(value);
+        else if (std::strcmp(arg, "--ticks") == 0) options.ticks = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--policy") == 0 && std::strcmp(value, "greedy") == 0) options.policy = ArenaPolicy::GREEDY;
+        else if (std::strcmp(arg, "--policy") == 0 && std::strcmp(value, "cautious") == 0) options.policy = ArenaPolicy::CAUTIOUS;
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    return options.snakes > 0 && options.apples >= 0 && options.arenaSize > 1;
+}
+
+int main(int argc, char** argv) {
+    ArenaOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: snake_arena [--snakes N] [--apples A] [--threads T] [--seed S] [--arena A] [--obstacles O] [--ticks M] [--policy greedy|cautious]\n");
+        return 1;
+    }
+
+    TRACE_THREAD_NAME("Main");
+
+    ArenaConfig config;
+    config.layout.arenaSize = options.arenaSize;
+    config.layout.maxObstacles = options.obstacles;
+    config.layout.seed = options.seed;
+    config.snakeCount = options.snakes;
+    config.appleCount = options.apples;
+
+    ArenaSimulation arena(config);
+    arena.Initialize();
+    std::printf("%d of %d snakes placed, %zu apples\n", arena.GetAliveCount(), options.snakes, arena.GetApples().size());
+
+    const bool cautious = options.policy == ArenaPolicy::CAUTIOUS;
+    ArenaSimulation::Policy policy = [cautious](const ArenaSimulation& arena, int snake, RandomStream& random) {
+        return ChooseDirection(arena, snake, random, cautious);
+    };
+
+    unsigned long long moves = 0, eaten = 0, deaths = 0;
+    double decideSeconds = 0.0, stepSeconds = 0.0;
+    unsigned int threadCount;
+    {
+        TaskPool pool(options.threads);
+        threadCount = pool.GetThreadCount();
+
+        while (!arena.IsOver() && arena.GetTick() < options.ticks) {
+            auto start = std::chrono::steady_clock::now();
+            arena.Decide(policy, &pool);
+            auto decided = std::chrono::steady_clock::now();
+            ArenaTickStats stats = arena.Step();
+            auto stepped = std::chrono::steady_clock::now();
+
+            decideSeconds += std::chrono::duration<double>(decided - start).count();
+            stepSeconds += std::chrono::duration<double>(stepped - decided).count();
+            moves += stats.moved;
+            eaten += stats.ate;
+            deaths += stats.died;
+        }
+    }
+
+    int bestScore = 0;
+    for (int i = 0; i < arena.GetSnakeCount(); ++i) {
+        bestScore = std::max(bestScore, arena.GetSnake(i).score);
+    }
+
+    double seconds = decideSeconds + stepSeconds;
+    std::printf("%llu ticks on %u threads in %.3f s (decide %.3f s, resolve %.3f s)\n",
+                arena.GetTick(), threadCount, seconds, decideSeconds, stepSeconds);
+    std::printf("alive    %d\n", arena.GetAliveCount());
+    std::printf("deaths   %llu\n", deaths);
+    std::printf("eaten    %llu\n", eaten);
+    std::printf("best     %d\n", bestScore);
+    std::printf("ticks/s  %.0f\n", arena.GetTick() / seconds);
+    std::printf("moves/s  %.0f\n", moves / seconds);
+    std::printf("hash     %016llx\n", static_cast<unsigned long long>(arena.Hash()));
+
+    // Only written in SNAKE_TRACING builds
+    TRACE_DUMP("trace.json");
+
+    return 0;
+}
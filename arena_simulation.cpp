@@ -0,0 +1,356 @@
+#include "arena_simulation.h"
+#include "task_pool.h"
+#include "trace.h"
+#include <algorithm>
+
+// Snakes handed to one pool task; small enough for idle workers to steal
+// from a slow batch, big enough that a task is worth queueing
+static const int snakesPerTask = 16;
+
+// Tries at finding room for a snake before it sits the game out
+static const int placementAttempts = 100;
+
+// Seeds of the arena's own streams, kept apart from the layout's draws.
+// Odd multipliers separate streams and salts before SplitMix64 spreads the bits.
+static std::uint64_t ArenaSeed(std::uint64_t seed, std::uint64_t stream, std::uint64_t salt) {
+    return seed ^ (stream * 0x9E3779B97F4A7C15ull) ^ ((salt + 1) * 0xD6E8FEB86659FD93ull);
+}
+
+// Policies search the whole arena by grid index, so the layout is always dense
+static SimConfig DenseLayout(SimConfig layout) {
+    layout.chunked = false;
+    return layout;
+}
+
+ArenaSimulation::ArenaSimulation(const ArenaConfig& config) :
+    config(config),
+    layout(DenseLayout(config.layout)),
+    tick(0),
+    aliveCount(0),
+    rng(ArenaSeed(config.layout.seed, config.layout.stream, 0)) {
+    this->config.layout.chunked = false;
+    snakes.resize(static_cast<std::size_t>(std::max(config.snakeCount, 0)));
+    decisions.resize(snakes.size(), Direction::RIGHT);
+    nextHeads.resize(snakes.size());
+    dying.resize(snakes.size());
+}
+
+void ArenaSimulation::Initialize() {
+    TRACE_ZONE("ArenaSimulation::Initialize");
+
+    layout.Initialize();
+    grid = layout.GetGrid();
+    grid.ClearSnake();
+
+    freeCells.Resize(grid.CellCount());
+    appleSlot.assign(grid.CellCount(), -1);
+    claimTick.assign(grid.CellCount(), 0);
+    claimCount.assign(grid.CellCount(), 0);
+
+    const int arenaSize = config.layout.arenaSize;
+    for (int z = -arenaSize; z <= arenaSize; ++z) {
+        for (int x = -arenaSize; x <= arenaSize; ++x) {
+            Cell cell{x, z};
+            freeCells.SetEligible(grid.IndexOf(cell), layout.IsSpawnArea(cell));
+        }
+    }
+
+    Reset();
+}
+
+void ArenaSimulation::Reset() {
+    grid.ClearSnake();
+    freeCells.Clear();
+    for (const auto& apple : apples) {
+        appleSlot[grid.IndexOf(apple)] = -1;
+    }
+    apples.clear();
+    tick = 0;
+    std::fill(claimTick.begin(), claimTick.end(), 0);  // Stale claims would match the restarted ticks
+
+    rng = RandomStream(ArenaSeed(config.layout.seed, config.layout.stream, 0));
+    PlaceSnakes();
+
+    const int arenaSize = config.layout.arenaSize;
+    for (int z = -arenaSize; z <= arenaSize; ++z) {
+        for (int x = -arenaSize; x <= arenaSize; ++x) {
+            Cell cell{x, z};
+            if (!grid.IsSnake(cell)) {
+                freeCells.Add(grid.IndexOf(cell));
+            }
+        }
+    }
+
+    for (int i = 0; i < config.appleCount; ++i) {
+        SpawnApple();
+    }
+}
+
+void ArenaSimulation::PlaceSnakes() {
+    const int arenaSize = config.layout.arenaSize;
+    aliveCount = 0;
+
+    for (std::size_t i = 0; i < snakes.size(); ++i) {
+        ArenaSnake& snake = snakes[i];
+        snake.body.Clear();
+        snake.direction = Direction::RIGHT;
+        snake.nextDirection = Direction::RIGHT;
+        snake.alive = false;
+        snake.shouldGrow = false;
+        snake.score = 0;
+        snake.diedAt = 0;
+        snake.random = RandomStream(ArenaSeed(config.layout.seed, config.layout.stream, i + 1));
+
+        // Three cells in a row heading right, with the cell ahead free too
+        for (int attempt = 0; attempt < placementAttempts && !snake.alive; ++attempt) {
+            Cell head{static_cast<int>(rng.NextBelow(static_cast<std::uint32_t>(arenaSize * 2 - 2))) - arenaSize + 2,
+                      static_cast<int>(rng.NextBelow(static_cast<std::uint32_t>(arenaSize * 2 + 1))) - arenaSize};
+
+            bool room = true;
+            for (int dx = -2; dx <= 1; ++dx) {
+                room = room && !grid.IsBlocked(Cell{head.x + dx, head.z});
+            }
+            if (!room) continue;
+
+            for (int dx = -2; dx <= 0; ++dx) {
+                snake.body.PushHead(Cell{head.x + dx, head.z});
+                grid.SetSnake(Cell{head.x + dx, head.z});
+            }
+            snake.alive = true;
+            aliveCount++;
+        }
+    }
+}
+
+void ArenaSimulation::SpawnApple() {
+    if (freeCells.Empty()) return;
+
+    int index = freeCells.At(static_cast<int>(rng.NextBelow(static_cast<std::uint32_t>(freeCells.Size()))));
+    freeCells.Remove(index);
+    appleSlot[index] = static_cast<int>(apples.size());
+    apples.push_back(grid.CellAt(index));
+}
+
+void ArenaSimulation::RemoveApple(int slot) {
+    appleSlot[grid.IndexOf(apples[slot])] = -1;
+    if (slot != static_cast<int>(apples.size()) - 1) {
+        apples[slot] = apples.back();
+        appleSlot[grid.IndexOf(apples[slot])] = slot;
+    }
+    apples.pop_back();
+}
+
+void ArenaSimulation::OccupyCell(const Cell& cell) {
+    grid.SetSnake(cell);
+    freeCells.Remove(grid.IndexOf(cell));
+}
+
+void ArenaSimulation::VacateCell(const Cell& cell) {
+    grid.ClearSnake(cell);
+    freeCells.Add(grid.IndexOf(cell));
+}
+
+void ArenaSimulation::Decide(const Policy& policy, TaskPool* pool) {
+    TRACE_ZONE("ArenaSimulation::Decide");
+
+    const int count = GetSnakeCount();
+    auto decideRange = [this, &policy](int first, int last) {
+        for (int i = first; i < last; ++i) {
+            if (snakes[i].alive) {
+                decisions[i] = policy(*this, i, snakes[i].random);
+            }
+        }
+    };
+
+    if (pool) {
+        for (int first = 0; first < count; first += snakesPerTask) {
+            int last = std::min(first + snakesPerTask, count);
+            pool->Submit([&decideRange, first, last]() {
+                decideRange(first, last);
+            });
+        }
+        pool->Wait();
+    } else {
+        decideRange(0, count);
+    }
+
+    // Applied only once every policy has seen the same arena
+    for (int i = 0; i < count; ++i) {
+        if (snakes[i].alive) {
+            SetDirection(i, decisions[i]);
+        }
+    }
+}
+
+void ArenaSimulation::SetDirection(int snake, Direction dir) {
+    ArenaSnake& target = snakes[snake];
+    if ((dir == Direction::LEFT && target.direction == Direction::RIGHT) ||
+        (dir == Direction::RIGHT && target.direction == Direction::LEFT) ||
+        (dir == Direction::UP && target.direction == Direction::DOWN) ||
+        (dir == Direction::DOWN && target.direction == Direction::UP)) {
+        return;
+    }
+    target.nextDirection = dir;
+}
+
+ArenaTickStats ArenaSimulation::Step() {
+    TRACE_ZONE("ArenaSimulation::Step");
+
+    ArenaTickStats stats = {0, 0, 0};
+    if (IsOver()) return stats;
+    tick++;
+
+    const int count = GetSnakeCount();
+
+    // Tails move out, then every head stakes its claim
+    for (int i = 0; i < count; ++i) {
+        ArenaSnake& snake = snakes[i];
+        if (!snake.alive) continue;
+
+        snake.direction = snake.nextDirection;
+        nextHeads[i] = Neighbor(snake.body.Head(), snake.direction);
+        if (!snake.shouldGrow) {
+            VacateCell(snake.body.Tail());
+        }
+
+        int index = grid.IndexOf(nextHeads[i]);
+        if (claimTick[index] != tick) {
+            claimTick[index] = tick;
+            claimCount[index] = 0;
+        }
+        claimCount[index]++;
+    }
+
+    // Every death is settled before anything moves in, so snake order
+    // cannot decide who survives
+    for (int i = 0; i < count; ++i) {
+        if (!snakes[i].alive) continue;
+        int index = grid.IndexOf(nextHeads[i]);
+        dying[i] = (grid.IsBlocked(index) || claimCount[index] > 1) ? 1 : 0;
+    }
+
+    int eaten = 0;
+    for (int i = 0; i < count; ++i) {
+        ArenaSnake& snake = snakes[i];
+        if (!snake.alive) continue;
+
+        // The tail cell was already handed back above
+        if (snake.shouldGrow) {
+            snake.shouldGrow = false;
+        } else {
+            snake.body.PopTail();
+        }
+
+        if (dying[i]) {
+            for (const auto& segment : snake.body) {
+                VacateCell(segment);
+            }
+            snake.body.Clear();
+            snake.alive = false;
+            snake.diedAt = tick;
+            aliveCount--;
+            stats.died++;
+            continue;
+        }
+
+        const Cell head = nextHeads[i];
+        snake.body.PushHead(head);
+        OccupyCell(head);
+        stats.moved++;
+
+        int slot = appleSlot[grid.IndexOf(head)];
+        if (slot >= 0) {
+            RemoveApple(slot);
+            snake.shouldGrow = true;
+            snake.score += 10;
+            stats.ate++;
+            eaten++;
+        }
+    }
+
+    // New apples only once every snake has moved, in snake order
+    for (int i = 0; i < eaten; ++i) {
+        SpawnApple();
+    }
+
+    return stats;
+}
+
+int ArenaSimulation::GetSnakeCount() const {
+    return static_cast<int>(snakes.size());
+}
+
+const ArenaSnake& ArenaSimulation::GetSnake(int snake) const {
+    return snakes[snake];
+}
+
+int ArenaSimulation::GetAliveCount() const {
+    return aliveCount;
+}
+
+const std::vector<Cell>& ArenaSimulation::GetApples() const {
+    return apples;
+}
+
+bool ArenaSimulation::IsApple(const Cell& cell) const {
+    return appleSlot[grid.IndexOf(cell)] >= 0;
+}
+
+bool ArenaSimulation::IsBlocked(const Cell& cell) const {
+    // Anything past the border is as deadly as the border itself
+    const int arenaSize = config.layout.arenaSize;
+    if (cell.x < -arenaSize - 1 || cell.x > arenaSize + 1 ||
+        cell.z < -arenaSize - 1 || cell.z > arenaSize + 1) {
+        return true;
+    }
+    return grid.IsBlocked(cell);
+}
+
+const OccupancyGrid& ArenaSimulation::GetGrid() const {
+    return grid;
+}
+
+const std::vector<Obstacle>& ArenaSimulation::GetObstacles() const {
+    return layout.GetObstacles();
+}
+
+unsigned long long ArenaSimulation::GetTick() const {
+    return tick;
+}
+
+bool ArenaSimulation::IsOver() const {
+    return aliveCount == 0;
+}
+
+int ArenaSimulation::GetArenaSize() const {
+    return config.layout.arenaSize;
+}
+
+const ArenaConfig& ArenaSimulation::GetConfig() const {
+    return config;
+}
+
+std::uint64_t ArenaSimulation::Hash() const {
+    std::uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](std::uint64_t value) {
+        for (int byte = 0; byte < 8; ++byte) {
+            hash = (hash ^ ((value >> (byte * 8)) & 0xff)) * 1099511628211ull;
+        }
+    };
+
+    mix(tick);
+    for (const auto& snake : snakes) {
+        mix(static_cast<std::uint64_t>(snake.alive) | static_cast<std::uint64_t>(snake.direction) << 8 |
+            static_cast<std::uint64_t>(static_cast<std::uint32_t>(snake.score)) << 16);
+        mix(snake.body.Size());
+        for (const auto& segment : snake.body) {
+            mix(static_cast<std::uint64_t>(static_cast<std::uint32_t>(segment.x)) << 32 |
+                static_cast<std::uint32_t>(segment.z));
+        }
+    }
+    for (const auto& apple : apples) {
+        mix(static_cast<std::uint64_t>(static_cast<std::uint32_t>(apple.x)) << 32 |
+            static_cast<std::uint32_t>(apple.z));
+    }
+    return hash;
+}
@@ -0,0 +1,107 @@
+#ifndef ARENA_SIMULATION_H
+#define ARENA_SIMULATION_H
+
+#include "simulation.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class TaskPool;
+
+struct ArenaConfig {
+    SimConfig layout;     // Arena size, obstacles, seed and stream; always a dense arena
+    int snakeCount = 100;
+    int appleCount = 50;  // Kept on the board; an eaten apple respawns the same tick
+};
+
+// One snake of a shared arena
+struct ArenaSnake {
+    SnakeBody body;  // Head first, empty once dead
+    Direction direction;
+    Direction nextDirection;
+    bool alive;
+    bool shouldGrow;
+    int score;
+    unsigned long long diedAt;  // Tick of death
+    RandomStream random;        // For its policy; only ever touched by the snake's own decision
+};
+
+// What one tick did
+struct ArenaTickStats {
+    int moved;
+    int ate;
+    int died;
+};
+
+// Many snakes in one arena. A tick runs in two phases: Decide asks every
+// living snake's policy for a direction, spread over a TaskPool, then Step
+// resolves all the moves at once on the calling thread in snake order.
+// Policies only read the arena and their snake's own random stream, so a
+// game plays out the same on any number of threads.
+//
+// Step resolves every move against the state at the start of the tick:
+//  - tails of snakes that are not growing move out first, so following any
+//    tail is safe
+//  - a head on a wall, obstacle or remaining body cell dies; heads swapping
+//    places hit each other's neck
+//  - heads meeting on one cell all die, so an apple never has two eaters
+//  - dead snakes leave the board at the end of the tick
+//  - eaten apples respawn in snake order from the arena's own stream
+class ArenaSimulation {
+public:
+    // Direction for `snake`, from the arena as it stood when Decide began
+    using Policy = std::function<Direction(const ArenaSimulation& arena, int snake, RandomStream& random)>;
+
+    explicit ArenaSimulation(const ArenaConfig& config = ArenaConfig());
+
+    void Initialize();  // New obstacle layout, snakes and apples; needed before the first tick
+    void Reset();       // New snakes and apples on the current layout
+
+    void Decide(const Policy& policy, TaskPool* pool = nullptr);  // Runs on the calling thread without a pool
+    void SetDirection(int snake, Direction dir);                  // Same 180-degree rule as Simulation
+    ArenaTickStats Step();
+
+    int GetSnakeCount() const;
+    const ArenaSnake& GetSnake(int snake) const;
+    int GetAliveCount() const;
+    const std::vector<Cell>& GetApples() const;
+    bool IsApple(const Cell& cell) const;    // Cell in the arena or on its border
+    bool IsBlocked(const Cell& cell) const;  // Wall, obstacle or any body
+    const OccupancyGrid& GetGrid() const;
+    const std::vector<Obstacle>& GetObstacles() const;
+    unsigned long long GetTick() const;
+    bool IsOver() const;  // Every snake is dead
+    int GetArenaSize() const;
+    const ArenaConfig& GetConfig() const;
+
+    // FNV-1a over the tick, every snake and the apples, for comparing runs
+    std::uint64_t Hash() const;
+
+private:
+    void PlaceSnakes();
+    void SpawnApple();
+    void RemoveApple(int slot);
+    void OccupyCell(const Cell& cell);
+    void VacateCell(const Cell& cell);
+
+    ArenaConfig config;
+    Simulation layout;         // Generates the obstacles and apple spawn area
+    OccupancyGrid grid;        // Layout plus every snake
+    FreeCellSet freeCells;     // Spawn area minus bodies and apples
+    std::vector<ArenaSnake> snakes;
+    std::vector<Cell> apples;
+    std::vector<int> appleSlot;  // Per grid cell: index into apples, -1 if none
+    std::vector<Direction> decisions;
+
+    // Head claims of the tick being resolved, per grid cell
+    std::vector<unsigned long long> claimTick;
+    std::vector<int> claimCount;
+    std::vector<Cell> nextHeads;
+    std::vector<std::uint8_t> dying;
+
+    unsigned long long tick;
+    int aliveCount;
+    RandomStream rng;  // Snake placement and apple spawns
+};
+
+#endif // ARENA_SIMULATION_H
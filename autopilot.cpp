@@ -0,0 +1,170 @@
+#include "autopilot.h"
+#include "trace.h"
+#include <algorithm>
+
+Autopilot::Autopilot() :
+    routeApple{0, 0},
+    expectedHead(-1),
+    stamp(0),
+    decisions(0),
+    searches(0) {
+}
+
+void Autopilot::Reset() {
+    route.clear();
+    expectedHead = -1;
+}
+
+Direction Autopilot::Decide(const Simulation& sim) {
+    TRACE_ZONE("Autopilot::Decide");
+    const OccupancyGrid& grid = sim.GetGrid();
+    decisions++;
+
+    if (!RouteStillValid(sim)) {
+        route.clear();
+        if (sim.HasApple()) {
+            searches++;
+            FindRoute(sim);
+        }
+    }
+
+    if (route.empty()) {
+        expectedHead = -1;
+        return Escape(sim);
+    }
+
+    int head = grid.IndexOf(sim.GetHead());
+    int next = route.back();
+    route.pop_back();
+    expectedHead = next;
+    return StepDirection(grid, head, next);
+}
+
+unsigned long long Autopilot::GetDecisionCount() const {
+    return decisions;
+}
+
+unsigned long long Autopilot::GetSearchCount() const {
+    return searches;
+}
+
+bool Autopilot::RouteStillValid(const Simulation& sim) const {
+    if (route.empty() || !sim.HasApple()) return false;
+
+    const OccupancyGrid& grid = sim.GetGrid();
+
+    // Apple eaten or respawned, or the snake went somewhere else (reset, manual turn)
+    if (sim.GetApple() != routeApple) return false;
+    if (grid.IndexOf(sim.GetHead()) != expectedHead) return false;
+
+    return !grid.IsBlocked(route.back());
+}
+
+void Autopilot::BeginSearch(const OccupancyGrid& grid) {
+    if (static_cast<int>(visited.size()) != grid.CellCount()) {
+        visited.assign(grid.CellCount(), 0);
+        parent.assign(grid.CellCount(), -1);
+        queue.resize(grid.CellCount());
+        stamp = 0;
+    }
+
+    // Stamp wrapped around - old marks could look current again
+    if (++stamp == 0) {
+        std::fill(visited.begin(), visited.end(), 0);
+        stamp = 1;
+    }
+}
+
+bool Autopilot::FindRoute(const Simulation& sim) {
+    const OccupancyGrid& grid = sim.GetGrid();
+    BeginSearch(grid);
+
+    const int start = grid.IndexOf(sim.GetHead());
+    const int goal = grid.IndexOf(sim.GetApple());
+    const int steps[4] = { -grid.GetWidth(), grid.GetWidth(), -1, 1 };
+
+    // The border is static, so neighbors of any queued cell stay inside the grid
+    int head = 0;
+    int tail = 0;
+    queue[tail++] = start;
+    visited[start] = stamp;
+
+    while (head < tail) {
+        int current = queue[head++];
+
+        if (current == goal) {
+            // Walk back to the start; the route ends up apple first, next step last
+            for (int cell = goal; cell != start; cell = parent[cell]) {
+                route.push_back(cell);
+            }
+            routeApple = sim.GetApple();
+            return true;
+        }
+
+        for (int step : steps) {
+            int next = current + step;
+            if (visited[next] == stamp || grid.IsBlocked(next)) continue;
+
+            visited[next] = stamp;
+            parent[next] = current;
+            queue[tail++] = next;
+        }
+    }
+
+    return false;
+}
+
+int Autopilot::CountReachable(const OccupancyGrid& grid, int start) {
+    BeginSearch(grid);
+
+    const int steps[4] = { -grid.GetWidth(), grid.GetWidth(), -1, 1 };
+
+    int head = 0;
+    int tail = 0;
+    queue[tail++] = start;
+    visited[start] = stamp;
+
+    while (head < tail) {
+        int current = queue[head++];
+        for (int step : steps) {
+            int next = current + step;
+            if (visited[next] == stamp || grid.IsBlocked(next)) continue;
+
+            visited[next] = stamp;
+            queue[tail++] = next;
+        }
+    }
+
+    return tail;
+}
+
+Direction Autopilot::Escape(const Simulation& sim) {
+    // No route to the apple - stall in the neighbor with the most room left
+    const OccupancyGrid& grid = sim.GetGrid();
+    const Direction directions[4] = { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT };
+    const Cell head = sim.GetHead();
+
+    Direction best = sim.GetDirection();
+    int bestRoom = -1;
+
+    for (Direction direction : directions) {
+        Cell next = Neighbor(head, direction);
+        if (grid.IsBlocked(next)) continue;
+
+        int room = CountReachable(grid, grid.IndexOf(next));
+        if (room > bestRoom) {
+            best = direction;
+            bestRoom = room;
+        }
+    }
+
+    return best;
+}
+
+Direction Autopilot::StepDirection(const OccupancyGrid& grid, int from, int to) const {
+    int step = to - from;
+    if (step == -grid.GetWidth()) return Direction::UP;
+    if (step == grid.GetWidth()) return Direction::DOWN;
+    if (step == -1) return Direction::LEFT;
+    return Direction::RIGHT;
+}
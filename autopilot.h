@@ -0,0 +1,45 @@
+#ifndef AUTOPILOT_H
+#define AUTOPILOT_H
+
+#include "simulation.h"
+#include <vector>
+
+// Grid pathfinder that steers the snake to the apple. A breadth-first
+// search over the occupancy grid finds the shortest route around walls,
+// obstacles and the body; the route is then followed tick by tick and only
+// searched again when the apple moves or the snake leaves the route.
+// Nothing new can block a cached route meanwhile: the layout is static and
+// the body only grows into cells the head has already walked.
+class Autopilot {
+public:
+    Autopilot();
+
+    void Reset();  // Forget the cached route, e.g. after Simulation::Reset
+    Direction Decide(const Simulation& sim);
+
+    unsigned long long GetDecisionCount() const;
+    unsigned long long GetSearchCount() const;  // Decisions that needed a fresh search
+
+private:
+    bool RouteStillValid(const Simulation& sim) const;
+    bool FindRoute(const Simulation& sim);
+    Direction Escape(const Simulation& sim);
+    int CountReachable(const OccupancyGrid& grid, int start);
+    void BeginSearch(const OccupancyGrid& grid);
+    Direction StepDirection(const OccupancyGrid& grid, int from, int to) const;
+
+    std::vector<int> route;  // Grid indices, apple first, next step last
+    Cell routeApple;
+    int expectedHead;        // Where the head should be if the last step was taken
+
+    // Search scratch, kept between calls so decisions never allocate
+    std::vector<int> parent;
+    std::vector<unsigned int> visited;  // Stamp per cell, bumped instead of clearing
+    std::vector<int> queue;
+    unsigned int stamp;
+
+    unsigned long long decisions;
+    unsigned long long searches;
+};
+
+#endif // AUTOPILOT_H
@@ -0,0 +1,239 @@
+// Headless batch runner: plays many independent seeded games across all
+// cores and reports aggregate statistics and throughput.
+//
+//   snake_batch [--games N] [--threads T] [--seed S] [--arena A]
+//               [--obstacles O] [--max-ticks M] [--policy greedy|autopilot|cycle]
+//               [--record FILE] [--world dense|chunked]
+//
+// Game i plays jump-ahead stream i of --seed, so results do not depend on
+// the thread count. --record writes a replay of the first game. A chunked
+// world generates the arena lazily, for arenas too big to hold whole; the
+// searching policies need the dense grid, so it only runs greedy.
+
+#include "simulation.h"
+#include "autopilot.h"
+#include "hamiltonian_solver.h"
+#include "replay.h"
+#include "task_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct GameResult {
+    int score;
+    int length;
+    unsigned long long ticks;
+    bool won;
+    unsigned long long searches;  // Autopilot only
+};
+
+enum class Policy {
+    GREEDY,
+    AUTOPILOT,
+    CYCLE
+};
+
+struct BatchOptions {
+    int games = 10000;
+    unsigned int threads = 0;
+    std::uint64_t seed = 1;
+    int arenaSize = 20;
+    int obstacles = 15;
+    unsigned long long maxTicks = 100000;
+    int gamesPerTask = 16;
+    Policy policy = Policy::GREEDY;
+    const char* recordPath = nullptr;
+    bool chunked = false;
+};
+
+// Steps to the free neighbor closest to the apple; keeps going straight when boxed in.
+// The neck counts as blocked, so the 180 degree turn is never picked.
+static Direction GreedyPolicy(const Simulation& sim) {
+    const Direction directions[4] = { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT };
+    const Cell head = sim.GetHead();
+    const Cell apple = sim.GetApple();
+
+    Direction best = sim.GetDirection();
+    int bestDistance = -1;
+
+    for (Direction direction : directions) {
+        Cell next = Neighbor(head, direction);
+        if (sim.IsBlocked(next)) continue;
+
+        int distance = std::abs(apple.x - next.x) + std::abs(apple.z - next.z);
+        if (bestDistance < 0 || distance < bestDistance) {
+            best = direction;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
+
+static void PlayGames(const BatchOptions& options, const std::vector<RandomStream>& streams,
+                      int first, int count, std::vector<GameResult>& results) {
+    SimConfig config;
+    config.arenaSize = options.arenaSize;
+    config.maxObstacles = options.obstacles;
+    config.chunked = options.chunked;
+
+    // One simulation per task, reseeded for each game to avoid reallocating
+    Simulation sim(config);
+    Autopilot autopilot;
+    HamiltonianSolver solver;
+    for (int game = first; game < first + count; ++game) {
+        TRACE_ZONE("PlayGame");
+        sim.Seed(options.seed, static_cast<std::uint64_t>(game), streams[game]);
+        sim.Initialize();
+        autopilot.Reset();
+        solver.Reset();
+        unsigned long long searchesBefore = autopilot.GetSearchCount();
+
+        ReplayWriter recorder;
+        if (game == 0 && options.recordPath && !recorder.Open(options.recordPath, sim)) {
+            std::fprintf(stderr, "cannot write %s\n", options.recordPath);
+        }
+
+        while (!sim.IsGameOver() && sim.GetTick() < options.maxTicks) {
+            if (options.policy == Policy::AUTOPILOT) {
+                sim.Step(autopilot.Decide(sim));
+            } else if (options.policy == Policy::CYCLE) {
+                sim.Step(solver.Decide(sim));
+            } else {
+                sim.Step(GreedyPolicy(sim));
+            }
+            recorder.Record(sim);
+        }
+        if (!recorder.Close()) {
+            std::fprintf(stderr, "writing %s failed; the replay is incomplete\n", options.recordPath);
+        }
+
+        results[game] = GameResult{sim.GetScore(), sim.GetLength(), sim.GetTick(), sim.HasWon(),
+                                   autopilot.GetSearchCount() - searchesBefore};
+    }
+}
+
+template <typename Value>
+static void PrintDistribution(const char* name, std::vector<Value> values) {
+    std::sort(values.begin(), values.end());
+
+    double sum = 0.0;
+    for (Value value : values) {
+        sum += static_cast<double>(value);
+    }
+
+    auto percentile = [&values](double p) {
+        return static_cast<double>(values[static_cast<std::size_t>(p * (values.size() - 1))]);
+    };
+
+    std::printf("%-8s mean %10.2f  min %8.0f  p50 %8.0f  p90 %8.0f  p99 %8.0f  max %8.0f\n",
+                name, sum / values.size(), percentile(0.0), percentile(0.5),
+                percentile(0.9), percentile(0.99), percentile(1.0));
+}
+
+static bool ParseOptions(int argc, char** argv, BatchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--games") == 0) options.games = std::atoi(value);
+        else if (std::strcmp(arg, "--threads") == 0) options.threads = static_cast<unsigned int>(std::atoi(value));
+        else if (std::strcmp(arg, "--seed") == 0) options.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--arena") == 0) options.arenaSize = std::atoi(value);
+        else if (std::strcmp(arg, "--obstacles") == 0) options.obstacles = std::atoi(value);
+        else if (std::strcmp(arg, "--max-ticks") == 0) options.maxTicks = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--policy") == 0 && std::strcmp(value, "greedy") == 0) options.policy = Policy::GREEDY;
+        else if (std::strcmp(arg, "--policy") == 0 && std::strcmp(value, "autopilot") == 0) options.policy = Policy::AUTOPILOT;
+        else if (std::strcmp(arg, "--policy") == 0 && std::strcmp(value, "cycle") == 0) options.policy = Policy::CYCLE;
+        else if (std::strcmp(arg, "--record") == 0) options.recordPath = value;
+        else if (std::strcmp(arg, "--world") == 0 && std::strcmp(value, "dense") == 0) options.chunked = false;
+        else if (std::strcmp(arg, "--world") == 0 && std::strcmp(value, "chunked") == 0) options.chunked = true;
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    if (options.chunked && options.policy != Policy::GREEDY) {
+        std::fprintf(stderr, "chunked worlds only run the greedy policy\n");
+        return false;
+    }
+
+    return options.games > 0 && options.arenaSize > 0;
+}
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: snake_batch [--games N] [--threads T] [--seed S] [--arena A] [--obstacles O] [--max-ticks M] [--policy greedy|autopilot|cycle] [--record FILE] [--world dense|chunked]\n");
+        return 1;
+    }
+
+    TRACE_THREAD_NAME("Main");
+    std::vector<GameResult> results(options.games);
+
+    // One jump per game, walked in order up front
+    std::vector<RandomStream> streams;
+    streams.reserve(options.games);
+    RandomStream stream(options.seed);
+    for (int game = 0; game < options.games; ++game) {
+        streams.push_back(stream);
+        stream.Jump();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    unsigned int threadCount;
+    {
+        TaskPool pool(options.threads);
+        threadCount = pool.GetThreadCount();
+
+        for (int first = 0; first < options.games; first += options.gamesPerTask) {
+            int count = std::min(options.gamesPerTask, options.games - first);
+            pool.Submit([&options, &streams, &results, first, count]() {
+                PlayGames(options, streams, first, count, results);
+            });
+        }
+        pool.Wait();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<int> scores, lengths;
+    std::vector<unsigned long long> ticks;
+    unsigned long long totalTicks = 0;
+    unsigned long long totalSearches = 0;
+    int wins = 0;
+    for (const auto& result : results) {
+        scores.push_back(result.score);
+        lengths.push_back(result.length);
+        ticks.push_back(result.ticks);
+        totalTicks += result.ticks;
+        totalSearches += result.searches;
+        wins += result.won ? 1 : 0;
+    }
+
+    std::printf("%d games on %u threads in %.3f s\n", options.games, threadCount, seconds);
+    PrintDistribution("score", scores);
+    PrintDistribution("length", lengths);
+    PrintDistribution("ticks", ticks);
+    std::printf("wins     %d\n", wins);
+    if (options.policy == Policy::AUTOPILOT) {
+        std::printf("searches %.1f%% of decisions\n", 100.0 * totalSearches / totalTicks);
+    }
+    std::printf("games/s  %.0f\n", options.games / seconds);
+    std::printf("ticks/s  %.0f\n", totalTicks / seconds);
+
+    // Only written in SNAKE_TRACING builds
+    TRACE_DUMP("trace.json");
+
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include "camera_controller.h"
 #include <cmath>
 #include "raymath.h"
+#include "trace.h"
 
 CameraController::CameraController() :
     snake(nullptr),
@@ -29,21 +30,25 @@ void CameraController::Initialize(Snake* snakePtr) {
     targetPosition = camera.position;
 }
 
-void CameraController::Update() {
+void CameraController::Update(float deltaTime) {
+    TRACE_ZONE("CameraController::Update");
+
     if (!snake) return;
     
-    const auto& segments = snake->GetSegments();
-    if (segments.empty()) return;
+    if (snake->GetLength() == 0) return;
     
     // Get head position for tracking
-    Vector3 head = segments.front();
+    Vector3 head = snake->GetHeadPosition();
     
     // Calculate desired distance based on snake length
     float desiredDistance = minDistance + distancePerSegment * (snake->GetLength() - 3);
     desiredDistance = fmin(desiredDistance, maxDistance);
     
+    // Ease 5% of the way per 1/60 s, whatever the frame rate
+    float follow = 1.0f - powf(0.95f, deltaTime * 60.0f);
+    
     // Smoothly adjust camera distance
-    cameraDistance = cameraDistance * 0.95f + desiredDistance * 0.05f;
+    cameraDistance += (desiredDistance - cameraDistance) * follow;
     
     // Set camera target at snake head
     camera.target = head;
@@ -59,9 +64,9 @@ void CameraController::Update() {
     };
     
     // Smooth camera movement with interpolation
-    camera.position.x = camera.position.x * 0.95f + targetPosition.x * 0.05f;
-    camera.position.y = camera.position.y * 0.95f + targetPosition.y * 0.05f;
-    camera.position.z = camera.position.z * 0.95f + targetPosition.z * 0.05f;
+    camera.position.x += (targetPosition.x - camera.position.x) * follow;
+    camera.position.y += (targetPosition.y - camera.position.y) * follow;
+    camera.position.z += (targetPosition.z - camera.position.z) * follow;
 }
 
 Camera3D CameraController::GetCamera() const {
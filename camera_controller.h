@@ -10,7 +10,7 @@ public:
     ~CameraController();
     
     void Initialize(Snake* snakePtr);
-    void Update();
+    void Update(float deltaTime);
     Camera3D GetCamera() const;
     
 private:
@@ -0,0 +1,71 @@
+#include "chunked_world.h"
+#include <cstdlib>
+#include <cstring>
+
+ChunkedWorld::ChunkedWorld() :
+    arenaSize(0),
+    chunksPerSide(0),
+    lastChunk(nullptr),
+    centerX(-1),
+    centerZ(-1),
+    generated(0) {
+}
+
+void ChunkedWorld::Reset(int arenaSize) {
+    this->arenaSize = arenaSize;
+    // The border rows sit in the first and last chunks like any other cell
+    const int width = arenaSize * 2 + 3;
+    chunksPerSide = (width + chunkSize - 1) / chunkSize;
+    chunks.clear();
+    lastChunk = nullptr;
+    centerX = -1;
+    centerZ = -1;
+}
+
+ChunkedWorld::Chunk& ChunkedWorld::Insert(int x, int z) {
+    std::unique_ptr<Chunk>& slot = chunks[Key(x, z)];
+    if (!slot) {
+        slot.reset(new Chunk());
+    }
+
+    Chunk& chunk = *slot;
+    chunk.x = x;
+    chunk.z = z;
+    chunk.obstacles.clear();
+    std::memset(chunk.staticBits, 0, sizeof(chunk.staticBits));
+    std::memset(chunk.snakeBits, 0, sizeof(chunk.snakeBits));
+    std::memset(chunk.spawnBits, 0, sizeof(chunk.spawnBits));
+    chunk.snakeCells = 0;
+
+    generated++;
+    lastChunk = &chunk;
+    return chunk;
+}
+
+void ChunkedWorld::ClearSnake() {
+    for (auto& entry : chunks) {
+        Chunk& chunk = *entry.second;
+        std::memset(chunk.snakeBits, 0, sizeof(chunk.snakeBits));
+        chunk.snakeCells = 0;
+    }
+}
+
+void ChunkedWorld::KeepAround(const Cell& center, int radius) {
+    const int x = ChunkX(center);
+    const int z = ChunkZ(center);
+    if (x == centerX && z == centerZ) return;
+    centerX = x;
+    centerZ = z;
+
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        const Chunk& chunk = *it->second;
+        if (chunk.snakeCells == 0 && (std::abs(chunk.x - x) > radius || std::abs(chunk.z - z) > radius)) {
+            if (lastChunk == &chunk) {
+                lastChunk = nullptr;
+            }
+            it = chunks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef CHUNKED_WORLD_H
+#define CHUNKED_WORLD_H
+
+#include "simulation_types.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Arena storage for worlds too big to keep whole. The arena plus its
+// border is cut into square chunks that own their obstacles and occupancy
+// bits. Only chunks something has looked at exist; the owner fills a new
+// chunk in from the seed, so a chunk far from the head that holds no snake
+// cells can be dropped and later rebuilt identically. Memory and per-tick
+// work follow the area in use, not the arena size.
+class ChunkedWorld {
+public:
+    static const int chunkShift = 5;
+    static const int chunkSize = 1 << chunkShift;  // Cells per chunk side
+    static const int chunkCells = chunkSize * chunkSize;
+    static const int chunkWords = chunkCells / 64;
+
+    struct Chunk {
+        int x;  // Chunk coordinates, 0..ChunksPerSide()-1
+        int z;
+        std::vector<Obstacle> obstacles;  // Every obstacle centered in this chunk
+        std::uint64_t staticBits[chunkWords];  // Border and obstacle cells
+        std::uint64_t snakeBits[chunkWords];
+        std::uint64_t spawnBits[chunkWords];   // Cells an apple may use, ignoring the snake
+        int snakeCells;                        // A chunk holding any is never dropped
+
+        static bool Test(const std::uint64_t* bits, int index) { return (bits[index >> 6] >> (index & 63)) & 1; }
+        static void Set(std::uint64_t* bits, int index) { bits[index >> 6] |= std::uint64_t(1) << (index & 63); }
+        static void Clear(std::uint64_t* bits, int index) { bits[index >> 6] &= ~(std::uint64_t(1) << (index & 63)); }
+    };
+
+    ChunkedWorld();
+
+    void Reset(int arenaSize);  // Drops every chunk
+
+    // Chunk coordinates of a cell inside the arena or on its border
+    int ChunkX(const Cell& cell) const { return (cell.x + arenaSize + 1) >> chunkShift; }
+    int ChunkZ(const Cell& cell) const { return (cell.z + arenaSize + 1) >> chunkShift; }
+    // Bit index of a cell within its chunk
+    int LocalIndex(const Cell& cell) const {
+        return (((cell.z + arenaSize + 1) & (chunkSize - 1)) << chunkShift) | ((cell.x + arenaSize + 1) & (chunkSize - 1));
+    }
+    // Cell at a local position of a chunk
+    Cell CellAt(const Chunk& chunk, int localX, int localZ) const {
+        return Cell{(chunk.x << chunkShift) + localX - arenaSize - 1, (chunk.z << chunkShift) + localZ - arenaSize - 1};
+    }
+    int ChunksPerSide() const { return chunksPerSide; }
+    int GetArenaSize() const { return arenaSize; }
+
+    // Resident chunk or nullptr. Consecutive lookups of the same chunk (the
+    // head walking through it) skip the hash table.
+    Chunk* Find(int x, int z) const {
+        if (lastChunk && lastChunk->x == x && lastChunk->z == z) return lastChunk;
+        auto found = chunks.find(Key(x, z));
+        if (found == chunks.end()) return nullptr;
+        lastChunk = found->second.get();
+        return lastChunk;
+    }
+    Chunk& Insert(int x, int z);  // A blank chunk for the owner to fill in
+
+    void ClearSnake();  // Snake bits of every resident chunk
+
+    template <typename Visit>
+    void ForEachResident(Visit visit) const {
+        for (const auto& entry : chunks) {
+            visit(*entry.second);
+        }
+    }
+
+    // Drops chunks more than `radius` chunks from the one holding `center`,
+    // unless they hold snake cells. Only scans when the center moved to
+    // another chunk since the last call.
+    void KeepAround(const Cell& center, int radius);
+
+    std::size_t GetResidentCount() const { return chunks.size(); }
+    std::uint64_t GetGeneratedCount() const { return generated; }  // Counts regenerations too
+
+private:
+    std::uint64_t Key(int x, int z) const {
+        return static_cast<std::uint64_t>(z) * static_cast<std::uint64_t>(chunksPerSide) + static_cast<std::uint64_t>(x);
+    }
+
+    int arenaSize;
+    int chunksPerSide;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Chunk>> chunks;
+    mutable Chunk* lastChunk;
+    int centerX;  // Chunk KeepAround last scanned around
+    int centerZ;
+    std::uint64_t generated;
+};
+
+#endif // CHUNKED_WORLD_H
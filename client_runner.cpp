@@ -0,0 +1,200 @@
+// Load generator for snake_server: every client thread creates a batch of
+// envs on the server and steps it, while stepping an identical VectorEnv
+// in this process with the same actions. Reports both rates, so the cost
+// of going through the server is the difference, and checks that rewards,
+// dones and observations agree byte for byte.
+//
+//   snake_client [--socket PATH] [--clients C] [--envs N] [--steps S]
+//                [--seed S] [--arena A] [--obstacles O]
+//
+// Client c plays seed + c. Actions are random but never into a wall or
+// the body when another move is open, so games run long enough to matter.
+
+#include "sim_client.h"
+#include "vector_env.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct ClientOptions {
+    const char* socketPath = "/tmp/snake_sim.sock";
+    int clients = 1;
+    int envs = 64;
+    int steps = 2000;
+    std::uint64_t seed = 1;
+    int arenaSize = 20;
+    int obstacles = 15;
+};
+
+struct ClientResult {
+    bool ok = false;
+    double remoteSeconds = 0.0;  // Inside SimClient::Step
+    double localSeconds = 0.0;   // Inside VectorEnv::Step
+    unsigned long long mismatches = 0;
+    unsigned long long dones = 0;
+};
+
+static bool ParseOptions(int argc, char** argv, ClientOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--socket") == 0) options.socketPath = value;
+        else if (std::strcmp(arg, "--clients") == 0) options.clients = std::atoi(value);
+        else if (std::strcmp(arg, "--envs") == 0) options.envs = std::atoi(value);
+        else if (std::strcmp(arg, "--steps") == 0) options.steps = std::atoi(value);
+        else if (std::strcmp(arg, "--seed") == 0) options.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--arena") == 0) options.arenaSize = std::atoi(value);
+        else if (std::strcmp(arg, "--obstacles") == 0) options.obstacles = std::atoi(value);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    return options.clients > 0 && options.envs > 0 && options.steps > 0 && options.arenaSize > 1;
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunClient(const ClientOptions& options, int index, ClientResult& result) {
+    TRACE_THREAD_NAME("Client");
+
+    VectorEnvConfig config;
+    config.envCount = options.envs;
+    config.sim.arenaSize = options.arenaSize;
+    config.sim.maxObstacles = options.obstacles;
+    config.seed = options.seed + static_cast<std::uint64_t>(index);
+
+    SimClient client;
+    RemoteEnvInfo remote;
+    if (!client.Connect(options.socketPath) || !client.Create(config, remote)) {
+        std::fprintf(stderr, "client %d: cannot create envs on %s (status %u)\n", index, options.socketPath,
+                     static_cast<unsigned int>(client.GetLastStatus()));
+        return;
+    }
+
+    VectorEnv local(config);
+    const std::size_t observationBytes = local.GetEnvCount() * local.GetObservationSize();
+    std::vector<std::uint8_t> observations(observationBytes);
+    local.Reset(observations.data());
+
+    std::vector<std::uint8_t> actions(options.envs);
+    std::vector<int> localActions(options.envs);
+    std::vector<float> rewards(options.envs), localRewards(options.envs);
+    std::vector<std::uint8_t> dones(options.envs), localDones(options.envs);
+    RandomStream random(config.seed);
+
+    result.mismatches += std::memcmp(remote.observations, observations.data(), observationBytes) != 0;
+    for (int step = 0; step < options.steps; ++step) {
+        for (int i = 0; i < options.envs; ++i) {
+            const Simulation& sim = local.GetSimulation(i);
+            const int first = static_cast<int>(random.NextBelow(4));
+            actions[i] = static_cast<std::uint8_t>(first);
+            for (int turn = 0; turn < 4; ++turn) {
+                const Direction direction = static_cast<Direction>((first + turn) & 3);
+                if (!sim.IsBlocked(Neighbor(sim.GetHead(), direction))) {
+                    actions[i] = static_cast<std::uint8_t>(direction);
+                    break;
+                }
+            }
+            localActions[i] = actions[i];
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (!client.Step(remote, actions.data(), rewards.data(), dones.data())) {
+            std::fprintf(stderr, "client %d: step failed (status %u)\n", index,
+                         static_cast<unsigned int>(client.GetLastStatus()));
+            return;
+        }
+        result.remoteSeconds += SecondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        local.Step(localActions.data(), observations.data(), localRewards.data(), localDones.data());
+        result.localSeconds += SecondsSince(start);
+
+        bool same = std::memcmp(rewards.data(), localRewards.data(), rewards.size() * sizeof(float)) == 0 &&
+                    std::memcmp(dones.data(), localDones.data(), dones.size()) == 0 &&
+                    std::memcmp(remote.observations, observations.data(), observationBytes) == 0;
+        result.mismatches += same ? 0 : 1;
+        for (std::uint8_t done : dones) {
+            result.dones += done != envRunning ? 1 : 0;
+        }
+    }
+
+    // A snapshot taken and put back must leave the game where it was
+    SnapshotReply summary;
+    std::string state;
+    if (!client.Snapshot(remote, 0, summary, state) || !client.Restore(remote, 0, state) ||
+        summary.tick != local.GetSimulation(0).GetTick() ||
+        std::memcmp(remote.observations, observations.data(), observationBytes) != 0) {
+        result.mismatches++;
+    }
+
+    client.Destroy(remote);
+    result.ok = true;
+}
+
+int main(int argc, char** argv) {
+    ClientOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: snake_client [--socket PATH] [--clients C] [--envs N] [--steps S] [--seed S] [--arena A] [--obstacles O]\n");
+        return 1;
+    }
+
+    TRACE_THREAD_NAME("Main");
+    std::vector<ClientResult> results(options.clients);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int c = 0; c < options.clients; ++c) {
+        threads.emplace_back(RunClient, std::cref(options), c, std::ref(results[c]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double seconds = SecondsSince(start);
+
+    ClientResult total;
+    total.ok = true;
+    for (const auto& result : results) {
+        total.ok = total.ok && result.ok;
+        total.remoteSeconds += result.remoteSeconds;
+        total.localSeconds += result.localSeconds;
+        total.mismatches += result.mismatches;
+        total.dones += result.dones;
+    }
+    if (!total.ok) return 1;
+
+    // Per step figures are averaged over the clients' own time
+    const double stepsPerClient = static_cast<double>(options.steps);
+    const double envSteps = stepsPerClient * options.envs * options.clients;
+    std::printf("%d clients x %d envs x %d steps in %.3f s\n", options.clients, options.envs, options.steps, seconds);
+    std::printf("remote     %8.1f us/step  %6.0f ns/env-step\n",
+                1e6 * total.remoteSeconds / (stepsPerClient * options.clients), 1e9 * total.remoteSeconds / envSteps);
+    std::printf("in-process %8.1f us/step  %6.0f ns/env-step\n",
+                1e6 * total.localSeconds / (stepsPerClient * options.clients), 1e9 * total.localSeconds / envSteps);
+    std::printf("overhead   %8.1f us/step\n",
+                1e6 * (total.remoteSeconds - total.localSeconds) / (stepsPerClient * options.clients));
+    std::printf("episodes   %llu\n", total.dones);
+    std::printf("mismatches %llu\n", total.mismatches);
+
+    // Only written in SNAKE_TRACING builds
+    TRACE_DUMP("trace.json");
+
+    return total.mismatches == 0 ? 0 : 1;
+}
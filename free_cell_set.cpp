@@ -0,0 +1,19 @@
+#include "free_cell_set.h"
+#include <algorithm>
+
+FreeCellSet::FreeCellSet() {
+}
+
+void FreeCellSet::Resize(int cellCount) {
+    cells.clear();
+    cells.reserve(cellCount);
+    position.assign(cellCount, -1);
+    eligible.assign(cellCount, 0);
+}
+
+void FreeCellSet::Clear() {
+    for (int index : cells) {
+        position[index] = -1;
+    }
+    cells.clear();
+}
@@ -0,0 +1,50 @@
+#ifndef FREE_CELL_SET_H
+#define FREE_CELL_SET_H
+
+#include <cstdint>
+#include <vector>
+
+// Set of cells an apple may spawn on, keyed by OccupancyGrid cell index.
+// Members sit in a dense array so a uniform pick is one random index, and
+// a position table makes removal a swap with the last element.
+class FreeCellSet {
+public:
+    FreeCellSet();
+
+    void Resize(int cellCount);  // Empties the set and marks every cell ineligible
+    void Clear();                // Empties the set, keeps eligibility
+
+    // Cells that are never eligible (outside the spawn area, next to obstacles)
+    // are ignored by Add
+    void SetEligible(int index, bool eligible) { this->eligible[index] = eligible ? 1 : 0; }
+    bool IsEligible(int index) const { return eligible[index] != 0; }
+
+    void Add(int index) {
+        if (!eligible[index] || position[index] >= 0) return;
+        position[index] = static_cast<int>(cells.size());
+        cells.push_back(index);
+    }
+
+    void Remove(int index) {
+        int slot = position[index];
+        if (slot < 0) return;
+
+        int last = cells.back();
+        cells[slot] = last;
+        position[last] = slot;
+        cells.pop_back();
+        position[index] = -1;
+    }
+
+    bool Contains(int index) const { return position[index] >= 0; }
+    int Size() const { return static_cast<int>(cells.size()); }
+    bool Empty() const { return cells.empty(); }
+    int At(int slot) const { return cells[slot]; }
+
+private:
+    std::vector<int> cells;          // Dense member list
+    std::vector<int> position;       // Slot in cells, -1 when absent
+    std::vector<std::uint8_t> eligible;
+};
+
+#endif // FREE_CELL_SET_H
@@ -1,425 +1,492 @@
 #include "game.h"
-#include <cstdlib>
 #include <ctime>
 #include <cmath>      // Add for fmax
 #include "raymath.h"  // Add for Vector3Distance
+#include "trace.h"
 
-Game::Game() : 
-    arenaSize(20.0f), 
-    moveTimer(0.0f), 
+// Interactive games get a fresh layout every launch
+static SimConfig WallClockConfig(const GameOptions& options) {
+    SimConfig config;
+    config.seed = static_cast<std::uint64_t>(std::time(nullptr));
+    config.arenaSize = options.arenaSize;
+    config.chunked = options.chunked;
+
+    // 15 obstacles is the default arena's density
+    const double scale = static_cast<double>(options.arenaSize) / 20.0;
+    config.maxObstacles = static_cast<int>(std::fmin(15.0 * scale * scale, 2.0e9));
+    return config;
+}
+
+// Ticks speed up gradually as the snake grows
+static float MoveIntervalFor(int length) {
+    return fmax(0.08f, 0.2f - (length - 3) * 0.005f);
+}
+
+// How long the simulation thread sleeps at most, so key presses apply promptly
+static const double inputPollInterval = 0.002;
+
+Game::Game(const GameOptions& options) : 
+    options(options),
+    clockStart(std::chrono::steady_clock::now()),
+    sim(WallClockConfig(options)),
+    pilotMode(PilotMode::MANUAL),
+    replaying(false),
+    replayPaused(false),
+    replayTick(0),
+    tickTime(0.0),
+    nextTickTime(0.0),
     moveInterval(0.2f),
-    gameOver(false),
-    score(0),
-    maxObstacles(15) {
-    std::srand(static_cast<unsigned int>(std::time(nullptr)));
+    epoch(0),
+    running(false),
+    current(nullptr),
+    shownEpoch(~0ull),
+    shownTick(0) {
 }
 
 Game::~Game() {
+    StopSimulation();
 }
 
 void Game::Initialize() {
-    // Initialize snake at center of arena
-    snake.Initialize(Vector3{0.0f, 0.5f, 0.0f});
+    // A recording brings its own seed and arena
+    if (!options.replayPath.empty()) {
+        if (replay.Open(options.replayPath)) {
+            sim = Simulation(replay.GetConfig());
+            replaying = true;
+        } else {
+            TraceLog(LOG_WARNING, "REPLAY: %s is not a finished replay", options.replayPath.c_str());
+        }
+    }
+    
+    // Generate obstacles, snake and the first apple
+    sim.Initialize();
+    
+    if (replaying) {
+        replay.Seek(sim, 0);
+    }
+    else if (!options.recordPath.empty() && !recorder.Open(options.recordPath, sim)) {
+        TraceLog(LOG_WARNING, "REPLAY: cannot write %s", options.recordPath.c_str());
+    }
+    
+    if (!options.policyPath.empty() && !neuralPolicy.Load(options.policyPath)) {
+        TraceLog(LOG_WARNING, "POLICY: %s is not a population file for this network", options.policyPath.c_str());
+    }
+    
+    layoutConfig = sim.GetConfig();
+    if (layoutConfig.chunked) {
+        streamLayout = Simulation(layoutConfig);
+    }
+    
+    // Snake visuals follow the snapshots
+    snake.Initialize(&resources);
     
     // Initialize camera controller
     cameraController.Initialize(&snake);
     
-    // Create apple model (red sphere) with more appetizing color
-    appleModel = LoadModelFromMesh(GenMeshSphere(0.5f, 12, 12));
-    appleTexture = LoadTexture("resources/apple_texture.png");
-    Material material = LoadMaterialDefault();
-    material.maps[MATERIAL_MAP_DIFFUSE].color = (Color){ 220, 20, 60, 255 }; // Crimson red
-    appleModel.materials[0] = material;
-    
-    // Create obstacle models
-    treeModel = LoadModelFromMesh(GenMeshCone(0.7f, 2.0f, 8));
-    Material treeMaterial = LoadMaterialDefault();
-    treeMaterial.maps[MATERIAL_MAP_DIFFUSE].color = (Color){ 34, 139, 34, 255 }; // Forest green
-    treeModel.materials[0] = treeMaterial;
-    
-    rockModel = LoadModelFromMesh(GenMeshSphere(0.8f, 6, 6));
-    Material rockMaterial = LoadMaterialDefault();
-    rockMaterial.maps[MATERIAL_MAP_DIFFUSE].color = (Color){ 169, 169, 169, 255 }; // Dark grey
-    rockModel.materials[0] = rockMaterial;
-    
-    // Generate obstacles
-    GenerateObstacles();
-    
-    // Spawn first apple
-    SpawnApple();
+    // Create apple spheres at each detail level with a more appetizing color
+    const int appleRings[ViewFrustum::lodCount] = { 12, 8, 5 };
+    for (int lod = 0; lod < ViewFrustum::lodCount; ++lod) {
+        appleMeshes[lod] = resources.AcquireSphere(0.5f, appleRings[lod], appleRings[lod]);
+    }
+    appleMaterial = resources.AcquireMaterial("apple", (Color){ 220, 20, 60, 255 }); // Crimson red
+    
+    // Bake terrain, walls, scenery and obstacles once per obstacle layout
+    staticWorld.Build(static_cast<float>(layoutConfig.arenaSize), sim.GetObstacles(), &resources);
+    
+    // From here on the simulation belongs to its own thread
+    tickTime = Now();
+    nextTickTime = tickTime + moveInterval;
+    Publish();
+    running.store(true, std::memory_order_release);
+    simulationThread = std::thread(&Game::SimulationLoop, this);
 }
 
 void Game::Update() {
-    if (gameOver) {
-        if (IsKeyPressed(KEY_R)) {
-            // Reset game
-            snake.Reset(Vector3{0.0f, 0.5f, 0.0f});
-            SpawnApple();
-            moveInterval = 0.2f;
-            score = 0;
-            gameOver = false;
-        }
-        return;
-    }
+    TRACE_ZONE("Game::Update");
 
-    float deltaTime = GetFrameTime();
+    // F9 writes the most recent trace events without quitting
+    if (IsKeyPressed(KEY_F9)) {
+        TRACE_DUMP("trace.json");
+    }
 
+    // Keys only become commands here; the simulation thread applies them
+    // on its next wake, whatever the render rate
     // Handle input for snake direction - adjusted for isometric view
     // Based on the camera angle (45 degrees), we need to map the arrow keys differently
     if (IsKeyPressed(KEY_UP)) {
-        snake.SetDirection(Direction::UP);
+        SendCommand(GameCommand::TURN_UP);
     }
     else if (IsKeyPressed(KEY_DOWN)) {
-        snake.SetDirection(Direction::DOWN);
+        SendCommand(GameCommand::TURN_DOWN);
     }
     else if (IsKeyPressed(KEY_RIGHT)) {
-        snake.SetDirection(Direction::RIGHT);
+        SendCommand(GameCommand::TURN_RIGHT);
     }
     else if (IsKeyPressed(KEY_LEFT)) {
-        snake.SetDirection(Direction::LEFT);
+        SendCommand(GameCommand::TURN_LEFT);
     }
     
     // Add WASD controls as an alternative that may feel more intuitive with this camera angle
     if (IsKeyPressed(KEY_W)) {
-        snake.SetDirection(Direction::UP);
+        SendCommand(GameCommand::TURN_UP);
     }
     else if (IsKeyPressed(KEY_S)) {
-        snake.SetDirection(Direction::DOWN);
+        SendCommand(GameCommand::TURN_DOWN);
     }
     else if (IsKeyPressed(KEY_D)) {
-        snake.SetDirection(Direction::RIGHT);
+        SendCommand(GameCommand::TURN_RIGHT);
     }
     else if (IsKeyPressed(KEY_A)) {
-        snake.SetDirection(Direction::LEFT);
+        SendCommand(GameCommand::TURN_LEFT);
     }
     
-    // Update snake movement interpolation
-    snake.Update(deltaTime);
-    
-    // Move snake based on timer
-    moveTimer += deltaTime;
-    if (moveTimer >= moveInterval) {
-        snake.Move();
-        moveTimer = 0.0f;
-        
-        // Check for collisions
-        if (CheckCollision()) {
-            gameOver = true;
-        }
+    // R restarts (or rewinds a replay), P cycles the pilot; SPACE pauses
+    // a replay, comma/period jump 1000 ticks
+    if (IsKeyPressed(KEY_R)) SendCommand(GameCommand::RESTART);
+    if (IsKeyPressed(KEY_P)) SendCommand(GameCommand::CYCLE_PILOT);
+    if (IsKeyPressed(KEY_SPACE)) SendCommand(GameCommand::TOGGLE_PAUSE);
+    if (IsKeyPressed(KEY_COMMA)) SendCommand(GameCommand::SEEK_BACK);
+    if (IsKeyPressed(KEY_PERIOD)) SendCommand(GameCommand::SEEK_FORWARD);
+    
+    // Follow the latest complete snapshot; a jump (restart, seek, missed
+    // ticks) snaps the visuals instead of sliding them
+    current = &snapshots.Read();
+    if (current->epoch != shownEpoch) {
+        snake.Reset(current->body, current->tick);
     }
+    else if (current->tick != shownTick) {
+        snake.Move(current->body, current->tick);
+    }
+    shownEpoch = current->epoch;
+    shownTick = current->tick;
+    
+    // Draw the snake part of the way into the tick that is underway
+    snake.Update(TickBlend(*current));
     
     // Update camera position
-    cameraController.Update();
+    cameraController.Update(GetFrameTime());
 }
 
-void Game::Render() {
-    BeginDrawing();
-    ClearBackground(SKYBLUE);
-    
-    // Set fog parameters
-    Color fogColor = (Color){ 200, 220, 240, 255 };  // Light blue-gray fog
-    
-    BeginMode3D(cameraController.GetCamera());
-    
-    // Draw extended terrain with clear depth separation
-    float extendedSize = arenaSize * 1.5f;
-    
-    // Draw base terrain (lowest level) - darker grass for outer area
-    DrawPlane(Vector3{0.0f, -0.1f, 0.0f}, Vector2{extendedSize * 2.0f, extendedSize * 2.0f}, 
-              (Color){ 65, 160, 20, 255 });
-    
-    // Draw playable area slightly elevated for clear separation
-    DrawPlane(Vector3{0.0f, 0.0f, 0.0f}, Vector2{arenaSize * 2.0f, arenaSize * 2.0f}, 
-              (Color){ 76, 187, 23, 255 });
-    
-    // Draw borders with clearer positioning
-    float wallHeight = 1.0f;
-    float wallOffset = 0.5f;
-    float wallThickness = 1.0f;
-    Color wallColor = (Color){ 139, 134, 130, 255 };
-    
-    // Draw walls with explicit z-ordering
-    DrawCube(Vector3{0, wallHeight/2, arenaSize + wallOffset}, arenaSize*2 + wallThickness, wallHeight, wallThickness, wallColor);
-    DrawCube(Vector3{0, wallHeight/2, -arenaSize - wallOffset}, arenaSize*2 + wallThickness, wallHeight, wallThickness, wallColor);
-    DrawCube(Vector3{arenaSize + wallOffset, wallHeight/2, 0}, wallThickness, wallHeight, arenaSize*2 + wallThickness, wallColor);
-    DrawCube(Vector3{-arenaSize - wallOffset, wallHeight/2, 0}, wallThickness, wallHeight, arenaSize*2 + wallThickness, wallColor);
-    
-    // Draw corner posts with clear z-ordering
-    float postSize = 1.2f;
-    DrawCube(Vector3{arenaSize + wallOffset/2, wallHeight/2, arenaSize + wallOffset/2}, postSize, wallHeight*1.5f, postSize, wallColor);
-    DrawCube(Vector3{-arenaSize - wallOffset/2, wallHeight/2, arenaSize + wallOffset/2}, postSize, wallHeight*1.5f, postSize, wallColor);
-    DrawCube(Vector3{arenaSize + wallOffset/2, wallHeight/2, -arenaSize - wallOffset/2}, postSize, wallHeight*1.5f, postSize, wallColor);
-    DrawCube(Vector3{-arenaSize - wallOffset/2, wallHeight/2, -arenaSize - wallOffset/2}, postSize, wallHeight*1.5f, postSize, wallColor);
-    
-    // Create a deterministic seed for consistent decorative object placement
-    srand(42);
-    
-    // Add decorative objects around the area with height variation to prevent z-fighting
-    for (int i = 0; i < 24; i++) {
-        float angle = (float)i * 15.0f * DEG2RAD;
-        
-        // Vary the distance to prevent objects from aligning on the same Z
-        float distance = extendedSize * 0.9f + ((i % 3) * 0.4f);
+void Game::SendCommand(GameCommand command) {
+    std::lock_guard<std::mutex> lock(commandMutex);
+    commands.push_back(command);
+}
+
+float Game::TickBlend(const GameSnapshot& snapshot) const {
+    if (snapshot.gameOver) return 1.0f;
+    const double span = snapshot.nextTickTime - snapshot.tickTime;
+    if (span <= 0.0) return 1.0f;
+    return static_cast<float>(fmin((Now() - snapshot.tickTime) / span, 1.0));
+}
+
+double Game::Now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+void Game::SimulationLoop() {
+    TRACE_THREAD_NAME("Simulation");
+
+    while (running.load(std::memory_order_acquire)) {
+        {
+            std::lock_guard<std::mutex> lock(commandMutex);
+            applying.swap(commands);
+        }
+        bool changed = !applying.empty();
+        for (GameCommand command : applying) {
+            ApplyCommand(command);
+        }
+        applying.clear();
         
-        float x = sinf(angle) * distance;
-        float z = cosf(angle) * distance;
+        // Run every tick that is due, at a fixed rate for the current speed.
+        // Stopped games (over, paused) do not run up a backlog.
+        double now = Now();
+        if (!CanTick()) {
+            nextTickTime = now + moveInterval;
+        }
+        for (int ticks = 0; CanTick() && now >= nextTickTime; ++ticks) {
+            // Too far behind (a stall, a slow machine): drop the backlog
+            // instead of spending ever longer catching up
+            if (ticks == maxTicksPerWake) {
+                nextTickTime += std::ceil((now - nextTickTime) / moveInterval) * moveInterval;
+                break;
+            }
+            
+            tickTime = nextTickTime;
+            if (replaying) {
+                StepReplay();
+            } else {
+                StepGame();
+            }
+            nextTickTime = tickTime + moveInterval;
+            changed = true;
+        }
         
-        // Add slight height variation for each object to prevent z-fighting
-        float baseY = -0.1f + ((i % 5) * 0.02f);
-        float scale = 0.8f + ((i * 13) % 50) / 100.0f;  // Deterministic but varied scale
+        if (changed) {
+            Publish();
+        }
         
-        if (i % 2 == 0) {
-            // Draw tree with adjusted base height
-            DrawModelEx(treeModel, 
-                       Vector3{x, baseY + 1.0f, z}, 
-                       Vector3{0, 1, 0}, 
-                       (float)(i * 30), 
-                       Vector3{scale * 1.2f, scale * 1.2f, scale * 1.2f}, 
-                       WHITE);
-            
-            // Draw trunk
-            DrawCylinder(
-                Vector3{x, baseY + 0.4f, z},
-                0.2f * scale * 1.2f,
-                0.2f * scale * 1.2f,
-                0.8f,
-                8,
-                (Color){ 139, 69, 19, 255}
-            );
-        } else {
-            // Draw rock with varied height
-            DrawModelEx(rockModel,
-                      Vector3{x, baseY + 0.05f + ((i % 3) * 0.03f), z},  // Slight height variation
-                      Vector3{0, 1, 0},
-                      (float)(i * 30),
-                      Vector3{scale * 1.5f, scale * 0.9f, scale * 1.5f},
-                      (Color){ 150, 150, 150, 255 });
+        // Sleep to the next tick, waking often enough for input
+        double wake = fmin(nextTickTime, now + inputPollInterval);
+        std::this_thread::sleep_for(std::chrono::duration<double>(wake - Now()));
+    }
+}
+
+void Game::ApplyCommand(GameCommand command) {
+    if (replaying) {
+        switch (command) {
+            case GameCommand::TOGGLE_PAUSE: replayPaused = !replayPaused; break;
+            case GameCommand::SEEK_BACK: SeekReplay(static_cast<long long>(replayTick) - 1000); break;
+            case GameCommand::SEEK_FORWARD: SeekReplay(static_cast<long long>(replayTick) + 1000); break;
+            case GameCommand::RESTART: SeekReplay(0); break;
+            default: break;
         }
+        return;
     }
     
-    // Restore random seed for gameplay elements
-    srand(static_cast<unsigned int>(std::time(nullptr)));
-    
-    // Draw obstacles within the playable area
-    for (const auto& obs : obstacles) {
-        if (obs.type == ObstacleType::TREE) {
-            // Draw tree (cone)
-            DrawModelEx(treeModel, 
-                       Vector3{obs.position.x, obs.position.y + 1.0f, obs.position.z}, 
-                       Vector3{0, 1, 0}, 
-                       obs.rotation, 
-                       Vector3{obs.scale, obs.scale, obs.scale}, 
-                       WHITE);
-            
-            // Draw tree trunk (cylinder)
-            DrawCylinder(
-                Vector3{obs.position.x, obs.position.y + 0.4f, obs.position.z},
-                0.2f * obs.scale,
-                0.2f * obs.scale,
-                0.8f,
-                8,
-                (Color){ 139, 69, 19, 255} // Brown
-            );
-        } else {
-            // Draw rock
-            DrawModelEx(rockModel,
-                      obs.position,
-                      Vector3{0, 1, 0},
-                      obs.rotation,
-                      Vector3{obs.scale, obs.scale * 0.6f, obs.scale},
-                      WHITE);
+    if (sim.IsGameOver()) {
+        if (command == GameCommand::RESTART) {
+            // Reset game
+            sim.Reset();
+            autopilot.Reset();
+            hamiltonianSolver.Reset();
+            if (mctsPilot) mctsPilot->Reset();
+            moveInterval = 0.2f;
+            tickTime = Now();
+            nextTickTime = tickTime + moveInterval;
+            epoch++;
         }
+        return;
     }
     
-    // Draw snake
-    snake.Draw();
-    
-    // Draw apple with slight shine effect
-    DrawModel(appleModel, applePosition, 1.0f, WHITE);
-    DrawSphere(Vector3Add(applePosition, (Vector3){ 0.15f, 0.15f, 0.15f }), 0.1f, (Color){ 255, 255, 255, 180 });
-    
-    // Implement manual fog effect - move it out of objects' way
-    DrawCube(Vector3{0, arenaSize * 1.5f, 0}, arenaSize*4, arenaSize*3, arenaSize*4, 
-             ColorAlpha(fogColor, 0.03f));  // More subtle and higher up
-    
-    EndMode3D();
-    
-    // Draw UI
-    DrawText(TextFormat("SCORE: %d", score), 10, 10, 20, WHITE);
-    
-    if (gameOver) {
-        DrawText("GAME OVER", GetScreenWidth()/2 - MeasureText("GAME OVER", 40)/2, 
-                GetScreenHeight()/2 - 40, 40, RED);
-        DrawText("PRESS R TO RESTART", GetScreenWidth()/2 - MeasureText("PRESS R TO RESTART", 20)/2, 
-                GetScreenHeight()/2 + 10, 20, WHITE);
+    switch (command) {
+        case GameCommand::TURN_UP: sim.SetDirection(Direction::UP); break;
+        case GameCommand::TURN_DOWN: sim.SetDirection(Direction::DOWN); break;
+        case GameCommand::TURN_LEFT: sim.SetDirection(Direction::LEFT); break;
+        case GameCommand::TURN_RIGHT: sim.SetDirection(Direction::RIGHT); break;
+        case GameCommand::CYCLE_PILOT:
+            // The computer drivers search the dense grid, which chunked arenas do not keep
+            if (!sim.GetConfig().chunked) {
+                pilotMode = pilotMode == PilotMode::MANUAL ? PilotMode::PATHFINDER :
+                            pilotMode == PilotMode::PATHFINDER ? PilotMode::HAMILTONIAN :
+                            pilotMode == PilotMode::HAMILTONIAN ? PilotMode::MCTS :
+                            pilotMode == PilotMode::MCTS && neuralPolicy.IsLoaded() ? PilotMode::NEURAL : PilotMode::MANUAL;
+                autopilot.Reset();
+                hamiltonianSolver.Reset();
+                if (mctsPilot) {
+                    mctsPilot->Reset();
+                } else if (pilotMode == PilotMode::MCTS) {
+                    // Only now start its worker threads; most games never pick it
+                    mctsPilot.reset(new MctsPilot());
+                }
+            }
+            break;
+        default: break;
     }
-    
-    EndDrawing();
 }
 
-void Game::Cleanup() {
-    UnloadTexture(appleTexture);
-    UnloadModel(appleModel);
-    UnloadModel(treeModel);
-    UnloadModel(rockModel);
+bool Game::CanTick() const {
+    if (replaying) {
+        return !replayPaused && replayTick < replay.GetTickCount();
+    }
+    return !sim.IsGameOver();
 }
 
-void Game::SpawnApple() {
-    // Random position within arena bounds
-    float x = (float)(rand() % (int)(arenaSize * 2) - arenaSize);
-    float z = (float)(rand() % (int)(arenaSize * 2) - arenaSize);
+void Game::StepGame() {
+    // A computer driver overrides any key pressed since the last step
+    if (pilotMode == PilotMode::PATHFINDER) {
+        sim.SetDirection(autopilot.Decide(sim));
+    }
+    else if (pilotMode == PilotMode::HAMILTONIAN) {
+        sim.SetDirection(hamiltonianSolver.Decide(sim));
+    }
+    else if (pilotMode == PilotMode::MCTS) {
+        // Half the tick, so the search never holds up the next one
+        mctsPilot->SetTimeBudget(moveInterval * 0.5);
+        sim.SetDirection(mctsPilot->Decide(sim));
+    }
+    else if (pilotMode == PilotMode::NEURAL) {
+        sim.SetDirection(neuralPolicy.Decide(sim));
+    }
     
-    // Try to find a valid position for the apple
-    bool validPosition = false;
-    int attempts = 0;
+    StepResult result = sim.Step();
     
-    while (!validPosition && attempts < 50) {
-        validPosition = true;
-        
-        // Check if position is too close to any snake segment
-        for (const auto& segment : snake.GetSegments()) {
-            if (Vector3Distance(Vector3{x, 0.5f, z}, segment) < 1.0f) {
-                validPosition = false;
-                x = (float)(rand() % (int)(arenaSize * 2) - arenaSize);
-                z = (float)(rand() % (int)(arenaSize * 2) - arenaSize);
-                break;
-            }
+    // One game per recording
+    if (recorder.IsOpen()) {
+        recorder.Record(sim);
+        if (sim.IsGameOver() && !recorder.Close()) {
+            TraceLog(LOG_WARNING, "REPLAY: writing the recording failed; it is incomplete");
         }
-        
-        // Check if position is too close to any obstacle
-        if (validPosition) {
-            for (const auto& obs : obstacles) {
-                float obstacleRadius = (obs.type == ObstacleType::TREE) ? 0.7f : 0.8f;
-                if (Vector3Distance(Vector3{x, 0.5f, z}, obs.position) < obstacleRadius + 1.0f) {
-                    validPosition = false;
-                    x = (float)(rand() % (int)(arenaSize * 2) - arenaSize);
-                    z = (float)(rand() % (int)(arenaSize * 2) - arenaSize);
-                    break;
-                }
-            }
-        }
-        
-        attempts++;
     }
     
-    applePosition = Vector3{x, 0.5f, z};
+    // Adjust speed more gradually as snake grows
+    if (result == StepResult::ATE_APPLE) {
+        moveInterval = MoveIntervalFor(sim.GetLength());
+    }
 }
 
-bool Game::CheckCollision() {
-    const auto& segments = snake.GetSegments();
-    const Vector3& head = segments.front();
-    
-    // Check collision with apple
-    if (Vector3Distance(head, applePosition) < 1.0f) {
-        snake.Grow();
-        SpawnApple();
-        score += 10;
-        
-        // Adjust speed more gradually as snake grows
-        moveInterval = fmax(0.08f, 0.2f - (snake.GetSegments().size() - 3) * 0.005f);
-        
-        return false;
-    }
+void Game::StepReplay() {
+    StepResult result = sim.Step(replay.GetDirection(replayTick, sim.GetDirection()));
+    replayTick++;
     
-    // Check collision with walls
-    if (head.x < -arenaSize || head.x > arenaSize || 
-        head.z < -arenaSize || head.z > arenaSize) {
-        return true;
+    if (result == StepResult::ATE_APPLE) {
+        moveInterval = MoveIntervalFor(sim.GetLength());
     }
+}
+
+void Game::SeekReplay(long long tick) {
+    if (tick < 0) tick = 0;
+    if (static_cast<std::uint64_t>(tick) > replay.GetTickCount()) tick = static_cast<long long>(replay.GetTickCount());
+    
+    // Nearest indexed state plus at most one block of ticks
+    replay.Seek(sim, static_cast<std::uint64_t>(tick));
+    replayTick = static_cast<std::uint64_t>(tick);
+    
+    // The tick jumped, so the visuals snap to the new body
+    epoch++;
+    moveInterval = MoveIntervalFor(sim.GetLength());
+    tickTime = Now();
+    nextTickTime = tickTime + moveInterval;
+}
+
+void Game::Publish() {
+    TRACE_ZONE("Game::Publish");
+
+    // The back slot holds an older snapshot; every field is rewritten
+    GameSnapshot& snapshot = snapshots.Back();
+    snapshot.body.clear();
+    for (const auto& segment : sim.GetBody()) {
+        snapshot.body.push_back(segment);
+    }
+    snapshot.tick = sim.GetTick();
+    snapshot.epoch = epoch;
+    snapshot.apple = sim.GetApple();
+    snapshot.hasApple = sim.HasApple();
+    snapshot.score = sim.GetScore();
+    snapshot.gameOver = sim.IsGameOver();
+    snapshot.won = sim.HasWon();
+    snapshot.pilotMode = pilotMode;
+    snapshot.replaying = replaying;
+    snapshot.replayPaused = replayPaused;
+    snapshot.replayTick = replayTick;
+    snapshot.replayTickCount = replaying ? replay.GetTickCount() : 0;
+    snapshot.tickTime = tickTime;
+    snapshot.nextTickTime = nextTickTime;
+    snapshots.Publish();
+}
+
+void Game::StopSimulation() {
+    if (simulationThread.joinable()) {
+        running.store(false, std::memory_order_release);
+        simulationThread.join();
+    }
+}
+
+void Game::Render() {
+    TRACE_ZONE("Game::Render");
+
+    BeginDrawing();
+    ClearBackground(SKYBLUE);
     
-    // Check collision with self (skip head)
-    for (size_t i = 1; i < segments.size(); ++i) {
-        if (Vector3Distance(head, segments[i]) < 0.5f) {
-            return true;
+    // Set fog parameters
+    Color fogColor = (Color){ 200, 220, 240, 255 };  // Light blue-gray fog
+    
+    Camera3D camera = cameraController.GetCamera();
+    BeginMode3D(camera);
+    
+    // What the camera sees this frame, for culling and detail levels
+    ViewFrustum view;
+    view.Update(camera, static_cast<float>(GetScreenWidth()) / GetScreenHeight(), static_cast<float>(GetScreenHeight()));
+    
+    float arenaSize = static_cast<float>(layoutConfig.arenaSize);
+    
+    // Terrain, walls, scenery and obstacles
+    {
+        TRACE_ZONE("Render::StaticWorld");
+        if (layoutConfig.chunked) {
+            staticWorld.Stream(streamLayout, current->body.front());
         }
+        staticWorld.Draw(view);
     }
     
-    // Check collision with obstacles
-    for (const auto& obs : obstacles) {
-        if (obs.type == ObstacleType::TREE) {
-            // For trees, check collision with trunk
-            Vector3 trunkPosition = Vector3{
-                obs.position.x,
-                obs.position.y + 0.4f,  // Center of trunk
-                obs.position.z
-            };
-            
-            // Use horizontal distance to check collision with trunk
-            float dx = head.x - trunkPosition.x;
-            float dz = head.z - trunkPosition.z;
-            float horizontalDistance = sqrt(dx*dx + dz*dz);
-            
-            if (horizontalDistance < 0.3f * obs.scale) {
-                return true;
-            }
-        } else {
-            // For rocks, use simple sphere collision
-            if (Vector3Distance(head, obs.position) < 0.7f * obs.scale) {
-                return true;
-            }
-        }
+    // Draw snake
+    {
+        TRACE_ZONE("Render::Snake");
+        snake.Draw(view);
     }
     
-    return false;
-}
-
-void Game::GenerateObstacles() {
-    obstacles.clear();
+    // Draw apple with slight shine effect
+    Vector3 applePosition = CellToVector3(current->apple, 0.5f);
+    if (current->hasApple && view.SphereVisible(applePosition, 0.5f)) {
+        TRACE_ZONE("Render::Apple");
+        int lod = view.SelectLod(Vector3Distance(view.GetPosition(), applePosition), 0.5f);
+        DrawMesh(appleMeshes[lod], appleMaterial, MatrixTranslate(applePosition.x, applePosition.y, applePosition.z));
+        DrawSphere(Vector3Add(applePosition, (Vector3){ 0.15f, 0.15f, 0.15f }), 0.1f, (Color){ 255, 255, 255, 180 });
+    }
     
-    // Keep a minimum distance from the center where the snake starts
-    const float minDistanceFromCenter = 4.0f;
+    // Implement manual fog effect - move it out of objects' way
+    DrawCube(Vector3{0, arenaSize * 1.5f, 0}, arenaSize*4, arenaSize*3, arenaSize*4, 
+             ColorAlpha(fogColor, 0.03f));  // More subtle and higher up
     
-    for (int i = 0; i < maxObstacles; i++) {
-        Obstacle obs;
-        
-        // Decide if it's a tree or rock
-        obs.type = (rand() % 2 == 0) ? ObstacleType::TREE : ObstacleType::ROCK;
-        
-        bool validPosition = false;
-        int attempts = 0;
-        
-        while (!validPosition && attempts < 20) {
-            // Random position within arena bounds
-            float x = (float)(rand() % (int)(arenaSize * 1.8f) - arenaSize * 0.9f);
-            float z = (float)(rand() % (int)(arenaSize * 1.8f) - arenaSize * 0.9f);
-            
-            // Check distance from center
-            if (Vector3Length(Vector3{x, 0, z}) < minDistanceFromCenter) {
-                attempts++;
-                continue;
-            }
-            
-            obs.position = Vector3{x, 0.0f, z};
-            obs.rotation = (float)(rand() % 360);
-            obs.scale = 0.8f + (rand() % 50) / 100.0f; // 0.8 to 1.3
-            
-            if (IsPositionFree(obs.position, obs.type == ObstacleType::TREE ? 1.0f : 0.8f)) {
-                validPosition = true;
-            }
-            
-            attempts++;
+    EndMode3D();
+    
+    // Draw UI
+    {
+        TRACE_ZONE("Render::UI");
+        DrawText(TextFormat("SCORE: %d", current->score), 10, 10, 20, WHITE);
+        if (current->replaying) {
+            DrawText(TextFormat("REPLAY %llu / %llu%s", static_cast<unsigned long long>(current->replayTick),
+                                static_cast<unsigned long long>(current->replayTickCount), current->replayPaused ? " (PAUSED)" : ""),
+                     10, 35, 20, YELLOW);
+        }
+        else if (current->pilotMode == PilotMode::PATHFINDER) {
+            DrawText("AUTOPILOT: PATHFINDER (P)", 10, 35, 20, YELLOW);
+        }
+        else if (current->pilotMode == PilotMode::HAMILTONIAN) {
+            DrawText("AUTOPILOT: HAMILTONIAN CYCLE (P)", 10, 35, 20, YELLOW);
+        }
+        else if (current->pilotMode == PilotMode::MCTS) {
+            DrawText("AUTOPILOT: MCTS (P)", 10, 35, 20, YELLOW);
+        }
+        else if (current->pilotMode == PilotMode::NEURAL) {
+            DrawText("AUTOPILOT: NEURAL (P)", 10, 35, 20, YELLOW);
         }
         
-        if (validPosition) {
-            obstacles.push_back(obs);
+        if (current->gameOver) {
+            const char* title = current->won ? "BOARD CLEARED" : "GAME OVER";
+            DrawText(title, GetScreenWidth()/2 - MeasureText(title, 40)/2, 
+                    GetScreenHeight()/2 - 40, 40, current->won ? GREEN : RED);
+            DrawText("PRESS R TO RESTART", GetScreenWidth()/2 - MeasureText("PRESS R TO RESTART", 20)/2, 
+                    GetScreenHeight()/2 + 10, 20, WHITE);
         }
     }
+    
+    // Buffer swap plus the frame limiter wait
+    {
+        TRACE_ZONE("Render::EndDrawing");
+        EndDrawing();
+    }
 }
 
-bool Game::IsPositionFree(const Vector3& position, float radius) {
-    // Check distance from other obstacles
-    for (const auto& obs : obstacles) {
-        if (Vector3Distance(position, obs.position) < radius * 2.0f) {
-            return false;
-        }
+void Game::Cleanup() {
+    // The simulation thread still writes the recording until it stops
+    StopSimulation();
+    if (!recorder.Close()) {
+        TraceLog(LOG_WARNING, "REPLAY: writing the recording failed; it is incomplete");
     }
+    replay.Close();
     
-    // Make sure not too close to walls - use smaller margin to allow obstacles closer to walls
-    float margin = radius * 1.2f;
-    if (position.x > arenaSize - margin || position.x < -arenaSize + margin ||
-        position.z > arenaSize - margin || position.z < -arenaSize + margin) {
-        return false;
+    // Everything goes back to the cache, which frees it while the window is still open
+    for (auto& mesh : appleMeshes) {
+        resources.Release(mesh);
     }
-    
-    return true;
+    resources.Release(appleMaterial);
+    snake.Unload();
+    staticWorld.Unload();
+    resources.Clear();
+}
+
+void Game::ReportStartup(double seconds) const {
+    TraceLog(LOG_INFO, "STARTUP: first frame %.1f ms after launch (%d meshes from %s, %d generated)",
+             seconds * 1000.0, resources.GetLoadedMeshCount(), resources.GetMeshCachePath().c_str(),
+             resources.GetGeneratedMeshCount());
 }
@@ -2,55 +2,157 @@
 #define GAME_H
 
 #include "raylib.h"
+#include "simulation.h"
 #include "snake.h"
 #include "camera_controller.h"
+#include "static_world.h"
+#include "autopilot.h"
+#include "hamiltonian_solver.h"
+#include "mcts_pilot.h"
+#include "neural_policy.h"
+#include "replay.h"
+#include "resource_cache.h"
+#include "triple_buffer.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
-enum class ObstacleType {
-    TREE,
-    ROCK
+// Who steers the snake; P cycles through them
+enum class PilotMode {
+    MANUAL,
+    PATHFINDER,
+    HAMILTONIAN,
+    MCTS,
+    NEURAL  // Only with --policy
 };
 
-struct Obstacle {
-    ObstacleType type;
-    Vector3 position;
-    float scale;
-    float rotation;
+// Command line choices
+struct GameOptions {
+    std::string recordPath;  // Record the first game to this file
+    std::string replayPath;  // Watch this recording instead of playing
+    std::string policyPath;  // Trained population (snake_train) whose best network can drive
+    int targetFps = 60;      // Render rate cap, 0 for uncapped; the tick rate does not depend on it
+    int arenaSize = 20;      // Obstacles scale with the area, at the density of the default arena
+    bool chunked = false;    // Generate and stream the arena in chunks (huge arenas)
 };
 
+// Everything the render thread draws, copied out by the simulation thread
+// after the ticks it ran, so neither thread ever reads the other's state
+struct GameSnapshot {
+    std::vector<Cell> body;        // Head first
+    unsigned long long tick = 0;
+    unsigned long long epoch = 0;  // Bumped by restarts and seeks, when ticks jump
+    Cell apple = Cell{0, 0};
+    bool hasApple = false;
+    int score = 0;
+    bool gameOver = false;
+    bool won = false;
+    PilotMode pilotMode = PilotMode::MANUAL;
+    bool replaying = false;
+    bool replayPaused = false;
+    std::uint64_t replayTick = 0;
+    std::uint64_t replayTickCount = 0;
+    double tickTime = 0.0;      // Clock time the latest tick was due
+    double nextTickTime = 0.0;  // And the next one, for blending in between
+};
+
+// Key presses sampled on the render thread, applied by the simulation thread
+enum class GameCommand {
+    TURN_UP,
+    TURN_DOWN,
+    TURN_LEFT,
+    TURN_RIGHT,
+    RESTART,
+    CYCLE_PILOT,
+    TOGGLE_PAUSE,
+    SEEK_BACK,
+    SEEK_FORWARD
+};
+
+// Renderer and input layer on top of the Simulation. The simulation ticks
+// on its own thread at a fixed rate and publishes a snapshot through a
+// triple buffer; the main thread samples input, draws the latest snapshot
+// and is the only one to touch raylib, so vsync never delays a tick.
 class Game {
 public:
-    Game();
+    explicit Game(const GameOptions& options = GameOptions());
     ~Game();
-    
+
     void Initialize();
     void Update();
     void Render();
     void Cleanup();
-    
+
+    // Logs how long the first frame took and where its meshes came from
+    void ReportStartup(double seconds) const;
+
 private:
-    void SpawnApple();
-    void GenerateObstacles();
-    bool IsPositionFree(const Vector3& position, float radius);
-    bool CheckCollision();
-    
+    // Simulation thread
+    void SimulationLoop();
+    void ApplyCommand(GameCommand command);
+    bool CanTick() const;  // Not over, paused or at the end of the replay
+    void StepGame();
+    void StepReplay();
+    void SeekReplay(long long tick);
+    void Publish();
+    double Now() const;    // Seconds on the clock both threads share
+
+    // Render thread
+    void SendCommand(GameCommand command);
+    float TickBlend(const GameSnapshot& snapshot) const;  // How far the next tick is along
+    void StopSimulation();
+
+    // Ticks one wake-up may catch up on before the backlog is dropped
+    static const int maxTicksPerWake = 8;
+
+    GameOptions options;
+    std::chrono::steady_clock::time_point clockStart;
+
+    // Owned by the simulation thread while it runs
+    Simulation sim;
+    Autopilot autopilot;
+    HamiltonianSolver hamiltonianSolver;
+    std::unique_ptr<MctsPilot> mctsPilot;  // Built when first picked: its pool takes every core
+    NeuralPolicy neuralPolicy;
+    PilotMode pilotMode;
+    ReplayWriter recorder;
+    ReplayReader replay;
+    bool replaying;
+    bool replayPaused;
+    std::uint64_t replayTick;
+    double tickTime;      // When the latest tick was due
+    double nextTickTime;  // When the next one is
+    float moveInterval;   // Seconds per tick at the current speed
+    unsigned long long epoch;
+    std::vector<GameCommand> applying;
+
+    // Shared between the two threads
+    std::thread simulationThread;
+    std::atomic<bool> running;
+    TripleBuffer<GameSnapshot> snapshots;
+    std::mutex commandMutex;  // Only held to append or swap out commands
+    std::vector<GameCommand> commands;
+
+    // Owned by the render (main) thread
+    SimConfig layoutConfig;       // Arena settings, fixed once the game runs
+    const GameSnapshot* current;  // Latest snapshot, from Update until the next Update
+    unsigned long long shownEpoch;
+    unsigned long long shownTick;
+    ResourceCache resources;      // Declared before everything that holds its meshes
     Snake snake;
     CameraController cameraController;
-    Vector3 applePosition;
-    Model appleModel;
-    Texture2D appleTexture;
-    
-    // Obstacle models
-    Model treeModel;
-    Model rockModel;
-    std::vector<Obstacle> obstacles;
-    int maxObstacles;
-    
-    float arenaSize;
-    float moveTimer;
-    float moveInterval;
-    bool gameOver;
-    int score;
+    Mesh appleMeshes[ViewFrustum::lodCount];  // Full detail first
+    Material appleMaterial;
+
+    // Pre-built meshes for everything that only changes with the obstacle layout
+    StaticWorld staticWorld;
+    // Chunked arenas: the render thread's own copy of the layout to stream
+    // obstacles from, since chunks regenerate identically from the seed
+    Simulation streamLayout;
 };
 
 #endif // GAME_H
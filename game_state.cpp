@@ -0,0 +1,268 @@
+#include "game_state.h"
+#include <cstring>
+
+// Tries at a random spawn cell before counting the free ones, as chunked
+// Simulations do
+static const int maxSpawnAttempts = 64;
+
+static Direction DirectionBetween(const Cell& from, const Cell& to) {
+    if (to.x > from.x) return Direction::RIGHT;
+    if (to.x < from.x) return Direction::LEFT;
+    return to.z > from.z ? Direction::DOWN : Direction::UP;
+}
+
+static Direction Opposite(Direction direction) {
+    switch (direction) {
+        case Direction::UP:    return Direction::DOWN;
+        case Direction::DOWN:  return Direction::UP;
+        case Direction::LEFT:  return Direction::RIGHT;
+        case Direction::RIGHT: return Direction::LEFT;
+    }
+    return direction;
+}
+
+static bool TestBit(const std::uint64_t* bits, int index) {
+    return (bits[index >> 6] >> (index & 63)) & 1;
+}
+
+static void SetBit(std::uint64_t* bits, int index) {
+    bits[index >> 6] |= std::uint64_t(1) << (index & 63);
+}
+
+static void ClearBit(std::uint64_t* bits, int index) {
+    bits[index >> 6] &= ~(std::uint64_t(1) << (index & 63));
+}
+
+GameLayout::GameLayout(const Simulation& sim) :
+    grid(sim.GetGrid()) {
+    grid.ClearSnake();
+
+    const int arenaSize = sim.GetArenaSize();
+    for (int z = -arenaSize; z <= arenaSize; ++z) {
+        for (int x = -arenaSize; x <= arenaSize; ++x) {
+            Cell cell{x, z};
+            if (sim.IsSpawnArea(cell)) {
+                spawnCells.push_back(grid.IndexOf(cell));
+            }
+        }
+    }
+}
+
+GameStateArena::GameStateArena(std::shared_ptr<const GameLayout> layout) :
+    layout(std::move(layout)),
+    blockCount(0) {
+    const int cellCount = this->layout->GetGrid().CellCount();
+    std::uint32_t ringSize = 1;
+    while (ringSize < static_cast<std::uint32_t>(cellCount)) {
+        ringSize <<= 1;
+    }
+
+    snakeWords = static_cast<std::size_t>(cellCount + 63) / 64;
+    turnMask = ringSize - 1;
+    blockWords = snakeWords + (ringSize + 31) / 32;
+}
+
+std::uint32_t GameStateArena::Allocate() {
+    if (!freeBlocks.empty()) {
+        std::uint32_t block = freeBlocks.back();
+        freeBlocks.pop_back();
+        return block;
+    }
+
+    storage.resize(storage.size() + blockWords);
+    return blockCount++;
+}
+
+GameState GameStateArena::Capture(const Simulation& sim) {
+    GameState state;
+    state.block = Allocate();
+    state.length = static_cast<std::uint32_t>(sim.GetBody().Size());
+    state.turnHead = 0;
+    state.head = sim.GetBody().Head();
+    state.tail = sim.GetBody().Tail();
+    state.apple = sim.GetApple();
+    state.direction = sim.GetDirection();
+    state.nextDirection = sim.GetDirection();
+    state.shouldGrow = sim.IsGrowing();
+    state.hasApple = sim.HasApple();
+    state.gameOver = sim.IsGameOver();
+    state.won = sim.HasWon();
+    state.score = sim.GetScore();
+    state.tick = sim.GetTick();
+    state.rng = sim.GetRandom();
+
+    std::uint64_t* block = Block(state.block);
+    std::memset(block, 0, GetBlockBytes());
+
+    const OccupancyGrid& grid = layout->GetGrid();
+    const SnakeBody& body = sim.GetBody();
+    for (std::size_t i = 0; i < body.Size(); ++i) {
+        SetBit(block, grid.IndexOf(body[i]));
+        if (i + 1 < body.Size()) {
+            SetTurn(block, static_cast<std::uint32_t>(i), DirectionBetween(body[i + 1], body[i]));
+        }
+    }
+    return state;
+}
+
+GameState GameStateArena::Fork(const GameState& state) {
+    GameState fork = state;
+    fork.block = Allocate();
+    std::memcpy(Block(fork.block), Block(state.block), GetBlockBytes());
+    return fork;
+}
+
+void GameStateArena::Restore(GameState& target, const GameState& source) {
+    const std::uint32_t block = target.block;
+    target = source;
+    target.block = block;
+    if (block != source.block) {
+        std::memcpy(Block(block), Block(source.block), GetBlockBytes());
+    }
+}
+
+void GameStateArena::Release(const GameState& state) {
+    freeBlocks.push_back(state.block);
+}
+
+void GameStateArena::Clear() {
+    // Keep the storage, so the next search reuses it without allocating
+    freeBlocks.clear();
+    for (std::uint32_t block = blockCount; block-- > 0;) {
+        freeBlocks.push_back(block);
+    }
+}
+
+void GameStateArena::SetDirection(GameState& state, Direction dir) const {
+    // Prevent 180-degree turns
+    if ((dir == Direction::LEFT && state.direction == Direction::RIGHT) ||
+        (dir == Direction::RIGHT && state.direction == Direction::LEFT) ||
+        (dir == Direction::UP && state.direction == Direction::DOWN) ||
+        (dir == Direction::DOWN && state.direction == Direction::UP)) {
+        return;
+    }
+    state.nextDirection = dir;
+}
+
+StepResult GameStateArena::Step(GameState& state, Direction action) {
+    SetDirection(state, action);
+    return Step(state);
+}
+
+StepResult GameStateArena::Step(GameState& state) {
+    if (state.gameOver) return StepResult::DIED;
+
+    state.direction = state.nextDirection;
+    state.tick++;
+
+    const OccupancyGrid& grid = layout->GetGrid();
+    std::uint64_t* block = Block(state.block);
+    const Cell head = Neighbor(state.head, state.direction);
+
+    // Growth keeps the tail in place for one tick; otherwise the tail
+    // follows the turn into the segment ahead of it
+    if (state.shouldGrow) {
+        state.shouldGrow = false;
+    } else {
+        ClearBit(block, grid.IndexOf(state.tail));
+        state.tail = Neighbor(state.tail, TurnAt(block, (state.turnHead + state.length - 2) & turnMask));
+        state.length--;
+    }
+    state.turnHead = (state.turnHead - 1) & turnMask;
+    SetTurn(block, state.turnHead, state.direction);
+    state.head = head;
+    state.length++;
+
+    // Apple is checked first, same as Simulation::Step
+    if (state.hasApple && head == state.apple) {
+        SetBit(block, grid.IndexOf(head));
+        state.shouldGrow = true;
+        state.score += 10;
+        SpawnApple(state, block);
+
+        if (!state.hasApple) {
+            state.gameOver = true;
+            state.won = true;
+        }
+        return StepResult::ATE_APPLE;
+    }
+
+    if (IsBlocked(state, grid.IndexOf(head))) {
+        state.gameOver = true;
+        return StepResult::DIED;
+    }
+
+    SetBit(block, grid.IndexOf(head));
+    return StepResult::MOVED;
+}
+
+void GameStateArena::SpawnApple(GameState& state, const std::uint64_t* block) {
+    const std::vector<int>& spawnCells = layout->GetSpawnCells();
+    const std::uint32_t count = static_cast<std::uint32_t>(spawnCells.size());
+    if (count == 0) {
+        state.hasApple = false;
+        return;
+    }
+
+    // A uniform draw retried until it misses the body picks from the same
+    // spots as the Simulation's free list
+    for (int attempt = 0; attempt < maxSpawnAttempts; ++attempt) {
+        int index = spawnCells[state.rng.NextBelow(count)];
+        if (!TestBit(block, index)) {
+            state.apple = layout->GetGrid().CellAt(index);
+            state.hasApple = true;
+            return;
+        }
+    }
+
+    // Nearly full board: count what is left and pick one of those
+    std::uint32_t spots = 0;
+    for (int index : spawnCells) {
+        spots += TestBit(block, index) ? 0 : 1;
+    }
+    if (spots == 0) {
+        state.hasApple = false;
+        return;
+    }
+
+    std::uint32_t pick = state.rng.NextBelow(spots);
+    for (int index : spawnCells) {
+        if (TestBit(block, index)) continue;
+        if (pick-- == 0) {
+            state.apple = layout->GetGrid().CellAt(index);
+            state.hasApple = true;
+            return;
+        }
+    }
+}
+
+bool GameStateArena::IsBlocked(const GameState& state, const Cell& cell) const {
+    return IsBlocked(state, layout->GetGrid().IndexOf(cell));
+}
+
+bool GameStateArena::IsBlocked(const GameState& state, int index) const {
+    return layout->GetGrid().IsStatic(index) || TestBit(Block(state.block), index);
+}
+
+void GameStateArena::CopyBody(const GameState& state, std::vector<Cell>& out) const {
+    const std::uint64_t* block = Block(state.block);
+
+    out.clear();
+    Cell cell = state.head;
+    out.push_back(cell);
+    for (std::uint32_t i = 0; i + 1 < state.length; ++i) {
+        cell = Neighbor(cell, Opposite(TurnAt(block, (state.turnHead + i) & turnMask)));
+        out.push_back(cell);
+    }
+}
+
+Direction GameStateArena::TurnAt(const std::uint64_t* block, std::uint32_t slot) const {
+    const std::uint64_t word = block[snakeWords + (slot >> 5)];
+    return static_cast<Direction>((word >> ((slot & 31) * 2)) & 3);
+}
+
+void GameStateArena::SetTurn(std::uint64_t* block, std::uint32_t slot, Direction turn) const {
+    std::uint64_t& word = block[snakeWords + (slot >> 5)];
+    const int shift = (slot & 31) * 2;
+    word = (word & ~(std::uint64_t(3) << shift)) | (static_cast<std::uint64_t>(turn) << shift);
+}
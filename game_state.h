@@ -0,0 +1,103 @@
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// The part of a dense Simulation that never changes during a game: walls,
+// obstacles and where apples may spawn. Built once and shared read-only by
+// every GameState forked from that game.
+class GameLayout {
+public:
+    explicit GameLayout(const Simulation& sim);  // Dense arenas only
+
+    const OccupancyGrid& GetGrid() const { return grid; }  // Walls and obstacles, no snake
+    const std::vector<int>& GetSpawnCells() const { return spawnCells; }
+    int GetArenaSize() const { return grid.GetArenaSize(); }
+
+private:
+    OccupancyGrid grid;
+    std::vector<int> spawnCells;  // Grid indices apples may ever go to
+};
+
+// Everything that changes while playing, in a fixed-size value that copies
+// with memcpy. The body lives in a block of the GameStateArena the state
+// came from: a snake bitboard plus one 2-bit turn per segment, so any
+// length fits without the state growing. A plain copy shares that block -
+// use GameStateArena::Fork for a state that can move on its own.
+struct GameState {
+    std::uint32_t block;     // Body block in the owning arena
+    std::uint32_t length;
+    std::uint32_t turnHead;  // Ring slot of the turn into the head; segment i's turn is i slots on
+    Cell head;
+    Cell tail;
+    Cell apple;
+    Direction direction;
+    Direction nextDirection;
+    bool shouldGrow;
+    bool hasApple;
+    bool gameOver;
+    bool won;
+    int score;
+    unsigned long long tick;
+    RandomStream rng;        // Apple respawns; reseed a fork to sample another future
+};
+
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must copy with memcpy");
+
+// Body blocks for many GameStates on one layout, for searches that fork a
+// game thousands of times per decision. Blocks are recycled through a free
+// list and never freed one by one, so forking and stepping allocate
+// nothing once the arena has grown to the search's size.
+//
+// Forks play by the Simulation rules, except that apples respawn by
+// rejection sampling from the state's own stream rather than from the
+// Simulation's free list. A fork therefore matches the real game exactly
+// until the next apple is eaten; after that it samples one of the possible
+// futures, which is what lookahead wants anyway.
+class GameStateArena {
+public:
+    explicit GameStateArena(std::shared_ptr<const GameLayout> layout);
+
+    // Snapshot of a live game on this arena's layout. A turn queued since
+    // the last step is not carried over; searches pick their own.
+    GameState Capture(const Simulation& sim);
+    GameState Fork(const GameState& state);    // Independent copy in a new block
+    void Restore(GameState& target, const GameState& source);  // Target becomes source, keeping its own block
+    void Release(const GameState& state);      // Its block goes back to the free list
+    void Clear();                              // Releases every state at once
+
+    void SetDirection(GameState& state, Direction dir) const;  // Same 180-degree rule as Simulation
+    StepResult Step(GameState& state);
+    StepResult Step(GameState& state, Direction action);
+
+    bool IsBlocked(const GameState& state, const Cell& cell) const;  // Cell in the arena or on its border
+    bool IsBlocked(const GameState& state, int index) const;
+    void CopyBody(const GameState& state, std::vector<Cell>& out) const;  // Head first
+
+    const GameLayout& GetLayout() const { return *layout; }
+    std::size_t GetBlockBytes() const { return blockWords * sizeof(std::uint64_t); }
+    std::size_t GetBlocksInUse() const { return blockCount - freeBlocks.size(); }
+
+private:
+    std::uint64_t* Block(std::uint32_t block) { return &storage[block * blockWords]; }
+    const std::uint64_t* Block(std::uint32_t block) const { return &storage[block * blockWords]; }
+    std::uint32_t Allocate();
+    Direction TurnAt(const std::uint64_t* block, std::uint32_t slot) const;
+    void SetTurn(std::uint64_t* block, std::uint32_t slot, Direction turn) const;
+    void SpawnApple(GameState& state, const std::uint64_t* block);
+
+    std::shared_ptr<const GameLayout> layout;
+    std::size_t snakeWords;  // Bitboard over the layout's grid
+    std::size_t blockWords;  // Bitboard plus the turn ring
+    std::uint32_t turnMask;  // Ring size minus one; the ring holds one turn per grid cell
+    std::vector<std::uint64_t> storage;
+    std::vector<std::uint32_t> freeBlocks;
+    std::uint32_t blockCount;
+};
+
+#endif // GAME_STATE_H
@@ -0,0 +1,290 @@
+#include "hamiltonian_cycle.h"
+#include <numeric>
+
+// Union-find root lookup with path halving
+static int FindRoot(std::vector<int>& parent, int node) {
+    while (parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+HamiltonianCycle::HamiltonianCycle() {
+}
+
+void HamiltonianCycle::Clear() {
+    order.clear();
+    cells.clear();
+}
+
+bool HamiltonianCycle::Build(const OccupancyGrid& grid, const Cell& runStart, int runLength) {
+    Clear();
+
+    const int arenaSize = grid.GetArenaSize();
+    const int side = arenaSize * 2;  // Cells per side of the tour square
+    const int blocks = arenaSize;    // 2x2 blocks per side
+    if (blocks < 1) return false;
+
+    auto inSquare = [&](const Cell& cell) {
+        return cell.x >= -arenaSize && cell.x < arenaSize && cell.z >= -arenaSize && cell.z < arenaSize;
+    };
+    auto localIndex = [&](int x, int z) { return (z + arenaSize) * side + (x + arenaSize); };
+    auto blockOf = [&](const Cell& cell) { return ((cell.z + arenaSize) / 2) * blocks + (cell.x + arenaSize) / 2; };
+
+    // A block is usable when none of its four cells is a wall or obstacle
+    std::vector<char> usable(blocks * blocks, 0);
+    for (int j = 0; j < blocks; ++j) {
+        for (int i = 0; i < blocks; ++i) {
+            int x = -arenaSize + i * 2;
+            int z = -arenaSize + j * 2;
+            usable[j * blocks + i] = !grid.IsStatic(Cell{x, z}) && !grid.IsStatic(Cell{x + 1, z}) &&
+                                     !grid.IsStatic(Cell{x, z + 1}) && !grid.IsStatic(Cell{x + 1, z + 1});
+        }
+    }
+
+    // Tree edges from a block to its right and lower neighbor
+    std::vector<char> rightEdge(blocks * blocks, 0);
+    std::vector<char> downEdge(blocks * blocks, 0);
+    std::vector<char> downForbidden(blocks * blocks, 0);
+
+    std::vector<int> parent(blocks * blocks);
+    std::iota(parent.begin(), parent.end(), 0);
+
+    // Keep the run straight: a step across blocks must be a tree edge (which
+    // bridges the two blocks along this row), and a step inside a block must
+    // keep that block's side on this row, so the block may not grow a tree
+    // edge out through it
+    for (int k = 0; k + 1 < runLength; ++k) {
+        Cell from{runStart.x + k, runStart.z};
+        Cell to{runStart.x + k + 1, runStart.z};
+        if (!inSquare(from) || !inSquare(to)) return false;
+
+        int fromBlock = blockOf(from);
+        int toBlock = blockOf(to);
+        if (!usable[fromBlock] || !usable[toBlock]) return false;
+
+        if (fromBlock != toBlock) {
+            rightEdge[fromBlock] = 1;
+            parent[FindRoot(parent, fromBlock)] = FindRoot(parent, toBlock);
+        } else if ((runStart.z + arenaSize) % 2 == 0) {
+            if (fromBlock >= blocks) downForbidden[fromBlock - blocks] = 1;
+        } else {
+            downForbidden[fromBlock] = 1;
+        }
+    }
+
+    if (!inSquare(runStart) || !usable[blockOf(runStart)]) return false;
+
+    // Breadth-first spanning tree over the usable blocks reachable from the run
+    std::vector<char> inTree(blocks * blocks, 0);
+    std::vector<int> queue;
+    queue.reserve(blocks * blocks);
+
+    int startBlock = blockOf(runStart);
+    inTree[startBlock] = 1;
+    queue.push_back(startBlock);
+
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        int block = queue[head];
+        int i = block % blocks;
+        int j = block / blocks;
+
+        // Neighbor block and the flag that records the edge to it
+        struct Link { bool valid; int neighbor; char* edge; bool forbidden; };
+        Link links[4] = {
+            { i + 1 < blocks, block + 1, i + 1 < blocks ? &rightEdge[block] : nullptr, false },
+            { i > 0, block - 1, i > 0 ? &rightEdge[block - 1] : nullptr, false },
+            { j + 1 < blocks, block + blocks, j + 1 < blocks ? &downEdge[block] : nullptr,
+              j + 1 < blocks && downForbidden[block] },
+            { j > 0, block - blocks, j > 0 ? &downEdge[block - blocks] : nullptr,
+              j > 0 && downForbidden[block - blocks] },
+        };
+
+        for (const Link& link : links) {
+            if (!link.valid || link.forbidden || !usable[link.neighbor]) continue;
+
+            int rootA = FindRoot(parent, block);
+            int rootB = FindRoot(parent, link.neighbor);
+            if (rootA != rootB) {
+                parent[rootA] = rootB;
+                *link.edge = 1;
+            }
+            if (!inTree[link.neighbor]) {
+                inTree[link.neighbor] = 1;
+                queue.push_back(link.neighbor);
+            }
+        }
+    }
+
+    // Each tree block is a small 2x2 loop; a tree edge cuts the two facing
+    // sides and bridges the loops, which keeps the union a single loop
+    std::vector<char> horizontal(side * side, 0);  // Cell to its right neighbor
+    std::vector<char> vertical(side * side, 0);    // Cell to its lower neighbor
+
+    for (int block : queue) {
+        int x = -arenaSize + (block % blocks) * 2;
+        int z = -arenaSize + (block / blocks) * 2;
+        horizontal[localIndex(x, z)] = 1;
+        horizontal[localIndex(x, z + 1)] = 1;
+        vertical[localIndex(x, z)] = 1;
+        vertical[localIndex(x + 1, z)] = 1;
+    }
+
+    for (int block : queue) {
+        int x = -arenaSize + (block % blocks) * 2;
+        int z = -arenaSize + (block / blocks) * 2;
+
+        if (rightEdge[block]) {
+            vertical[localIndex(x + 1, z)] = 0;
+            vertical[localIndex(x + 2, z)] = 0;
+            horizontal[localIndex(x + 1, z)] = 1;
+            horizontal[localIndex(x + 1, z + 1)] = 1;
+        }
+        if (downEdge[block]) {
+            horizontal[localIndex(x, z + 1)] = 0;
+            horizontal[localIndex(x, z + 2)] = 0;
+            vertical[localIndex(x, z + 1)] = 1;
+            vertical[localIndex(x + 1, z + 1)] = 1;
+        }
+    }
+
+    // Walk the loop starting along the run so positions increase towards +x
+    order.assign(grid.CellCount(), -1);
+    cells.reserve(queue.size() * 4);
+
+    Cell previous = runStart;
+    Cell current = runLength > 1 ? Cell{runStart.x + 1, runStart.z} : runStart;
+    if (runLength <= 1) {
+        // No direction to keep - leave through whichever side is linked
+        int local = localIndex(runStart.x, runStart.z);
+        if (horizontal[local]) current.x += 1;
+        else if (vertical[local]) current.z += 1;
+        else current.x -= 1;
+    }
+
+    cells.push_back(grid.IndexOf(previous));
+    while (current != runStart) {
+        cells.push_back(grid.IndexOf(current));
+        if (cells.size() > queue.size() * 4) break;
+
+        int local = localIndex(current.x, current.z);
+        Cell candidates[4] = {
+            Cell{current.x + 1, current.z}, Cell{current.x - 1, current.z},
+            Cell{current.x, current.z + 1}, Cell{current.x, current.z - 1},
+        };
+        bool linked[4] = {
+            horizontal[local] != 0,
+            current.x > -arenaSize && horizontal[local - 1] != 0,
+            vertical[local] != 0,
+            current.z > -arenaSize && vertical[local - side] != 0,
+        };
+
+        Cell next = current;
+        for (int k = 0; k < 4; ++k) {
+            if (linked[k] && candidates[k] != previous) {
+                next = candidates[k];
+                break;
+            }
+        }
+        previous = current;
+        current = next;
+    }
+
+    // Every tree block contributes four cells; anything else means a broken loop
+    if (cells.size() != queue.size() * 4) {
+        Clear();
+        return false;
+    }
+
+    // Grow the loop into the cells the blocks left out (around obstacles,
+    // cut-off corners, the last row and column): a tour step u -> v becomes
+    // u -> a -> ... -> b -> v through free cells off the tour, two beside
+    // the step when they are there, else the shortest way round from a
+    // neighbor of u to one of v. The run's own steps are left alone so it
+    // stays consecutive.
+    const int count = static_cast<int>(cells.size());
+    std::vector<int> next(grid.CellCount(), -1);
+    std::vector<char> inRun(grid.CellCount(), 0);
+    for (int position = 0; position < count; ++position) {
+        next[cells[position]] = cells[(position + 1) % count];
+    }
+    for (int position = 0; position + 1 < runLength && position < count; ++position) {
+        inRun[cells[position]] = 1;
+    }
+
+    // Walls ring the arena, so a tour cell's neighbors are always in the grid
+    const int offsets[4] = { 1, -1, grid.GetWidth(), -grid.GetWidth() };
+    auto spare = [&](int index) { return next[index] < 0 && !grid.IsStatic(index); };
+
+    std::vector<int> from(grid.CellCount(), -1);
+    std::vector<int> visited;
+    auto detour = [&](int u, int v) {
+        for (int first : offsets) {
+            int start = u + first;
+            if (!spare(start)) continue;
+
+            for (int index : visited) from[index] = -1;
+            visited.assign(1, start);
+            from[start] = start;
+
+            for (std::size_t i = 0; i < visited.size(); ++i) {
+                int current = visited[i];
+                for (int offset : offsets) {
+                    if (current + offset == v) {
+                        // Splice the path in, walking back from its end
+                        next[current] = v;
+                        for (int cell = current; cell != start; cell = from[cell]) {
+                            next[from[cell]] = cell;
+                        }
+                        next[u] = start;
+                        return true;
+                    }
+                }
+                for (int offset : offsets) {
+                    int neighbor = current + offset;
+                    if (from[neighbor] >= 0 || !spare(neighbor)) continue;
+                    from[neighbor] = current;
+                    visited.push_back(neighbor);
+                }
+            }
+        }
+        return false;
+    };
+
+    for (bool grown = true; grown;) {
+        grown = false;
+        for (int u = 0; u < grid.CellCount(); ++u) {
+            int v = next[u];
+            if (v < 0 || inRun[u]) continue;
+
+            int step = v - u;
+            int side = step == 1 || step == -1 ? grid.GetWidth() : 1;
+            if (spare(u + side) && spare(v + side)) {
+                next[u] = u + side;
+                next[u + side] = v + side;
+                next[v + side] = v;
+                grown = true;
+            } else if (spare(u - side) && spare(v - side)) {
+                next[u] = u - side;
+                next[u - side] = v - side;
+                next[v - side] = v;
+                grown = true;
+            }
+        }
+        for (int u = 0; !grown && u < grid.CellCount(); ++u) {
+            if (next[u] >= 0 && !inRun[u]) grown = detour(u, next[u]);
+        }
+    }
+
+    const int start = cells[0];
+    cells.clear();
+    for (int index = start; cells.empty() || index != start; index = next[index]) {
+        cells.push_back(index);
+    }
+
+    for (std::size_t position = 0; position < cells.size(); ++position) {
+        order[cells[position]] = static_cast<int>(position);
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef HAMILTONIAN_CYCLE_H
+#define HAMILTONIAN_CYCLE_H
+
+#include "occupancy_grid.h"
+#include <vector>
+
+// Closed tour through most free cells of the arena. The even-sized square
+// -arenaSize..arenaSize-1 is cut into 2x2 blocks, a spanning tree is grown
+// over the blocks without obstacles, and the tour walks around that tree.
+// It is then widened into the cells the blocks left out - around
+// obstacles, in corners the tree could not reach, along the last row and
+// column - wherever a detour through them fits between two consecutive
+// tour cells. Some free cells can stay off the tour (OrderOf is -1 there),
+// and apples may spawn on them.
+class HamiltonianCycle {
+public:
+    HamiltonianCycle();
+
+    // Builds the tour over the grid's static layout. The runLength cells from
+    // runStart towards +x are kept consecutive in tour order, so a snake
+    // spawned on that row already lies on the tour. Returns false if no tour
+    // through runStart exists.
+    bool Build(const OccupancyGrid& grid, const Cell& runStart, int runLength);
+    void Clear();
+
+    bool Empty() const { return cells.empty(); }
+    int Length() const { return static_cast<int>(cells.size()); }
+
+    // Position along the tour by grid index, -1 for cells not on it
+    int OrderOf(int index) const { return order[index]; }
+    int CellAtOrder(int position) const { return cells[position]; }
+
+    // Steps needed to go from one tour position to another
+    int Distance(int from, int to) const {
+        int distance = to - from;
+        return distance < 0 ? distance + Length() : distance;
+    }
+
+private:
+    std::vector<int> order;  // Grid index -> tour position
+    std::vector<int> cells;  // Tour position -> grid index
+};
+
+#endif // HAMILTONIAN_CYCLE_H
@@ -0,0 +1,358 @@
+#include "hamiltonian_solver.h"
+#include "trace.h"
+#include <algorithm>
+
+static Direction DirectionTo(const Cell& from, const Cell& to) {
+    if (to.x > from.x) return Direction::RIGHT;
+    if (to.x < from.x) return Direction::LEFT;
+    return to.z > from.z ? Direction::DOWN : Direction::UP;
+}
+
+HamiltonianSolver::HamiltonianSolver() :
+    layoutArenaSize(-1),
+    cycleBuilds(0),
+    engaged(false),
+    lastTick(0),
+    mode(Mode::FALLBACK),
+    trackedHead{0, 0},
+    trackedTail{0, 0},
+    trackedLength(0),
+    brokenLinks(0),
+    span(0),
+    excursionStep(0) {
+}
+
+void HamiltonianSolver::Reset() {
+    engaged = false;
+    mode = Mode::FALLBACK;
+    excursion.clear();
+    fallback.Reset();
+}
+
+Direction HamiltonianSolver::Decide(const Simulation& sim) {
+    TRACE_ZONE("HamiltonianSolver::Decide");
+
+    // A new game, a reset or a gap in our decisions - look at the board again.
+    // Otherwise exactly one step happened since the last decision.
+    if (!engaged || sim.GetTick() != lastTick + 1) {
+        PrepareCycle(sim);
+        RescanBody(sim);
+        excursion.clear();
+        fallback.Reset();
+        mode = BodyInOrder(sim) ? Mode::CYCLE : Mode::FALLBACK;
+    } else {
+        TrackBody(sim);
+    }
+    engaged = true;
+    lastTick = sim.GetTick();
+
+    const OccupancyGrid& grid = sim.GetGrid();
+
+    if (mode == Mode::EXCURSION && excursionStep == excursion.size()) {
+        mode = Mode::RETURNING;
+    }
+    if (mode == Mode::RETURNING || mode == Mode::FALLBACK) {
+        if (BodyInOrder(sim)) mode = Mode::CYCLE;
+    } else if (mode == Mode::CYCLE && !BodyInOrder(sim)) {
+        mode = Mode::FALLBACK;
+        fallback.Reset();
+    }
+
+    // An apple the cycle never reaches is fetched by a detour that starts
+    // from the body in order; until one fits, keep riding the cycle
+    if (mode == Mode::CYCLE && sim.HasApple() && cycle.OrderOf(grid.IndexOf(sim.GetApple())) < 0 &&
+        PlanExcursion(sim)) {
+        mode = Mode::EXCURSION;
+    }
+
+    if (mode == Mode::EXCURSION) {
+        const Cell next = excursion[excursionStep];
+        if (!grid.IsBlocked(next)) {
+            excursionStep++;
+            return DirectionTo(sim.GetHead(), next);
+        }
+        // Cannot happen for a plan made from an ordered body, but never walk into something
+        excursion.clear();
+        mode = Mode::FALLBACK;
+        fallback.Reset();
+    }
+
+    switch (mode) {
+    case Mode::CYCLE: return FollowCycle(sim, true);
+    case Mode::RETURNING: return FollowCycle(sim, false);
+    default: return fallback.Decide(sim);
+    }
+}
+
+bool HamiltonianSolver::IsFollowingCycle() const {
+    return mode == Mode::CYCLE || mode == Mode::RETURNING;
+}
+
+int HamiltonianSolver::GetCycleLength() const {
+    return cycle.Length();
+}
+
+unsigned long long HamiltonianSolver::GetCycleBuilds() const {
+    return cycleBuilds;
+}
+
+void HamiltonianSolver::PrepareCycle(const Simulation& sim) {
+    const std::vector<Obstacle>& obstacles = sim.GetObstacles();
+
+    bool sameLayout = layoutArenaSize == sim.GetArenaSize() && layoutKey.size() == obstacles.size();
+    for (std::size_t i = 0; sameLayout && i < obstacles.size(); ++i) {
+        sameLayout = layoutKey[i] == obstacles[i].cell;
+    }
+    if (sameLayout) return;
+
+    layoutArenaSize = sim.GetArenaSize();
+    layoutKey.clear();
+    for (const auto& obs : obstacles) {
+        layoutKey.push_back(obs.cell);
+    }
+
+    // Keep the spawn row (-2,0) -> (0,0) in order so new games start on the cycle
+    cycle.Build(sim.GetGrid(), Cell{-2, 0}, 3);
+    cycleBuilds++;
+}
+
+int HamiltonianSolver::LinkStep(const OccupancyGrid& grid, const Cell& behind, const Cell& ahead) const {
+    int from = cycle.OrderOf(grid.IndexOf(behind));
+    int to = cycle.OrderOf(grid.IndexOf(ahead));
+    if (from < 0 || to < 0) return 0;
+    return cycle.Distance(from, to);  // 0 only for the same cell
+}
+
+void HamiltonianSolver::AddLink(int step, int sign) {
+    if (step == 0) {
+        brokenLinks += sign;
+    } else {
+        span += sign * step;
+    }
+}
+
+void HamiltonianSolver::RescanBody(const Simulation& sim) {
+    const OccupancyGrid& grid = sim.GetGrid();
+    const SnakeBody& body = sim.GetBody();
+
+    brokenLinks = 0;
+    span = 0;
+    if (!cycle.Empty()) {
+        for (std::size_t i = body.Size() - 1; i-- > 0;) {
+            AddLink(LinkStep(grid, body[i + 1], body[i]), 1);
+        }
+    }
+
+    trackedHead = body.Head();
+    trackedTail = body.Tail();
+    trackedLength = sim.GetLength();
+}
+
+void HamiltonianSolver::TrackBody(const Simulation& sim) {
+    if (cycle.Empty()) return;
+
+    const OccupancyGrid& grid = sim.GetGrid();
+    const SnakeBody& body = sim.GetBody();
+
+    // One step: a link onto the new head, and unless the snake grew, the
+    // link from the old tail to the segment that is now the tail goes away
+    if (sim.GetLength() == trackedLength) {
+        AddLink(LinkStep(grid, trackedHead, body.Head()), 1);
+        AddLink(LinkStep(grid, trackedTail, body.Tail()), -1);
+    } else if (sim.GetLength() == trackedLength + 1) {
+        AddLink(LinkStep(grid, trackedHead, body.Head()), 1);
+    } else {
+        RescanBody(sim);
+        return;
+    }
+
+    trackedHead = body.Head();
+    trackedTail = body.Tail();
+    trackedLength = sim.GetLength();
+}
+
+bool HamiltonianSolver::BodyInOrder(const Simulation& sim) const {
+    if (cycle.Empty() || cycle.OrderOf(sim.GetGrid().IndexOf(sim.GetHead())) < 0) return false;
+
+    // Tail to head, every segment sits further along the cycle than the one
+    // behind it, without wrapping all the way around
+    return brokenLinks == 0 && span < cycle.Length();
+}
+
+bool HamiltonianSolver::PlanExcursion(const Simulation& sim) {
+    const OccupancyGrid& grid = sim.GetGrid();
+    const int offsets[4] = { -grid.GetWidth(), grid.GetWidth(), -1, 1 };
+    const int headIndex = grid.IndexOf(sim.GetHead());
+    const int appleIndex = grid.IndexOf(sim.GetApple());
+    const int headOrder = cycle.OrderOf(headIndex);
+    const int toTail = sim.GetLength() > 1
+        ? cycle.Distance(headOrder, cycle.OrderOf(grid.IndexOf(sim.GetBody().Tail())))
+        : cycle.Length();
+    const int owed = sim.IsGrowing() ? 1 : 0;
+
+    // Steps from the head to a free cell of the head-to-tail gap, 0 for any
+    // other cell on the tour, -1 for a free cell off the tour. Walls ring the
+    // arena, so neighbors of searched cells stay in the grid.
+    auto gapDistance = [&](int index) {
+        if (grid.IsBlocked(index)) return 0;
+        int order = cycle.OrderOf(index);
+        if (order < 0) return -1;
+        int distance = cycle.Distance(headOrder, order);
+        return distance < toTail ? distance : 0;
+    };
+
+    // Only worth a search once the head can step off the tour
+    bool nextToOffTour = false;
+    for (int offset : offsets) {
+        nextToOffTour = nextToOffTour || gapDistance(headIndex + offset) < 0;
+    }
+    if (!nextToOffTour) return false;
+
+    // Each searched cell remembers the furthest gap cell on its path
+    // (searchReach), the path length (searchDepth) and, over the gap cells
+    // on it, the largest entry tick minus distance from the head (searchLag)
+    const int noLag = -cycle.Length();
+    searchParent.assign(grid.CellCount(), -1);
+    searchReach.assign(grid.CellCount(), 0);
+    searchDepth.assign(grid.CellCount(), 0);
+    searchLag.assign(grid.CellCount(), noLag);
+
+    auto visit = [&](int from, int next, int distance, int depth) {
+        searchParent[next] = from;
+        searchDepth[next] = depth;
+        searchReach[next] = std::max(searchReach[from], distance);
+        searchLag[next] = distance > 0 ? std::max(searchLag[from], depth - distance) : searchLag[from];
+        searchQueue.push_back(next);
+    };
+
+    // Out: head to apple, off the tour and through the gap
+    searchQueue.clear();
+    searchParent[headIndex] = headIndex;
+    searchQueue.push_back(headIndex);
+    for (std::size_t i = 0; i < searchQueue.size() && searchParent[appleIndex] < 0; ++i) {
+        int current = searchQueue[i];
+        for (int offset : offsets) {
+            int next = current + offset;
+            int distance = gapDistance(next);
+            if (searchParent[next] >= 0 || distance == 0) continue;
+            visit(current, next, distance, searchDepth[current] + 1);
+        }
+    }
+    if (searchParent[appleIndex] < 0) return false;
+
+    excursion.clear();
+    for (int index = appleIndex; index != headIndex; index = searchParent[index]) {
+        excursion.push_back(grid.CellAt(index));
+    }
+    std::reverse(excursion.begin(), excursion.end());
+    const int outLength = searchDepth[appleIndex];
+
+    // Back: apple to a gap cell R further along than any gap cell used, not
+    // crossing the way out. From R the snake rides the cycle again; the cells
+    // up to the tail are free, and the rest hold the old body in order and,
+    // a lap away, the gap cells used. A cell entered on tick t is left by the
+    // tail once it has moved length + t times, but the tail stalls once per
+    // apple eaten: the current grow step, this apple, and at worst one more
+    // per cell of the way back. Counting the ticks the head needs to come
+    // round to each of those cells, R is safe when the cells from it to the
+    // tail number at least 2 + owed - outLength for the old body, and that
+    // plus lag for the gap cells used (R included), lag being the largest
+    // entry tick minus distance from the head over them, with entry ticks
+    // counted from 1 at the first step out.
+    std::fill(searchParent.begin(), searchParent.end(), -1);
+    for (const Cell& cell : excursion) {
+        searchParent[grid.IndexOf(cell)] = headIndex;
+    }
+    searchQueue.clear();
+    searchQueue.push_back(appleIndex);
+
+    int entry = -1;
+    for (std::size_t i = 0; i < searchQueue.size() && entry < 0; ++i) {
+        int current = searchQueue[i];
+        for (int offset : offsets) {
+            int next = current + offset;
+            int distance = gapDistance(next);
+            if (searchParent[next] >= 0 || distance == 0) continue;
+
+            visit(current, next, distance, searchDepth[current] + 1);
+            if (distance > searchReach[current]) {
+                int room = toTail - distance;
+                int lag = std::max(0, searchLag[next]);
+                if (room >= 2 + owed - outLength + lag) {
+                    entry = next;
+                    break;
+                }
+            }
+        }
+    }
+    if (entry < 0) {
+        excursion.clear();
+        return false;
+    }
+
+    for (int index = entry; index != appleIndex; index = searchParent[index]) {
+        excursion.push_back(grid.CellAt(index));
+    }
+    std::reverse(excursion.begin() + outLength, excursion.end());
+    excursionStep = 0;
+    return true;
+}
+
+Direction HamiltonianSolver::FollowCycle(const Simulation& sim, bool allowCuts) const {
+    const OccupancyGrid& grid = sim.GetGrid();
+    const Cell head = sim.GetHead();
+    const int length = cycle.Length();
+    const int headOrder = cycle.OrderOf(grid.IndexOf(head));
+
+    // Default move: the next cell on the cycle, which is free or the tail
+    int bestOrder = (headOrder + 1) % length;
+    int bestDistance = 1;
+
+    // Shortcut budget after Tapsell: stay short of the tail with room for all
+    // the growth still owed (a pending grow step and the apple's), keep extra
+    // room when another apple could pop up right behind this one, and stop
+    // cutting once the snake fills half the free cells. Near a full board
+    // apples land just ahead of the head on back-to-back grow steps often
+    // enough that a tighter gap loses games.
+    const int growth = 1 + (sim.IsGrowing() ? 1 : 0);
+    const int emptyCells = length - sim.GetLength() - growth - 1;
+
+    int budget = 0;
+    if (allowCuts && sim.HasApple() && emptyCells >= length / 2) {
+        const int appleOrder = cycle.OrderOf(grid.IndexOf(sim.GetApple()));
+        const int toTail = sim.GetLength() > 1
+            ? cycle.Distance(headOrder, cycle.OrderOf(grid.IndexOf(sim.GetBody().Tail())))
+            : length;
+        const int toApple = appleOrder >= 0 ? cycle.Distance(headOrder, appleOrder) : 0;
+
+        budget = toTail - growth - 3;
+        if (toApple < toTail) {
+            // The apple will be eaten before the tail is reached
+            budget -= growth;
+
+            // Another apple can pop up right after it, keep plenty of room
+            if ((toTail - toApple) * 4 > emptyCells) {
+                budget -= 10;
+            }
+        }
+        if (budget > toApple) budget = toApple;
+    }
+
+    const Direction directions[4] = { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT };
+    for (Direction direction : directions) {
+        int index = grid.IndexOf(Neighbor(head, direction));
+        if (grid.IsBlocked(index)) continue;
+
+        int order = cycle.OrderOf(index);
+        if (order < 0) continue;
+
+        // Inside the gap, never past the apple
+        int distance = cycle.Distance(headOrder, order);
+        if (distance > bestDistance && distance <= budget) {
+            bestOrder = order;
+            bestDistance = distance;
+        }
+    }
+
+    return DirectionTo(head, grid.CellAt(cycle.CellAtOrder(bestOrder)));
+}
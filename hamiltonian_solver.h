@@ -0,0 +1,104 @@
+#ifndef HAMILTONIAN_SOLVER_H
+#define HAMILTONIAN_SOLVER_H
+
+#include "simulation.h"
+#include "hamiltonian_cycle.h"
+#include "autopilot.h"
+#include <vector>
+
+// Plays for the full board: the snake rides a Hamiltonian cycle and cuts
+// across it towards the apple. With the body in cycle order (every segment
+// further along the cycle than the one behind it, less than one lap from
+// tail to head) the cells between the head and the tail are free, so the
+// next cycle cell is always free or a tail that moves away.
+//
+// A cut is only taken when it lands inside that head-to-tail gap, short of
+// the apple, and leaves a buffer in front of the tail for all the growth
+// still owed (a pending grow step and the apple's) plus a few cells - more
+// when the apple is eaten well before the tail, since the next one can pop
+// up right behind it. Once the snake fills half the free cells there are no
+// more cuts at all. Cuts keep the body in cycle order.
+//
+// Apples off the tour are fetched with an excursion planned from a state on
+// the cycle: out to the apple and back in onto a gap cell, through cells off
+// the tour and gap cells, re-entering past every gap cell used and far
+// enough in front of the tail that the tail has left the old body - and, a
+// lap later, the path - before the head comes round, even if the tail
+// stalls for every apple the excursion could eat. The snake then rides the
+// cycle without cutting until the excursion has left the body. Whether the
+// body is in cycle order is tracked per tick from the cells that entered
+// and left it, so each decision is a handful of table lookups; only a
+// resync (new game, missed ticks) walks the body, and an excursion is only
+// searched for while the head is next to a cell off the tour.
+//
+// Deviations from a proof of safety:
+// - Cuts leave skipped cells behind the head. If apples then keep landing
+//   directly in front of it on consecutive grow steps, the gap can run out
+//   before the tail reaches those cells. The buffer and the half-board
+//   cutoff make that rare rather than impossible.
+// - A body that is not in cycle order and was not left by an excursion
+//   (manual play before the hand-off) is driven by the pathfinder until it
+//   lines up, as the cycle gives no guarantees for it.
+// - An apple off the tour that no excursion can safely reach (a tight gap,
+//   a pocket with one way in) is waited for on the cycle; if none ever
+//   fits, the game runs until its tick limit.
+class HamiltonianSolver {
+public:
+    HamiltonianSolver();
+
+    void Reset();  // Forget the game in progress; the cached cycle is kept
+    Direction Decide(const Simulation& sim);
+
+    bool IsFollowingCycle() const;  // Riding the cycle, cutting or not
+    int GetCycleLength() const;
+    unsigned long long GetCycleBuilds() const;
+
+private:
+    enum class Mode {
+        CYCLE,      // Body in cycle order; cuts allowed
+        EXCURSION,  // Walking a planned path to an off-tour apple and back
+        RETURNING,  // Back on the cycle, excursion cells still in the body
+        FALLBACK    // Body out of order for unknown reasons; pathfinder drives
+    };
+
+    void PrepareCycle(const Simulation& sim);
+
+    // Body order bookkeeping: tail to head, every link between segments
+    // either advances along the cycle (adding to span) or is broken
+    int LinkStep(const OccupancyGrid& grid, const Cell& behind, const Cell& ahead) const;
+    void AddLink(int step, int sign);
+    void RescanBody(const Simulation& sim);
+    void TrackBody(const Simulation& sim);
+    bool BodyInOrder(const Simulation& sim) const;
+
+    bool PlanExcursion(const Simulation& sim);
+    Direction FollowCycle(const Simulation& sim, bool allowCuts) const;
+
+    HamiltonianCycle cycle;
+    std::vector<Cell> layoutKey;  // Obstacle cells the cached cycle was built for
+    int layoutArenaSize;
+    unsigned long long cycleBuilds;
+
+    bool engaged;                 // Decided on the previous tick of this game
+    unsigned long long lastTick;
+    Mode mode;
+
+    // Body as of the previous decision, to see what entered and left it
+    Cell trackedHead;
+    Cell trackedTail;
+    int trackedLength;
+    int brokenLinks;              // Links that do not advance along the cycle
+    long long span;               // Cycle steps covered by the other links
+
+    std::vector<Cell> excursion;  // Cells still to enter, in order
+    std::size_t excursionStep;
+    std::vector<int> searchParent;  // Breadth-first scratch, by grid index
+    std::vector<int> searchReach;
+    std::vector<int> searchDepth;
+    std::vector<int> searchLag;
+    std::vector<int> searchQueue;
+
+    Autopilot fallback;
+};
+
+#endif // HAMILTONIAN_SOLVER_H
@@ -1,30 +1,82 @@
 #include "raylib.h"
 #include "game.h"
+#include "trace.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
-int main() {
+int main(int argc, char** argv) {
+    // Time to first frame counts from here, window creation included
+    const auto launchTime = std::chrono::steady_clock::now();
+    
+    // --record FILE saves the first game, --replay FILE plays one back,
+    // --fps N caps the render rate (0 = uncapped), --arena N sets the arena
+    // half-size, --world chunked streams it in chunks (for huge arenas),
+    // --policy FILE adds a trained network to the pilots P cycles through
+    GameOptions options;
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            std::cerr << "missing value for " << argv[i] << std::endl;
+            return 1;
+        }
+        if (std::strcmp(argv[i], "--record") == 0) {
+            options.recordPath = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--replay") == 0) {
+            options.replayPath = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--policy") == 0) {
+            options.policyPath = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--fps") == 0) {
+            options.targetFps = std::atoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--arena") == 0 && std::atoi(argv[i + 1]) > 0) {
+            options.arenaSize = std::atoi(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--world") == 0 && std::strcmp(argv[i + 1], "dense") == 0) {
+            options.chunked = false;
+        }
+        else if (std::strcmp(argv[i], "--world") == 0 && std::strcmp(argv[i + 1], "chunked") == 0) {
+            options.chunked = true;
+        }
+        else {
+            std::cerr << "usage: snake_game [--record FILE] [--replay FILE] [--fps N] [--arena N] [--world dense|chunked] [--policy FILE]" << std::endl;
+            return 1;
+        }
+    }
+    
     // Initialize window and game
     const int screenWidth = 800;
     const int screenHeight = 600;
     
     InitWindow(screenWidth, screenHeight, "3D Snake Game");
-    SetTargetFPS(60);
+    SetTargetFPS(options.targetFps);  // Rendering only; the game ticks on its own clock
     
     // Set background color to a natural sky blue
     SetExitKey(KEY_NULL); // Disable automatic exit with ESC
     
-    Game game;
+    TRACE_THREAD_NAME("Main");
+    Game game(options);
     game.Initialize();
     
     // Main game loop
+    bool firstFrame = true;
     while (!WindowShouldClose()) {
         game.Update();
         game.Render();
+        
+        if (firstFrame) {
+            game.ReportStartup(std::chrono::duration<double>(std::chrono::steady_clock::now() - launchTime).count());
+            firstFrame = false;
+        }
     }
     
     // Cleanup
     game.Cleanup();
     CloseWindow();
+    TRACE_DUMP("trace.json");
     
     return 0;
 }
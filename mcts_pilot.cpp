@@ -0,0 +1,330 @@
+#include "mcts_pilot.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Playout scores are summed as integers so threads can add them atomically
+static const double rewardScale = 1 << 20;
+
+// Eating the next apple t ticks from now scores appleDiscount^t. Later
+// apples are left out: they depend on respawns the search cannot see, and
+// only add noise to the choice between the moves in front of it.
+static const double appleDiscount = 0.97;
+
+// Share of rollout moves picked at random instead of toward the apple
+static const std::uint32_t rolloutNoise = 8;  // One in this many
+
+static const Direction directions[4] = { Direction::UP, Direction::DOWN, Direction::LEFT, Direction::RIGHT };
+
+static bool IsReverse(Direction a, Direction b) {
+    return (a == Direction::LEFT && b == Direction::RIGHT) || (a == Direction::RIGHT && b == Direction::LEFT) ||
+           (a == Direction::UP && b == Direction::DOWN) || (a == Direction::DOWN && b == Direction::UP);
+}
+
+// The tail moves out of the way this tick unless the snake is growing
+static bool IsOpen(const GameStateArena& arena, const GameState& state, Direction direction) {
+    const Cell next = Neighbor(state.head, direction);
+    return !arena.IsBlocked(state, next) || (next == state.tail && !state.shouldGrow);
+}
+
+MctsPilot::MctsPilot(const MctsConfig& config) :
+    config(config),
+    pool(config.threads),
+    nodes(new Node[config.maxNodes]),
+    nodeCount(0),
+    playoutsStarted(0),
+    lastPlayouts(0),
+    lastSeconds(0.0),
+    lastNodes(0),
+    totalPlayouts(0),
+    totalSeconds(0.0) {
+    // One worker per pool thread, each with its own stream of the seed
+    RandomStream random(config.seed);
+    workers.resize(pool.GetThreadCount());
+    for (auto& worker : workers) {
+        worker.random = random;
+        worker.playouts = 0;
+        random.Jump();
+    }
+}
+
+MctsPilot::~MctsPilot() {
+}
+
+void MctsPilot::Reset() {
+    layout.reset();
+}
+
+void MctsPilot::SetTimeBudget(double seconds) {
+    config.timeBudget = seconds;
+}
+
+Direction MctsPilot::Decide(const Simulation& sim) {
+    TRACE_ZONE("MctsPilot::Decide");
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<double>(config.timeBudget));
+
+    // The layout only changes with Simulation::Initialize, so it is built
+    // once per layout and shared by every worker's arena
+    if (!layout || layout->GetArenaSize() != sim.GetArenaSize()) {
+        layout = std::make_shared<const GameLayout>(sim);
+        for (auto& worker : workers) {
+            worker.arena.reset(new GameStateArena(layout));
+        }
+    }
+
+    for (auto& worker : workers) {
+        worker.arena->Clear();
+        worker.root = worker.arena->Capture(sim);
+        worker.scratch = worker.arena->Fork(worker.root);
+        worker.playouts = 0;
+    }
+
+    // The pool is recycled: the previous decision's tree is simply overwritten
+    nodeCount.store(1, std::memory_order_relaxed);
+    InitNode(0, sim.GetDirection());
+    playoutsStarted.store(0, std::memory_order_relaxed);
+
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        Worker* worker = &workers[i];
+        pool.Submit([this, worker, deadline]() {
+            Search(*worker, deadline);
+        });
+    }
+    pool.Wait();
+
+    lastSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    lastPlayouts = 0;
+    for (const auto& worker : workers) {
+        lastPlayouts += worker.playouts;
+    }
+    lastNodes = std::min(nodeCount.load(std::memory_order_relaxed), config.maxNodes);
+    totalPlayouts += lastPlayouts;
+    totalSeconds += lastSeconds;
+
+    // The most visited move is the one the search trusts most
+    const Node& root = nodes[0];
+    const std::uint32_t first = root.children.load(std::memory_order_acquire);
+    if (first == unexpanded || first == expanding || first == unexpandable) {
+        return RolloutMove(*workers[0].arena, workers[0].root, workers[0].random);
+    }
+
+    std::uint32_t best = first;
+    for (std::uint32_t child = first + 1; child < first + root.childCount; ++child) {
+        const int visits = nodes[child].visits.load(std::memory_order_relaxed);
+        const int bestVisits = nodes[best].visits.load(std::memory_order_relaxed);
+        if (visits > bestVisits || (visits == bestVisits && nodes[child].reward.load(std::memory_order_relaxed) >
+                                                             nodes[best].reward.load(std::memory_order_relaxed))) {
+            best = child;
+        }
+    }
+    return nodes[best].action;
+}
+
+void MctsPilot::Search(Worker& worker, std::chrono::steady_clock::time_point deadline) {
+    TRACE_ZONE("MctsPilot::Search");
+
+    // At least one playout each, so a tiny budget still yields a move
+    do {
+        if (config.maxPlayouts > 0 && playoutsStarted.fetch_add(1, std::memory_order_relaxed) >= config.maxPlayouts) {
+            break;
+        }
+        Playout(worker);
+        worker.playouts++;
+    } while (std::chrono::steady_clock::now() < deadline);
+}
+
+void MctsPilot::Playout(Worker& worker) {
+    GameStateArena& arena = *worker.arena;
+    GameState& state = worker.scratch;
+    arena.Restore(state, worker.root);
+    state.rng = RandomStream(worker.random.Next());  // A fresh sample of the apple respawns
+
+    // Down the tree by UCT, booking a virtual loss on every node on the way
+    worker.path.clear();
+    int depth = 0;
+    double apple = 0.0;
+    double discount = 1.0;
+    auto advance = [&](Direction direction) {
+        discount *= appleDiscount;
+        if (arena.Step(state, direction) == StepResult::ATE_APPLE && apple == 0.0) {
+            apple = discount;
+        }
+        depth++;
+    };
+
+    std::uint32_t node = 0;
+    for (;;) {
+        worker.path.push_back(node);
+        nodes[node].visits.fetch_add(config.virtualLoss, std::memory_order_relaxed);
+        if (state.gameOver) break;
+
+        bool expandedHere = false;
+        if (Expand(node, arena, state, expandedHere) == unexpanded) break;
+
+        node = SelectChild(node, worker.random);
+        advance(nodes[node].action);
+
+        // One new level per playout; the rest is the rollout
+        if (expandedHere) {
+            worker.path.push_back(node);
+            nodes[node].visits.fetch_add(config.virtualLoss, std::memory_order_relaxed);
+            break;
+        }
+    }
+
+    // Then on with the cheap policy
+    const int horizon = depth + config.rolloutDepth;
+    while (!state.gameOver && depth < horizon) {
+        advance(RolloutMove(arena, state, worker.random));
+    }
+
+    // Half for staying alive to the horizon, half for the apple, sooner being better
+    const double survival = (state.gameOver && !state.won) ? static_cast<double>(depth) / horizon : 1.0;
+    const double score = 0.5 * survival + 0.5 * apple;
+    const long long reward = std::llround(score * rewardScale);
+
+    // Swap the virtual losses for the real result
+    for (std::uint32_t visited : worker.path) {
+        nodes[visited].visits.fetch_add(1 - config.virtualLoss, std::memory_order_relaxed);
+        nodes[visited].reward.fetch_add(reward, std::memory_order_relaxed);
+    }
+}
+
+std::uint32_t MctsPilot::Expand(std::uint32_t node, const GameStateArena& arena, const GameState& state,
+                                bool& expandedHere) {
+    std::uint32_t first = nodes[node].children.load(std::memory_order_acquire);
+    if (first != unexpanded) {
+        // Another thread is filling it in or the pool ran out: a leaf for now
+        return (first == expanding || first == unexpandable) ? unexpanded : first;
+    }
+
+    // Only the thread that claims the node expands it
+    if (!nodes[node].children.compare_exchange_strong(first, expanding, std::memory_order_acq_rel)) {
+        return (first == expanding || first == unexpandable) ? unexpanded : first;
+    }
+
+    // Only the moves that survive the next tick. Sure deaths left in the
+    // tree would each cost a playout at every node, and that noise drowns
+    // the tick or two that separates the good moves. With nothing open the
+    // snake is dead anyway, and every move stays in to say so.
+    Direction moves[3];
+    std::uint32_t count = 0;
+    for (Direction direction : directions) {
+        if (!IsReverse(direction, state.direction) && IsOpen(arena, state, direction)) {
+            moves[count++] = direction;
+        }
+    }
+    if (count == 0) {
+        for (Direction direction : directions) {
+            if (!IsReverse(direction, state.direction)) {
+                moves[count++] = direction;
+            }
+        }
+    }
+
+    first = nodeCount.fetch_add(count, std::memory_order_relaxed);
+    if (first + count > config.maxNodes) {
+        nodes[node].children.store(unexpandable, std::memory_order_release);
+        return unexpanded;
+    }
+
+    for (std::uint32_t i = 0; i < count; ++i) {
+        InitNode(first + i, moves[i]);
+    }
+    nodes[node].childCount = static_cast<std::uint8_t>(count);
+    nodes[node].children.store(first, std::memory_order_release);
+    expandedHere = true;
+    return first;
+}
+
+std::uint32_t MctsPilot::SelectChild(std::uint32_t node, RandomStream& random) const {
+    const Node& parent = nodes[node];
+    const std::uint32_t first = parent.children.load(std::memory_order_acquire);
+    const double logVisits = std::log(static_cast<double>(std::max(parent.visits.load(std::memory_order_relaxed), 1)));
+
+    std::uint32_t best = first;
+    double bestScore = -1.0;
+    std::uint32_t unvisited = 0;
+    for (std::uint32_t child = first; child < first + parent.childCount; ++child) {
+        const int visits = nodes[child].visits.load(std::memory_order_relaxed);
+
+        // Untried moves first, in random order
+        if (visits == 0) {
+            if (random.NextBelow(++unvisited) == 0) {
+                best = child;
+            }
+            continue;
+        }
+        if (unvisited > 0) continue;
+
+        // Virtual losses count as visits that scored nothing
+        const double mean = nodes[child].reward.load(std::memory_order_relaxed) / (rewardScale * visits);
+        const double score = mean + config.exploration * std::sqrt(logVisits / visits);
+        if (score > bestScore) {
+            best = child;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+Direction MctsPilot::RolloutMove(const GameStateArena& arena, const GameState& state, RandomStream& random) const {
+    // Open moves toward the apple, now and then a random one; ties at random
+    Direction best = state.direction;
+    int bestDistance = -1;
+    std::uint32_t ties = 0;
+    const bool noisy = random.NextBelow(rolloutNoise) == 0;
+
+    for (Direction direction : directions) {
+        if (IsReverse(direction, state.direction) || !IsOpen(arena, state, direction)) continue;
+
+        const Cell next = Neighbor(state.head, direction);
+
+        const int distance = noisy || !state.hasApple ? 0 :
+                             std::abs(state.apple.x - next.x) + std::abs(state.apple.z - next.z);
+        if (bestDistance < 0 || distance < bestDistance) {
+            best = direction;
+            bestDistance = distance;
+            ties = 1;
+        } else if (distance == bestDistance && random.NextBelow(++ties) == 0) {
+            best = direction;
+        }
+    }
+    return best;
+}
+
+void MctsPilot::InitNode(std::uint32_t node, Direction action) {
+    nodes[node].visits.store(0, std::memory_order_relaxed);
+    nodes[node].reward.store(0, std::memory_order_relaxed);
+    nodes[node].children.store(unexpanded, std::memory_order_relaxed);
+    nodes[node].childCount = 0;
+    nodes[node].action = action;
+}
+
+unsigned int MctsPilot::GetThreadCount() const {
+    return pool.GetThreadCount();
+}
+
+unsigned long long MctsPilot::GetLastPlayouts() const {
+    return lastPlayouts;
+}
+
+double MctsPilot::GetLastSeconds() const {
+    return lastSeconds;
+}
+
+std::uint32_t MctsPilot::GetLastNodes() const {
+    return lastNodes;
+}
+
+unsigned long long MctsPilot::GetTotalPlayouts() const {
+    return totalPlayouts;
+}
+
+double MctsPilot::GetTotalSeconds() const {
+    return totalSeconds;
+}
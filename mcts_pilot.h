@@ -0,0 +1,100 @@
+#ifndef MCTS_PILOT_H
+#define MCTS_PILOT_H
+
+#include "simulation.h"
+#include "game_state.h"
+#include "task_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct MctsConfig {
+    unsigned int threads = 0;    // Search threads, 0 = one per hardware thread
+    double timeBudget = 0.05;    // Seconds per decision
+    unsigned long long maxPlayouts = 0;  // Stop early after this many, 0 = only the clock
+    int rolloutDepth = 100;      // Ticks a playout runs past the tree before it is scored
+    double exploration = 1.0;    // UCT exploration constant
+    int virtualLoss = 3;         // Visits a thread books on its path while its playout runs
+    std::uint32_t maxNodes = 1 << 18;  // Node pool size; the tree stops growing when it is used up
+    std::uint64_t seed = 1;      // Playout randomness; the search is only repeatable on one thread
+};
+
+// Monte Carlo tree search over forked GameStates. Every playout walks the
+// shared tree from the current state by UCT, adds one level of children
+// where it leaves the tree, then plays on with a cheap randomized greedy
+// policy and backs the score up the path. All search threads work on the
+// same tree (tree parallelism): a thread books a virtual loss on each node
+// it passes, so the others spread out instead of piling onto one branch
+// while its playout is still running.
+//
+// The tree is open loop - nodes are move sequences, and each playout
+// replays its sequence from the root state - so the random apple respawns
+// are sampled afresh every time instead of being baked into the tree.
+// Nodes come from a fixed pool that the next decision reuses from the start.
+class MctsPilot {
+public:
+    explicit MctsPilot(const MctsConfig& config = MctsConfig());
+    ~MctsPilot();
+
+    MctsPilot(const MctsPilot&) = delete;
+    MctsPilot& operator=(const MctsPilot&) = delete;
+
+    void Reset();  // Drop the cached layout, e.g. after Simulation::Initialize
+    Direction Decide(const Simulation& sim);
+    void SetTimeBudget(double seconds);  // For live play, a share of the tick interval
+
+    unsigned int GetThreadCount() const;
+    unsigned long long GetLastPlayouts() const;  // Of the latest decision
+    double GetLastSeconds() const;
+    std::uint32_t GetLastNodes() const;
+    unsigned long long GetTotalPlayouts() const;
+    double GetTotalSeconds() const;
+
+private:
+    struct Node {
+        std::atomic<int> visits;              // Finished playouts plus virtual losses in flight
+        std::atomic<long long> reward;        // Sum of playout scores, fixed point
+        std::atomic<std::uint32_t> children;  // First child index, or one of the marks below
+        std::uint8_t childCount;              // Written before children is published
+        Direction action;                     // Move from the parent
+    };
+
+    // Per search thread; only ever touched by the thread running it
+    struct Worker {
+        std::unique_ptr<GameStateArena> arena;
+        GameState root;
+        GameState scratch;
+        RandomStream random;
+        std::vector<std::uint32_t> path;
+        unsigned long long playouts;
+    };
+
+    static const std::uint32_t unexpanded = 0;  // The root is node 0, so no child ever is
+    static const std::uint32_t expanding = 0xFFFFFFFFu;
+    static const std::uint32_t unexpandable = 0xFFFFFFFEu;  // Pool used up
+
+    void Search(Worker& worker, std::chrono::steady_clock::time_point deadline);
+    void Playout(Worker& worker);
+    std::uint32_t Expand(std::uint32_t node, const GameStateArena& arena, const GameState& state, bool& expandedHere);
+    std::uint32_t SelectChild(std::uint32_t node, RandomStream& random) const;
+    Direction RolloutMove(const GameStateArena& arena, const GameState& state, RandomStream& random) const;
+    void InitNode(std::uint32_t node, Direction action);
+
+    MctsConfig config;
+    TaskPool pool;
+    std::shared_ptr<const GameLayout> layout;
+    std::vector<Worker> workers;
+    std::unique_ptr<Node[]> nodes;
+    std::atomic<std::uint32_t> nodeCount;
+    std::atomic<unsigned long long> playoutsStarted;  // Checked against maxPlayouts
+
+    unsigned long long lastPlayouts;
+    double lastSeconds;
+    std::uint32_t lastNodes;
+    unsigned long long totalPlayouts;
+    double totalSeconds;
+};
+
+#endif // MCTS_PILOT_H
@@ -0,0 +1,121 @@
+// Headless MCTS runner: plays seeded games one after another with every
+// move picked by MctsPilot, and reports score and search throughput.
+//
+//   snake_mcts [--games N] [--threads T] [--budget MS] [--playouts P]
+//              [--depth D] [--seed S] [--arena A] [--obstacles O] [--max-ticks M]
+//
+// Game i plays jump-ahead stream i of --seed, as in snake_batch. The search
+// threads all work on one decision at a time, so playouts/s is the number
+// to compare across --threads. With --playouts and --threads 1 the games
+// are repeatable; otherwise the clock decides how far each search gets.
+
+#include "simulation.h"
+#include "mcts_pilot.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+struct MctsOptions {
+    int games = 5;
+    unsigned int threads = 0;
+    double budget = 0.01;  // Seconds per move
+    unsigned long long playouts = 0;
+    int depth = 100;
+    std::uint64_t seed = 1;
+    int arenaSize = 20;
+    int obstacles = 15;
+    unsigned long long maxTicks = 5000;
+};
+
+static bool ParseOptions(int argc, char** argv, MctsOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--games") == 0) options.games = std::atoi(value);
+        else if (std::strcmp(arg, "--threads") == 0) options.threads = static_cast<unsigned int>(std::atoi(value));
+        else if (std::strcmp(arg, "--budget") == 0) options.budget = std::atof(value) / 1000.0;
+        else if (std::strcmp(arg, "--playouts") == 0) options.playouts = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--depth") == 0) options.depth = std::atoi(value);
+        else if (std::strcmp(arg, "--seed") == 0) options.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--arena") == 0) options.arenaSize = std::atoi(value);
+        else if (std::strcmp(arg, "--obstacles") == 0) options.obstacles = std::atoi(value);
+        else if (std::strcmp(arg, "--max-ticks") == 0) options.maxTicks = std::strtoull(value, nullptr, 10);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    return options.games > 0 && options.arenaSize > 0 && options.budget >= 0.0 && options.depth > 0;
+}
+
+int main(int argc, char** argv) {
+    MctsOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: snake_mcts [--games N] [--threads T] [--budget MS] [--playouts P] [--depth D] [--seed S] [--arena A] [--obstacles O] [--max-ticks M]\n");
+        return 1;
+    }
+
+    TRACE_THREAD_NAME("Main");
+
+    MctsConfig mctsConfig;
+    mctsConfig.threads = options.threads;
+    mctsConfig.timeBudget = options.budget;
+    mctsConfig.maxPlayouts = options.playouts;
+    mctsConfig.rolloutDepth = options.depth;
+    mctsConfig.seed = options.seed;
+    MctsPilot pilot(mctsConfig);
+
+    SimConfig config;
+    config.arenaSize = options.arenaSize;
+    config.maxObstacles = options.obstacles;
+    Simulation sim(config);
+
+    RandomStream stream(options.seed);
+    unsigned long long totalTicks = 0;
+    long long totalScore = 0;
+    int wins = 0;
+    double slowest = 0.0;
+    for (int game = 0; game < options.games; ++game) {
+        TRACE_ZONE("PlayGame");
+        sim.Seed(options.seed, static_cast<std::uint64_t>(game), stream);
+        stream.Jump();
+        sim.Initialize();
+        pilot.Reset();
+
+        while (!sim.IsGameOver() && sim.GetTick() < options.maxTicks) {
+            sim.Step(pilot.Decide(sim));
+            slowest = std::max(slowest, pilot.GetLastSeconds());
+        }
+
+        std::printf("game %-4d score %6d  length %5d  ticks %6llu%s\n", game, sim.GetScore(), sim.GetLength(),
+                    sim.GetTick(), sim.HasWon() ? "  won" : "");
+        totalTicks += sim.GetTick();
+        totalScore += sim.GetScore();
+        wins += sim.HasWon() ? 1 : 0;
+    }
+
+    const double seconds = pilot.GetTotalSeconds();
+    std::printf("%d games on %u threads, %.1f ms budget\n", options.games, pilot.GetThreadCount(), options.budget * 1000.0);
+    std::printf("score    mean %.1f\n", static_cast<double>(totalScore) / options.games);
+    std::printf("wins     %d\n", wins);
+    std::printf("moves    %llu in %.3f s searching, slowest %.2f ms\n", totalTicks, seconds, slowest * 1000.0);
+    std::printf("playouts %.0f per move\n", totalTicks > 0 ? static_cast<double>(pilot.GetTotalPlayouts()) / totalTicks : 0.0);
+    std::printf("playouts/s %.0f\n", seconds > 0.0 ? pilot.GetTotalPlayouts() / seconds : 0.0);
+
+    // Only written in SNAKE_TRACING builds
+    TRACE_DUMP("trace.json");
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include "neural_policy.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char policyMagic[4] = { 'S', 'N', 'K', 'P' };
+static const std::uint32_t policyVersion = 1;
+
+// Lanes are padded to whole AVX vectors, so the lane loops have no remainder
+static const std::size_t laneAlignment = 8;
+
+// Offsets of the genome's parts in the flat weight list
+static const int hiddenBiasOffset = policyHidden * policyInputs;
+static const int outputWeightOffset = hiddenBiasOffset + policyHidden;
+static const int outputBiasOffset = outputWeightOffset + policyOutputs * policyHidden;
+
+// Directions in clockwise order; left of a heading is one step back
+static const Direction clockwise[4] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+static int ClockwiseIndex(Direction direction) {
+    switch (direction) {
+        case Direction::UP:    return 0;
+        case Direction::RIGHT: return 1;
+        case Direction::DOWN:  return 2;
+        case Direction::LEFT:  return 3;
+    }
+    return 0;
+}
+
+Direction PolicyActionDirection(Direction heading, int action) {
+    return clockwise[(ClockwiseIndex(heading) + action + 3) & 3];
+}
+
+// Softsign, tanh's cheap cousin: bounded, smooth and plain arithmetic, so
+// the lane loop around it vectorizes where std::tanh would not
+static inline float Softsign(float x) {
+    return x / (1.0f + std::fabs(x));
+}
+
+FeatureExtractor::FeatureExtractor() :
+    stamp(0) {
+}
+
+void FeatureExtractor::Extract(const Simulation& sim, float* out, std::size_t stride) {
+    const OccupancyGrid& grid = sim.GetGrid();
+    const Cell head = sim.GetHead();
+    const Cell apple = sim.GetApple();
+    const bool hasApple = sim.HasApple();
+    const float span = static_cast<float>(2 * sim.GetArenaSize() + 1);
+
+    // Room for the body and then some counts as all the room there is
+    const int roomLimit = sim.GetLength() * 2 + 8;
+    const int appleDistance = std::abs(apple.x - head.x) + std::abs(apple.z - head.z);
+
+    for (int action = 0; action < policyOutputs; ++action) {
+        const Direction direction = PolicyActionDirection(sim.GetDirection(), action);
+        const Cell next = Neighbor(head, direction);
+        float* move = out + action * 4 * stride;
+
+        if (grid.IsBlocked(next)) {
+            move[0] = 0.0f;
+            move[stride] = 0.0f;
+            move[2 * stride] = 0.0f;
+            move[3 * stride] = 0.0f;
+            continue;
+        }
+
+        int run = 1;
+        for (Cell cell = Neighbor(next, direction); !grid.IsBlocked(cell); cell = Neighbor(cell, direction)) {
+            run++;
+        }
+
+        const int nextDistance = std::abs(apple.x - next.x) + std::abs(apple.z - next.z);
+        move[0] = 1.0f;
+        move[stride] = run / span;
+        move[2 * stride] = !hasApple ? 0.0f : nextDistance < appleDistance ? 1.0f : -1.0f;
+        move[3 * stride] = static_cast<float>(CountReachable(grid, grid.IndexOf(next), roomLimit)) / roomLimit;
+    }
+
+    // The apple in the snake's frame: ahead is +, right is +
+    float ahead = 0.0f, right = 0.0f;
+    if (hasApple) {
+        const Cell forward = Neighbor(Cell{0, 0}, sim.GetDirection());
+        const Cell side = Neighbor(Cell{0, 0}, PolicyActionDirection(sim.GetDirection(), 2));
+        const int dx = apple.x - head.x;
+        const int dz = apple.z - head.z;
+        ahead = (dx * forward.x + dz * forward.z) / span;
+        right = (dx * side.x + dz * side.z) / span;
+    }
+    out[12 * stride] = ahead;
+    out[13 * stride] = right;
+}
+
+int FeatureExtractor::CountReachable(const OccupancyGrid& grid, int start, int limit) {
+    if (static_cast<int>(visited.size()) != grid.CellCount()) {
+        visited.assign(grid.CellCount(), 0);
+        queue.resize(grid.CellCount());
+        stamp = 0;
+    }
+
+    // Stamp wrapped around - old marks could look current again
+    if (++stamp == 0) {
+        std::fill(visited.begin(), visited.end(), 0);
+        stamp = 1;
+    }
+
+    const int steps[4] = { -grid.GetWidth(), grid.GetWidth(), -1, 1 };
+    int head = 0, tail = 0;
+    queue[tail++] = start;
+    visited[start] = stamp;
+    while (head < tail && tail < limit) {
+        const int cell = queue[head++];
+        for (int step : steps) {
+            const int neighbor = cell + step;
+            if (visited[neighbor] != stamp && !grid.IsBlocked(neighbor)) {
+                visited[neighbor] = stamp;
+                queue[tail++] = neighbor;
+            }
+        }
+    }
+    return std::min(tail, limit);
+}
+
+PolicyBatch::PolicyBatch(std::size_t laneCount) :
+    laneCount(laneCount),
+    stride((laneCount + laneAlignment - 1) / laneAlignment * laneAlignment),
+    hiddenWeights(policyHidden * policyInputs * stride, 0.0f),
+    hiddenBiases(policyHidden * stride, 0.0f),
+    outputWeights(policyOutputs * policyHidden * stride, 0.0f),
+    outputBiases(policyOutputs * stride, 0.0f),
+    hidden(policyHidden * stride, 0.0f),
+    scores(policyOutputs * stride, 0.0f) {
+}
+
+void PolicyBatch::SetGenome(std::size_t lane, const float* weights) {
+    for (int i = 0; i < policyHidden * policyInputs; ++i) {
+        hiddenWeights[i * stride + lane] = weights[i];
+    }
+    for (int i = 0; i < policyHidden; ++i) {
+        hiddenBiases[i * stride + lane] = weights[hiddenBiasOffset + i];
+    }
+    for (int i = 0; i < policyOutputs * policyHidden; ++i) {
+        outputWeights[i * stride + lane] = weights[outputWeightOffset + i];
+    }
+    for (int i = 0; i < policyOutputs; ++i) {
+        outputBiases[i * stride + lane] = weights[outputBiasOffset + i];
+    }
+}
+
+void PolicyBatch::Forward(const float* features, int* actions) {
+    TRACE_ZONE("PolicyBatch::Forward");
+
+    // Every inner loop runs over lanes with unit stride
+    for (int h = 0; h < policyHidden; ++h) {
+        float* sum = &hidden[h * stride];
+        std::memcpy(sum, &hiddenBiases[h * stride], stride * sizeof(float));
+        for (int i = 0; i < policyInputs; ++i) {
+            const float* weight = &hiddenWeights[(h * policyInputs + i) * stride];
+            const float* input = features + i * stride;
+            for (std::size_t lane = 0; lane < stride; ++lane) {
+                sum[lane] += weight[lane] * input[lane];
+            }
+        }
+        for (std::size_t lane = 0; lane < stride; ++lane) {
+            sum[lane] = Softsign(sum[lane]);
+        }
+    }
+
+    for (int o = 0; o < policyOutputs; ++o) {
+        float* sum = &scores[o * stride];
+        std::memcpy(sum, &outputBiases[o * stride], stride * sizeof(float));
+        for (int h = 0; h < policyHidden; ++h) {
+            const float* weight = &outputWeights[(o * policyHidden + h) * stride];
+            const float* input = &hidden[h * stride];
+            for (std::size_t lane = 0; lane < stride; ++lane) {
+                sum[lane] += weight[lane] * input[lane];
+            }
+        }
+    }
+
+    // Highest score wins; ties go to the lower action
+    for (std::size_t lane = 0; lane < laneCount; ++lane) {
+        int best = 0;
+        for (int o = 1; o < policyOutputs; ++o) {
+            if (scores[o * stride + lane] > scores[best * stride + lane]) {
+                best = o;
+            }
+        }
+        actions[lane] = best;
+    }
+}
+
+bool SavePolicyPopulation(const std::string& path, const PolicyPopulation& population) {
+    const std::size_t genomeCount = population.fitness.size();
+    if (population.weights.size() != genomeCount * policyWeightCount) return false;
+
+    PolicyFileHeader header = PolicyFileHeader();
+    std::memcpy(header.magic, policyMagic, sizeof(policyMagic));
+    header.version = policyVersion;
+    header.inputs = policyInputs;
+    header.hidden = policyHidden;
+    header.outputs = policyOutputs;
+    header.genomeCount = static_cast<std::uint32_t>(genomeCount);
+    header.generation = population.generation;
+    header.seed = population.seed;
+
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) return false;
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              std::fwrite(population.fitness.data(), sizeof(float), genomeCount, file) == genomeCount &&
+              std::fwrite(population.weights.data(), sizeof(float), population.weights.size(), file) == population.weights.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+#if defined(_WIN32)
+    std::remove(path.c_str());  // rename does not replace files there
+#endif
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+bool LoadPolicyPopulation(const std::string& path, PolicyPopulation& population) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    PolicyFileHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+              std::memcmp(header.magic, policyMagic, sizeof(policyMagic)) == 0 &&
+              header.version == policyVersion &&
+              header.inputs == policyInputs && header.hidden == policyHidden && header.outputs == policyOutputs &&
+              header.genomeCount > 0;
+
+    if (ok) {
+        population.generation = header.generation;
+        population.seed = header.seed;
+        population.fitness.resize(header.genomeCount);
+        population.weights.resize(static_cast<std::size_t>(header.genomeCount) * policyWeightCount);
+        ok = std::fread(population.fitness.data(), sizeof(float), population.fitness.size(), file) == population.fitness.size() &&
+             std::fread(population.weights.data(), sizeof(float), population.weights.size(), file) == population.weights.size();
+    }
+
+    std::fclose(file);
+    return ok;
+}
+
+NeuralPolicy::NeuralPolicy() :
+    batch(1),
+    input(policyInputs * batch.GetStride(), 0.0f),
+    loaded(false) {
+}
+
+bool NeuralPolicy::Load(const std::string& path) {
+    PolicyPopulation population;
+    if (!LoadPolicyPopulation(path, population)) return false;
+
+    SetGenome(population.weights.data());
+    return true;
+}
+
+void NeuralPolicy::SetGenome(const float* weights) {
+    batch.SetGenome(0, weights);
+    loaded = true;
+}
+
+bool NeuralPolicy::IsLoaded() const {
+    return loaded;
+}
+
+Direction NeuralPolicy::Decide(const Simulation& sim) {
+    TRACE_ZONE("NeuralPolicy::Decide");
+
+    int action = 1;
+    features.Extract(sim, input.data(), batch.GetStride());
+    batch.Forward(input.data(), &action);
+    return PolicyActionDirection(sim.GetDirection(), action);
+}
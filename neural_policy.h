@@ -0,0 +1,125 @@
+#ifndef NEURAL_POLICY_H
+#define NEURAL_POLICY_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A small fixed-shape network: policyInputs features, one softsign hidden
+// layer, and a score per move relative to the heading (left, straight,
+// right). A genome is the flat weight list in this order:
+//
+//   hidden weights [policyHidden][policyInputs], hidden biases [policyHidden]
+//   output weights [policyOutputs][policyHidden], output biases [policyOutputs]
+static const int policyInputs = 14;
+static const int policyHidden = 16;
+static const int policyOutputs = 3;
+static const int policyWeightCount =
+    policyHidden * policyInputs + policyHidden + policyOutputs * policyHidden + policyOutputs;
+
+// Turns a policy output (0 left, 1 straight, 2 right) into a direction
+Direction PolicyActionDirection(Direction heading, int action);
+
+// What a policy sees of a dense Simulation, in the snake's own frame so a
+// turn means the same thing whichever way it is heading. For each of the
+// three moves: whether it is open, how far the free run ahead is, whether
+// it gets closer to the apple and how much room the pocket behind it has
+// for the body. Then where the apple is, ahead and to the side.
+class FeatureExtractor {
+public:
+    FeatureExtractor();
+
+    // Writes policyInputs values to out[0], out[stride], out[2 * stride], ...
+    // so a batch can be filled one column per game
+    void Extract(const Simulation& sim, float* out, std::size_t stride = 1);
+
+private:
+    int CountReachable(const OccupancyGrid& grid, int start, int limit);
+
+    // Flood fill scratch, kept between calls so extraction never allocates
+    std::vector<unsigned int> visited;  // Stamp per cell, bumped instead of clearing
+    std::vector<int> queue;
+    unsigned int stamp;
+};
+
+// The whole population's networks side by side, for evaluating one step
+// of many games at once. Weights are stored lane-major - every weight is
+// an array over the lanes - so each multiply-add of the forward pass is a
+// plain loop over lanes that the compiler turns into SIMD, while every
+// lane still runs its own genome.
+class PolicyBatch {
+public:
+    explicit PolicyBatch(std::size_t laneCount);
+
+    std::size_t GetLaneCount() const { return laneCount; }
+    std::size_t GetStride() const { return stride; }  // Lane count rounded up to whole vectors
+
+    void SetGenome(std::size_t lane, const float* weights);  // policyWeightCount values
+
+    // features: policyInputs rows of GetStride() floats, one column per
+    // lane. Writes the best action of every lane.
+    void Forward(const float* features, int* actions);
+
+private:
+    std::size_t laneCount;
+    std::size_t stride;
+    std::vector<float> hiddenWeights;  // [hidden][input][lane]
+    std::vector<float> hiddenBiases;   // [hidden][lane]
+    std::vector<float> outputWeights;  // [output][hidden][lane]
+    std::vector<float> outputBiases;   // [output][lane]
+    std::vector<float> hidden;         // Scratch [hidden][lane]
+    std::vector<float> scores;         // Scratch [output][lane]
+};
+
+// Population file layout, host byte order (a foreign file fails the magic
+// check):
+//
+//   PolicyFileHeader
+//   float fitness[genomeCount]
+//   float weights[genomeCount][weightCount]
+//
+// Genomes are stored best first, so loading a driver reads genome 0.
+struct PolicyFileHeader {
+    char magic[4];               // "SNKP"
+    std::uint32_t version;
+    std::uint32_t inputs;        // Network shape; must match this build's
+    std::uint32_t hidden;
+    std::uint32_t outputs;
+    std::uint32_t genomeCount;
+    std::uint64_t generation;    // Generations trained so far
+    std::uint64_t seed;          // Training seed, so a resumed run keeps its streams
+};
+
+struct PolicyPopulation {
+    std::uint64_t generation = 0;
+    std::uint64_t seed = 1;
+    std::vector<float> fitness;  // Per genome, from its latest evaluation
+    std::vector<float> weights;  // genomeCount * policyWeightCount
+};
+
+// Written to a temporary file and renamed over the target, so an
+// interrupted run never leaves half a checkpoint behind
+bool SavePolicyPopulation(const std::string& path, const PolicyPopulation& population);
+bool LoadPolicyPopulation(const std::string& path, PolicyPopulation& population);
+
+// One network driving one snake, e.g. the best genome of a training run
+class NeuralPolicy {
+public:
+    NeuralPolicy();
+
+    bool Load(const std::string& path);  // Takes the best genome of a population file
+    void SetGenome(const float* weights);
+    bool IsLoaded() const;
+
+    Direction Decide(const Simulation& sim);  // Dense arenas only
+
+private:
+    FeatureExtractor features;
+    PolicyBatch batch;
+    std::vector<float> input;
+    bool loaded;
+};
+
+#endif // NEURAL_POLICY_H
@@ -0,0 +1,37 @@
+#include "occupancy_grid.h"
+#include <algorithm>
+
+OccupancyGrid::OccupancyGrid() :
+    arenaSize(0),
+    width(0) {
+}
+
+void OccupancyGrid::Resize(int size) {
+    arenaSize = size;
+    width = arenaSize * 2 + 3;
+
+    std::size_t words = (static_cast<std::size_t>(width) * width + 63) / 64;
+    staticBits.assign(words, 0);
+    snakeBits.assign(words, 0);
+
+    MarkBorder();
+}
+
+void OccupancyGrid::ClearObstacles() {
+    std::fill(staticBits.begin(), staticBits.end(), 0);
+    MarkBorder();
+}
+
+void OccupancyGrid::ClearSnake() {
+    std::fill(snakeBits.begin(), snakeBits.end(), 0);
+}
+
+void OccupancyGrid::MarkBorder() {
+    const int edge = arenaSize + 1;
+    for (int i = -edge; i <= edge; ++i) {
+        SetObstacle(Cell{i, -edge});
+        SetObstacle(Cell{i, edge});
+        SetObstacle(Cell{-edge, i});
+        SetObstacle(Cell{edge, i});
+    }
+}
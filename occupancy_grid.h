@@ -0,0 +1,72 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include "simulation_types.h"
+#include <cstdint>
+#include <vector>
+
+// Packed bitboards over the arena plus a one cell border. The border is
+// marked as static so a wall hit is the same single lookup as an obstacle
+// or body hit. Static cells (walls, obstacles) and snake cells live in
+// separate layers so the snake can be cleared without touching the layout.
+class OccupancyGrid {
+public:
+    OccupancyGrid();
+
+    void Resize(int arenaSize);  // Clears everything and rebuilds the border
+    void ClearObstacles();
+    void ClearSnake();
+
+    void SetObstacle(const Cell& cell) { SetBit(staticBits, IndexOf(cell)); }
+    void SetSnake(const Cell& cell) { SetBit(snakeBits, IndexOf(cell)); }
+    void ClearSnake(const Cell& cell) { ClearBit(snakeBits, IndexOf(cell)); }
+
+    // Only valid for cells inside the arena or on its border
+    bool IsBlocked(const Cell& cell) const {
+        int index = IndexOf(cell);
+        return ((staticBits[index >> 6] | snakeBits[index >> 6]) >> (index & 63)) & 1;
+    }
+    bool IsBlocked(int index) const {
+        return ((staticBits[index >> 6] | snakeBits[index >> 6]) >> (index & 63)) & 1;
+    }
+    bool IsStatic(const Cell& cell) const { return TestBit(staticBits, IndexOf(cell)); }
+    bool IsStatic(int index) const { return TestBit(staticBits, index); }
+    bool IsSnake(const Cell& cell) const { return TestBit(snakeBits, IndexOf(cell)); }
+
+    bool InArena(const Cell& cell) const {
+        return cell.x >= -arenaSize && cell.x <= arenaSize &&
+               cell.z >= -arenaSize && cell.z <= arenaSize;
+    }
+
+    int GetArenaSize() const { return arenaSize; }
+
+    // Dense cell numbering shared with per-cell side tables such as FreeCellSet
+    int IndexOf(const Cell& cell) const {
+        return (cell.z + arenaSize + 1) * width + (cell.x + arenaSize + 1);
+    }
+    Cell CellAt(int index) const {
+        return Cell{index % width - arenaSize - 1, index / width - arenaSize - 1};
+    }
+    int CellCount() const { return width * width; }
+    int GetWidth() const { return width; }  // Index step between rows
+
+private:
+    static void SetBit(std::vector<std::uint64_t>& bits, int index) {
+        bits[index >> 6] |= std::uint64_t(1) << (index & 63);
+    }
+    static void ClearBit(std::vector<std::uint64_t>& bits, int index) {
+        bits[index >> 6] &= ~(std::uint64_t(1) << (index & 63));
+    }
+    static bool TestBit(const std::vector<std::uint64_t>& bits, int index) {
+        return (bits[index >> 6] >> (index & 63)) & 1;
+    }
+
+    void MarkBorder();
+
+    int arenaSize;
+    int width;  // Arena side plus the border on both ends
+    std::vector<std::uint64_t> staticBits;
+    std::vector<std::uint64_t> snakeBits;
+};
+
+#endif // OCCUPANCY_GRID_H
@@ -0,0 +1,56 @@
+#include "random_stream.h"
+
+RandomStream::RandomStream() {
+    Seed(0);
+}
+
+RandomStream::RandomStream(std::uint64_t seed) {
+    Seed(seed);
+}
+
+RandomStream RandomStream::ForStream(std::uint64_t seed, std::uint64_t stream) {
+    RandomStream result(seed);
+    for (std::uint64_t i = 0; i < stream; ++i) {
+        result.Jump();
+    }
+    return result;
+}
+
+void RandomStream::Seed(std::uint64_t seed) {
+    // SplitMix64 spreads even tiny seeds over all 256 bits, and never
+    // produces the all-zero state xoshiro cannot leave
+    for (std::uint64_t& word : state) {
+        seed += 0x9e3779b97f4a7c15ull;
+        std::uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        word = z ^ (z >> 31);
+    }
+}
+
+void RandomStream::Jump() {
+    // Reference jump polynomial for 2^128 steps
+    static const std::uint64_t polynomial[4] = {
+        0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull
+    };
+
+    std::uint64_t jumped[4] = { 0, 0, 0, 0 };
+    for (std::uint64_t word : polynomial) {
+        for (int bit = 0; bit < 64; ++bit) {
+            if (word & (std::uint64_t(1) << bit)) {
+                for (int i = 0; i < 4; ++i) {
+                    jumped[i] ^= state[i];
+                }
+            }
+            Next();
+        }
+    }
+
+    SetState(jumped);
+}
+
+void RandomStream::SetState(const std::uint64_t* words) {
+    for (int i = 0; i < 4; ++i) {
+        state[i] = words[i];
+    }
+}
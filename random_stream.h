@@ -0,0 +1,63 @@
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <cstdint>
+
+// xoshiro256** generator owned by one game. 32 bytes of state, a few
+// cycles per draw, and the output is fully specified, so a seed plays out
+// identically on every platform and thread. Jump() skips 2^128 draws,
+// which splits one seed into non-overlapping streams for parallel games.
+class RandomStream {
+public:
+    RandomStream();
+    explicit RandomStream(std::uint64_t seed);
+
+    // Stream number `stream` of `seed`: the seeded generator jumped that
+    // many times. Costs one Jump per stream, so callers walking many
+    // streams in order should keep jumping a copy instead.
+    static RandomStream ForStream(std::uint64_t seed, std::uint64_t stream);
+
+    void Seed(std::uint64_t seed);  // State expanded from the seed with SplitMix64
+    void Jump();
+
+    std::uint64_t Next() {
+        const std::uint64_t result = RotateLeft(state[1] * 5, 7) * 9;
+        const std::uint64_t t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = RotateLeft(state[3], 45);
+
+        return result;
+    }
+
+    // Uniform in 0..range-1 without modulo bias (Lemire's multiply-shift)
+    std::uint32_t NextBelow(std::uint32_t range) {
+        std::uint64_t product = (Next() >> 32) * range;
+        std::uint32_t low = static_cast<std::uint32_t>(product);
+        if (low < range) {
+            const std::uint32_t threshold = (0u - range) % range;
+            while (low < threshold) {
+                product = (Next() >> 32) * range;
+                low = static_cast<std::uint32_t>(product);
+            }
+        }
+        return static_cast<std::uint32_t>(product >> 32);
+    }
+
+    // Raw state, for saving and restoring a game
+    const std::uint64_t* GetState() const { return state; }
+    void SetState(const std::uint64_t* words);
+
+private:
+    static std::uint64_t RotateLeft(std::uint64_t value, int shift) {
+        return (value << shift) | (value >> (64 - shift));
+    }
+
+    std::uint64_t state[4];
+};
+
+#endif // RANDOM_STREAM_H
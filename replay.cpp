@@ -0,0 +1,334 @@
+#include "replay.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char replayMagic[4] = { 'S', 'N', 'K', 'R' };
+static const std::uint32_t replayVersion = 2;
+
+// Chunks handed to the writer thread
+static const std::size_t chunkSize = 64 * 1024;
+
+// Directions in clockwise order; a turn is the step count in this order
+static const Direction clockwise[4] = { Direction::UP, Direction::RIGHT, Direction::DOWN, Direction::LEFT };
+
+static int ClockwiseIndex(Direction direction) {
+    switch (direction) {
+        case Direction::UP:    return 0;
+        case Direction::RIGHT: return 1;
+        case Direction::DOWN:  return 2;
+        case Direction::LEFT:  return 3;
+    }
+    return 0;
+}
+
+ReplayWriter::ReplayWriter() :
+    file(nullptr),
+    header(),
+    bytesQueued(0),
+    lastDirection(Direction::RIGHT),
+    pendingTurns(0),
+    pendingCount(0),
+    closing(false),
+    failed(false) {
+}
+
+ReplayWriter::~ReplayWriter() {
+    Close();
+}
+
+bool ReplayWriter::Open(const std::string& path, const Simulation& sim, std::uint32_t ticksPerBlock) {
+    Close();
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    const SimConfig& config = sim.GetConfig();
+    header = ReplayHeader();
+    std::memcpy(header.magic, replayMagic, sizeof(replayMagic));
+    header.version = replayVersion;
+    header.seed = config.seed;
+    header.stream = config.stream;
+    header.arenaSize = config.arenaSize;
+    header.maxObstacles = config.maxObstacles;
+    header.flags = config.chunked ? replayChunkedWorld : 0;
+    header.ticksPerBlock = ticksPerBlock < 4 ? 4 : ticksPerBlock & ~3u;  // Blocks end on a byte
+
+    // Placeholder header; Close rewrites it with the counts and the index offset
+    failed = std::fwrite(&header, sizeof(header), 1, file) != 1;
+    bytesQueued = sizeof(header);
+
+    blockOffsets.clear();
+    chunk.clear();
+    chunk.reserve(chunkSize);
+    lastDirection = sim.GetDirection();
+    pendingTurns = 0;
+    pendingCount = 0;
+    closing = false;
+
+    writer = std::thread(&ReplayWriter::WriterLoop, this);
+    BeginBlock(sim);
+    return true;
+}
+
+void ReplayWriter::Record(const Simulation& sim) {
+    if (!file) return;
+
+    const Direction direction = sim.GetDirection();
+    const int turn = (ClockwiseIndex(direction) - ClockwiseIndex(lastDirection)) & 3;
+    lastDirection = direction;
+
+    pendingTurns |= static_cast<std::uint8_t>(turn << (pendingCount * 2));
+    if (++pendingCount == 4) {
+        Append(&pendingTurns, 1);
+        pendingTurns = 0;
+        pendingCount = 0;
+    }
+
+    if (++header.tickCount % header.ticksPerBlock == 0) {
+        BeginBlock(sim);
+    }
+}
+
+bool ReplayWriter::Close() {
+    if (!file) return true;
+
+    if (pendingCount > 0) {
+        Append(&pendingTurns, 1);
+        pendingTurns = 0;
+        pendingCount = 0;
+    }
+    QueueChunk();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    wake.notify_one();
+    writer.join();
+
+    // Everything queued is on disk now, so the index goes right after it
+    header.blockCount = blockOffsets.size();
+    header.indexOffset = bytesQueued;
+    bool ok = !failed &&
+              std::fwrite(blockOffsets.data(), sizeof(std::uint64_t), blockOffsets.size(), file) == blockOffsets.size();
+
+    // A failed recording keeps indexOffset 0 in its header, which readers reject
+    if (ok) {
+        ok = std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool ReplayWriter::IsOpen() const {
+    return file != nullptr;
+}
+
+std::uint64_t ReplayWriter::GetTickCount() const {
+    return header.tickCount;
+}
+
+void ReplayWriter::BeginBlock(const Simulation& sim) {
+    blockOffsets.push_back(bytesQueued + chunk.size());
+
+    sim.SaveState(state);
+    const std::uint32_t stateSize = static_cast<std::uint32_t>(state.size());
+    Append(&stateSize, sizeof(stateSize));
+    Append(state.data(), state.size());
+}
+
+void ReplayWriter::Append(const void* bytes, std::size_t count) {
+    chunk.append(static_cast<const char*>(bytes), count);
+    if (chunk.size() >= chunkSize) {
+        QueueChunk();
+    }
+}
+
+void ReplayWriter::QueueChunk() {
+    if (chunk.empty()) return;
+
+    bytesQueued += chunk.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(chunk));
+    }
+    wake.notify_one();
+
+    chunk = std::string();
+    chunk.reserve(chunkSize);
+}
+
+void ReplayWriter::WriterLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return closing || !queue.empty(); });
+        if (queue.empty()) return;  // Closing and drained
+
+        std::string next = std::move(queue.front());
+        queue.pop_front();
+
+        // Disk time is spent without the lock, so the game thread never waits on it.
+        // After a failure the rest is dropped; Close reports it.
+        lock.unlock();
+        const bool written = std::fwrite(next.data(), 1, next.size(), file) == next.size();
+        lock.lock();
+        failed = failed || !written;
+    }
+}
+
+ReplayReader::ReplayReader() :
+    data(nullptr),
+    size(0),
+    header() {
+}
+
+ReplayReader::~ReplayReader() {
+    Close();
+}
+
+bool ReplayReader::Open(const std::string& path) {
+    Close();
+
+#if defined(_WIN32)
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    fileCopy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = fileCopy.data();
+    size = fileCopy.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ReplayHeader))) {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) return false;
+
+    data = static_cast<const char*>(mapping);
+    size = static_cast<std::size_t>(info.st_size);
+#endif
+
+    // Reject anything that is not a finished recording of this version
+    if (size < sizeof(header)) {
+        Close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, replayMagic, sizeof(replayMagic)) != 0 ||
+        header.version != replayVersion || header.indexOffset < sizeof(header) || header.indexOffset > size ||
+        header.ticksPerBlock == 0 || header.ticksPerBlock % 4 != 0 ||
+        header.blockCount != header.tickCount / header.ticksPerBlock + 1 ||
+        header.blockCount > (size - header.indexOffset) / sizeof(std::uint64_t)) {
+        Close();
+        return false;
+    }
+
+    // Every block's state and turns have to lie between the header and the index
+    for (std::uint64_t block = 0; block < header.blockCount; ++block) {
+        const std::uint64_t offset = BlockOffset(block);
+        std::uint32_t stateSize;
+        if (offset < sizeof(header) || offset > header.indexOffset - sizeof(stateSize)) {
+            Close();
+            return false;
+        }
+        std::memcpy(&stateSize, data + offset, sizeof(stateSize));
+
+        const std::uint64_t ticks = std::min<std::uint64_t>(header.ticksPerBlock,
+                                                            header.tickCount - block * header.ticksPerBlock);
+        const std::uint64_t blockSize = sizeof(stateSize) + static_cast<std::uint64_t>(stateSize) + (ticks + 3) / 4;
+        if (blockSize > header.indexOffset - offset) {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ReplayReader::Close() {
+#if !defined(_WIN32)
+    if (data) {
+        ::munmap(const_cast<char*>(data), size);
+    }
+#endif
+    fileCopy.clear();
+    data = nullptr;
+    size = 0;
+}
+
+bool ReplayReader::IsOpen() const {
+    return data != nullptr;
+}
+
+SimConfig ReplayReader::GetConfig() const {
+    SimConfig config;
+    config.seed = header.seed;
+    config.stream = header.stream;
+    config.arenaSize = header.arenaSize;
+    config.maxObstacles = header.maxObstacles;
+    config.chunked = (header.flags & replayChunkedWorld) != 0;
+    return config;
+}
+
+std::uint64_t ReplayReader::GetTickCount() const {
+    return header.tickCount;
+}
+
+bool ReplayReader::Seek(Simulation& sim, std::uint64_t tick) const {
+    if (!data) return false;
+    if (tick > header.tickCount) tick = header.tickCount;
+
+    std::uint64_t block = tick / header.ticksPerBlock;
+    if (block >= header.blockCount) block = header.blockCount - 1;
+
+    // LoadState checks the state before taking it, and the turns after it
+    // were checked by Open, so sim is either unchanged or fully moved
+    const std::uint64_t offset = BlockOffset(block);
+    std::uint32_t stateSize;
+    std::memcpy(&stateSize, data + offset, sizeof(stateSize));
+    if (!sim.LoadState(data + offset + sizeof(stateSize), stateSize)) return false;
+
+    for (std::uint64_t t = block * header.ticksPerBlock; t < tick; ++t) {
+        sim.Step(GetDirection(t, sim.GetDirection()));
+    }
+    return true;
+}
+
+Direction ReplayReader::GetDirection(std::uint64_t tick, Direction previous) const {
+    if (tick >= header.tickCount) return previous;
+
+    const std::uint64_t block = tick / header.ticksPerBlock;
+    const std::uint64_t inBlock = tick % header.ticksPerBlock;
+
+    const std::uint8_t packed = static_cast<std::uint8_t>(BlockTurns(block)[inBlock / 4]);
+    const int turn = (packed >> ((inBlock % 4) * 2)) & 3;
+    return clockwise[(ClockwiseIndex(previous) + turn) & 3];
+}
+
+std::uint64_t ReplayReader::BlockOffset(std::uint64_t block) const {
+    std::uint64_t offset;
+    std::memcpy(&offset, data + header.indexOffset + block * sizeof(std::uint64_t), sizeof(offset));
+    return offset;
+}
+
+const char* ReplayReader::BlockTurns(std::uint64_t block) const {
+    const std::uint64_t offset = BlockOffset(block);
+    std::uint32_t stateSize;
+    std::memcpy(&stateSize, data + offset, sizeof(stateSize));
+    return data + offset + sizeof(stateSize) + stateSize;
+}
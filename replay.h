@@ -0,0 +1,123 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "simulation.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Replay file layout, host byte order (a foreign file fails the magic check):
+//
+//   ReplayHeader
+//   block 0 .. blockCount-1, each
+//       uint32 size + Simulation state before the block's first tick
+//       one 2-bit turn per tick, 4 per byte, ticksPerBlock ticks at most
+//   uint64 file offset of every block - the seek index
+//
+// A turn is the direction taken on a tick relative to the one before it
+// (straight, clockwise, counter-clockwise), so a million-tick game is
+// 250 KB of turns. Seeking loads the nearest block state and replays at
+// most one block of ticks.
+struct ReplayHeader {
+    char magic[4];              // "SNKR"
+    std::uint32_t version;
+    std::uint64_t seed;         // Seed and stream rebuild the obstacle layout
+    std::uint64_t stream;
+    std::int32_t arenaSize;
+    std::int32_t maxObstacles;
+    std::uint32_t ticksPerBlock;
+    std::uint32_t flags;        // replayChunkedWorld; also keeps the 64-bit fields aligned
+    std::uint64_t tickCount;    // Filled in on Close
+    std::uint64_t blockCount;
+    std::uint64_t indexOffset;  // 0 while the recording is still open
+};
+
+// ReplayHeader::flags bits. Older files have 0 there, a dense arena.
+static const std::uint32_t replayChunkedWorld = 1;
+
+// Records a game from the state it is in at Open. The game thread only
+// packs bits into a chunk; full chunks are written by a background thread.
+class ReplayWriter {
+public:
+    ReplayWriter();
+    ~ReplayWriter();
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    bool Open(const std::string& path, const Simulation& sim, std::uint32_t ticksPerBlock = 65536);
+    void Record(const Simulation& sim);  // Call after every Step that advanced the tick
+    // Flushes, writes the seek index and finishes the header. False if any
+    // write since Open failed (a full disk, say): the file is then not a
+    // usable replay, and ReplayReader turns it down.
+    bool Close();
+
+    bool IsOpen() const;
+    std::uint64_t GetTickCount() const;
+
+private:
+    void BeginBlock(const Simulation& sim);
+    void Append(const void* bytes, std::size_t count);
+    void QueueChunk();
+    void WriterLoop();
+
+    std::FILE* file;
+    ReplayHeader header;
+    std::vector<std::uint64_t> blockOffsets;
+    std::uint64_t bytesQueued;   // File offset where the current chunk starts
+    std::string chunk;           // Filled by the game thread
+    std::string state;           // Scratch for block states
+    Direction lastDirection;
+    std::uint8_t pendingTurns;
+    int pendingCount;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::string> queue;
+    bool closing;
+    bool failed;                 // A write came up short; guarded by mutex while the writer runs
+};
+
+// Memory-maps a closed recording and drives a Simulation through it
+class ReplayReader {
+public:
+    ReplayReader();
+    ~ReplayReader();
+
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    // Checks the header and every block against the file size, so a
+    // truncated or corrupt file fails here rather than in Seek
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const;
+    SimConfig GetConfig() const;      // Construct + Initialize a Simulation with this before seeking
+    std::uint64_t GetTickCount() const;
+
+    // Puts sim in the state after the first `tick` recorded ticks. On
+    // failure (a block state the Simulation turns down) sim is unchanged.
+    bool Seek(Simulation& sim, std::uint64_t tick) const;
+
+    // Direction taken on recorded tick `tick`, given the direction before
+    // it; past the last recorded tick that is just `previous`
+    Direction GetDirection(std::uint64_t tick, Direction previous) const;
+
+private:
+    std::uint64_t BlockOffset(std::uint64_t block) const;
+    const char* BlockTurns(std::uint64_t block) const;
+
+    const char* data;
+    std::size_t size;
+    ReplayHeader header;
+    std::string fileCopy;  // Backing store where mmap is not available
+};
+
+#endif // REPLAY_H
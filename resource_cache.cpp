@@ -0,0 +1,335 @@
+#include "resource_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+static const char meshCacheMagic[4] = { 'S', 'N', 'K', 'M' };
+static const std::uint32_t meshCacheVersion = 1;
+
+// Which arrays a stored mesh carries
+static const std::uint32_t meshCacheVertices = 1;
+static const std::uint32_t meshCacheTexcoords = 2;
+static const std::uint32_t meshCacheNormals = 4;
+static const std::uint32_t meshCacheColors = 8;
+static const std::uint32_t meshCacheIndices = 16;
+
+static std::string MeshKey(const char* shape, float a, float b, float c) {
+    char key[96];
+    std::snprintf(key, sizeof(key), "%s %g %g %g", shape, a, b, c);
+    return key;
+}
+
+static std::string MeshKey(const char* shape, float a, float b, int c, int d) {
+    char key[96];
+    std::snprintf(key, sizeof(key), "%s %g %g %d %d", shape, a, b, c, d);
+    return key;
+}
+
+// Copies an array out of the mesh, or clears the vector when the mesh has none
+template <typename Value>
+static void CopyArray(const Value* source, std::size_t count, std::vector<Value>& target) {
+    if (source) {
+        target.assign(source, source + count);
+    } else {
+        target.clear();
+    }
+}
+
+// raylib frees mesh arrays with its own allocator, so copy into MemAlloc'd buffers
+template <typename Value>
+static Value* AllocArray(const std::vector<Value>& source) {
+    if (source.empty()) return nullptr;
+    Value* copy = static_cast<Value*>(MemAlloc(static_cast<unsigned int>(source.size() * sizeof(Value))));
+    std::memcpy(copy, source.data(), source.size() * sizeof(Value));
+    return copy;
+}
+
+// Bounds-checked reads from the file image
+class CacheCursor {
+public:
+    explicit CacheCursor(const std::string& data) : data(data), offset(0) {}
+
+    bool Read(void* target, std::size_t count) {
+        if (count > data.size() - offset) return false;
+        std::memcpy(target, data.data() + offset, count);
+        offset += count;
+        return true;
+    }
+
+    template <typename Value>
+    bool ReadArray(std::vector<Value>& target, std::size_t count) {
+        if (count > (data.size() - offset) / sizeof(Value)) return false;
+        target.resize(count);
+        return Read(target.data(), count * sizeof(Value));
+    }
+
+private:
+    const std::string& data;
+    std::size_t offset;
+};
+
+ResourceCache::ResourceCache(const std::string& meshCachePath) :
+    meshCachePath(meshCachePath),
+    storedRead(false),
+    storedDirty(false),
+    loadedMeshCount(0),
+    generatedMeshCount(0) {
+}
+
+ResourceCache::~ResourceCache() {
+    Clear();
+}
+
+Mesh ResourceCache::AcquireSphere(float radius, int rings, int slices) {
+    return AcquireMesh(MeshKey("sphere", radius, 0.0f, rings, slices), [=]() {
+        return GenMeshSphere(radius, rings, slices);
+    });
+}
+
+Mesh ResourceCache::AcquireCone(float radius, float height, int slices) {
+    return AcquireMesh(MeshKey("cone", radius, height, slices, 0), [=]() {
+        return GenMeshCone(radius, height, slices);
+    });
+}
+
+Mesh ResourceCache::AcquireCylinder(float radius, float height, int slices) {
+    return AcquireMesh(MeshKey("cylinder", radius, height, slices, 0), [=]() {
+        return GenMeshCylinder(radius, height, slices);
+    });
+}
+
+Mesh ResourceCache::AcquireCube(float width, float height, float length) {
+    return AcquireMesh(MeshKey("cube", width, height, length), [=]() {
+        return GenMeshCube(width, height, length);
+    });
+}
+
+Mesh ResourceCache::AcquirePlane(float width, float length, int resX, int resZ) {
+    return AcquireMesh(MeshKey("plane", width, length, resX, resZ), [=]() {
+        return GenMeshPlane(width, length, resX, resZ);
+    });
+}
+
+template <typename Generate>
+Mesh ResourceCache::AcquireMesh(const std::string& key, Generate generate) {
+    auto loaded = meshes.find(key);
+    if (loaded != meshes.end()) {
+        loaded->second.references++;
+        return loaded->second.mesh;
+    }
+
+    if (!storedRead) {
+        ReadMeshCache();
+    }
+
+    // Straight from the file when an earlier launch generated it
+    Mesh mesh;
+    auto stored = storedMeshes.find(key);
+    if (stored != storedMeshes.end()) {
+        mesh = UploadStored(stored->second);
+        loadedMeshCount++;
+    } else {
+        mesh = generate();
+        storedMeshes[key] = Store(mesh);
+        storedDirty = true;
+        generatedMeshCount++;
+    }
+
+    meshes[key] = MeshEntry{mesh, 1};
+    return mesh;
+}
+
+Material ResourceCache::AcquireMaterial(const std::string& name, Color diffuse,
+                                        const char* vertexShader, const char* fragmentShader) {
+    auto loaded = materials.find(name);
+    if (loaded != materials.end()) {
+        loaded->second.references++;
+        return loaded->second.material;
+    }
+
+    Material material = LoadMaterialDefault();
+    material.maps[MATERIAL_MAP_DIFFUSE].color = diffuse;
+    if (vertexShader || fragmentShader) {
+        // UnloadMaterial frees any shader that is not the default one
+        material.shader = LoadShaderFromMemory(vertexShader, fragmentShader);
+    }
+
+    materials[name] = MaterialEntry{material, 1};
+    return material;
+}
+
+void ResourceCache::Release(const Mesh& mesh) {
+    // Only a handful of meshes are ever loaded, so a scan is fine
+    for (auto it = meshes.begin(); it != meshes.end(); ++it) {
+        if (it->second.mesh.vboId != mesh.vboId) continue;
+
+        if (--it->second.references == 0) {
+            UnloadMesh(it->second.mesh);
+            meshes.erase(it);
+        }
+        return;
+    }
+}
+
+void ResourceCache::Release(const Material& material) {
+    for (auto it = materials.begin(); it != materials.end(); ++it) {
+        if (it->second.material.maps != material.maps) continue;
+
+        if (--it->second.references == 0) {
+            UnloadMaterial(it->second.material);
+            materials.erase(it);
+        }
+        return;
+    }
+}
+
+void ResourceCache::Clear() {
+    if (!meshes.empty() || !materials.empty()) {
+        TraceLog(LOG_WARNING, "RESOURCES: %d meshes and %d materials still held at shutdown",
+                 static_cast<int>(meshes.size()), static_cast<int>(materials.size()));
+    }
+    for (auto& entry : meshes) {
+        UnloadMesh(entry.second.mesh);
+    }
+    meshes.clear();
+    for (auto& entry : materials) {
+        UnloadMaterial(entry.second.material);
+    }
+    materials.clear();
+
+    if (storedDirty) {
+        WriteMeshCache();
+        storedDirty = false;
+    }
+}
+
+int ResourceCache::GetLoadedMeshCount() const {
+    return loadedMeshCount;
+}
+
+int ResourceCache::GetGeneratedMeshCount() const {
+    return generatedMeshCount;
+}
+
+const std::string& ResourceCache::GetMeshCachePath() const {
+    return meshCachePath;
+}
+
+Mesh ResourceCache::UploadStored(const StoredMesh& stored) {
+    Mesh mesh = {};
+    mesh.vertexCount = stored.vertexCount;
+    mesh.triangleCount = stored.triangleCount;
+    mesh.vertices = AllocArray(stored.vertices);
+    mesh.texcoords = AllocArray(stored.texcoords);
+    mesh.normals = AllocArray(stored.normals);
+    mesh.colors = AllocArray(stored.colors);
+    mesh.indices = AllocArray(stored.indices);
+
+    UploadMesh(&mesh, false);
+    return mesh;
+}
+
+ResourceCache::StoredMesh ResourceCache::Store(const Mesh& mesh) {
+    const std::size_t vertexCount = static_cast<std::size_t>(mesh.vertexCount);
+
+    StoredMesh stored;
+    stored.vertexCount = mesh.vertexCount;
+    stored.triangleCount = mesh.triangleCount;
+    CopyArray(mesh.vertices, vertexCount * 3, stored.vertices);
+    CopyArray(mesh.texcoords, vertexCount * 2, stored.texcoords);
+    CopyArray(mesh.normals, vertexCount * 3, stored.normals);
+    CopyArray(mesh.colors, vertexCount * 4, stored.colors);
+    CopyArray(mesh.indices, static_cast<std::size_t>(mesh.triangleCount) * 3, stored.indices);
+    return stored;
+}
+
+void ResourceCache::ReadMeshCache() {
+    storedRead = true;
+
+    std::ifstream in(meshCachePath, std::ios::binary);
+    if (!in) return;
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    // A file from another version or raylib release is regenerated in full
+    CacheCursor cursor(data);
+    MeshCacheHeader header;
+    if (!cursor.Read(&header, sizeof(header)) ||
+        std::memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 ||
+        header.version != meshCacheVersion ||
+        std::strncmp(header.raylibVersion, RAYLIB_VERSION, sizeof(header.raylibVersion)) != 0) {
+        TraceLog(LOG_INFO, "RESOURCES: %s is out of date, meshes will be regenerated", meshCachePath.c_str());
+        return;
+    }
+
+    for (std::uint32_t entry = 0; entry < header.entryCount; ++entry) {
+        std::uint32_t keyLength = 0;
+        std::int32_t counts[2] = { 0, 0 };
+        std::uint32_t arrays = 0;
+        std::string key;
+        StoredMesh stored;
+
+        bool valid = cursor.Read(&keyLength, sizeof(keyLength)) && keyLength <= 256;
+        if (valid) {
+            key.resize(keyLength);
+            valid = cursor.Read(&key[0], keyLength) && cursor.Read(counts, sizeof(counts)) &&
+                    cursor.Read(&arrays, sizeof(arrays)) && counts[0] >= 0 && counts[1] >= 0;
+        }
+        if (valid) {
+            const std::size_t vertexCount = static_cast<std::size_t>(counts[0]);
+            stored.vertexCount = counts[0];
+            stored.triangleCount = counts[1];
+            valid = (!(arrays & meshCacheVertices) || cursor.ReadArray(stored.vertices, vertexCount * 3)) &&
+                    (!(arrays & meshCacheTexcoords) || cursor.ReadArray(stored.texcoords, vertexCount * 2)) &&
+                    (!(arrays & meshCacheNormals) || cursor.ReadArray(stored.normals, vertexCount * 3)) &&
+                    (!(arrays & meshCacheColors) || cursor.ReadArray(stored.colors, vertexCount * 4)) &&
+                    (!(arrays & meshCacheIndices) || cursor.ReadArray(stored.indices, static_cast<std::size_t>(counts[1]) * 3));
+        }
+
+        // A truncated file keeps nothing, rather than half a mesh
+        if (!valid || stored.vertices.empty()) {
+            TraceLog(LOG_WARNING, "RESOURCES: %s is damaged, meshes will be regenerated", meshCachePath.c_str());
+            storedMeshes.clear();
+            return;
+        }
+        storedMeshes[key] = stored;
+    }
+}
+
+void ResourceCache::WriteMeshCache() const {
+    std::FILE* file = std::fopen(meshCachePath.c_str(), "wb");
+    if (!file) {
+        TraceLog(LOG_WARNING, "RESOURCES: cannot write %s", meshCachePath.c_str());
+        return;
+    }
+
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+    header.version = meshCacheVersion;
+    std::strncpy(header.raylibVersion, RAYLIB_VERSION, sizeof(header.raylibVersion) - 1);
+    header.entryCount = static_cast<std::uint32_t>(storedMeshes.size());
+    std::fwrite(&header, sizeof(header), 1, file);
+
+    for (const auto& entry : storedMeshes) {
+        const StoredMesh& stored = entry.second;
+        const std::uint32_t keyLength = static_cast<std::uint32_t>(entry.first.size());
+        const std::int32_t counts[2] = { stored.vertexCount, stored.triangleCount };
+        const std::uint32_t arrays = (stored.vertices.empty() ? 0 : meshCacheVertices) |
+                                     (stored.texcoords.empty() ? 0 : meshCacheTexcoords) |
+                                     (stored.normals.empty() ? 0 : meshCacheNormals) |
+                                     (stored.colors.empty() ? 0 : meshCacheColors) |
+                                     (stored.indices.empty() ? 0 : meshCacheIndices);
+
+        std::fwrite(&keyLength, sizeof(keyLength), 1, file);
+        std::fwrite(entry.first.data(), 1, keyLength, file);
+        std::fwrite(counts, sizeof(counts), 1, file);
+        std::fwrite(&arrays, sizeof(arrays), 1, file);
+        std::fwrite(stored.vertices.data(), sizeof(float), stored.vertices.size(), file);
+        std::fwrite(stored.texcoords.data(), sizeof(float), stored.texcoords.size(), file);
+        std::fwrite(stored.normals.data(), sizeof(float), stored.normals.size(), file);
+        std::fwrite(stored.colors.data(), 1, stored.colors.size(), file);
+        std::fwrite(stored.indices.data(), sizeof(unsigned short), stored.indices.size(), file);
+    }
+
+    std::fclose(file);
+}
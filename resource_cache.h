@@ -0,0 +1,103 @@
+#ifndef RESOURCE_CACHE_H
+#define RESOURCE_CACHE_H
+
+#include "raylib.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Mesh cache file layout, host byte order (a foreign file fails the magic check):
+//
+//   MeshCacheHeader
+//   entryCount entries, each
+//       uint32 key length + key
+//       int32 vertexCount, int32 triangleCount, uint32 arrays (meshCache* bits)
+//       the arrays present, in bit order
+//
+// Keys spell out the generator and its parameters ("sphere 0.5 16 16"),
+// and the header names the raylib release that generated them, so an
+// upgrade starts a fresh file instead of loading stale geometry.
+struct MeshCacheHeader {
+    char magic[4];             // "SNKM"
+    std::uint32_t version;
+    char raylibVersion[16];
+    std::uint32_t entryCount;
+};
+
+// Every GPU resource the game draws with, shared by whoever asks for the
+// same thing. Meshes are keyed by generator and parameters, materials by
+// name; each Acquire takes a reference and each Release drops one, and
+// the last Release frees it. Generated meshes are also kept in a binary
+// file so the next launch uploads them straight from disk instead of
+// generating them again. Everything lives on the thread that owns the
+// window, and Clear must run before CloseWindow.
+class ResourceCache {
+public:
+    explicit ResourceCache(const std::string& meshCachePath = "mesh_cache.bin");
+    ~ResourceCache();
+
+    ResourceCache(const ResourceCache&) = delete;
+    ResourceCache& operator=(const ResourceCache&) = delete;
+
+    Mesh AcquireSphere(float radius, int rings, int slices);
+    Mesh AcquireCone(float radius, float height, int slices);
+    Mesh AcquireCylinder(float radius, float height, int slices);
+    Mesh AcquireCube(float width, float height, float length);
+    Mesh AcquirePlane(float width, float length, int resX, int resZ);
+
+    // Default material under a name. Diffuse color and shader (compiled
+    // from source, owned by the material) only apply when it is created.
+    Material AcquireMaterial(const std::string& name, Color diffuse,
+                             const char* vertexShader = nullptr, const char* fragmentShader = nullptr);
+
+    void Release(const Mesh& mesh);
+    void Release(const Material& material);
+
+    // Frees whatever is still held and writes any newly generated meshes
+    void Clear();
+
+    int GetLoadedMeshCount() const;     // Meshes that came from the cache file
+    int GetGeneratedMeshCount() const;  // Meshes generated this run
+    const std::string& GetMeshCachePath() const;
+
+private:
+    // CPU copy of a mesh as stored in the file
+    struct StoredMesh {
+        int vertexCount;
+        int triangleCount;
+        std::vector<float> vertices;
+        std::vector<float> texcoords;
+        std::vector<float> normals;
+        std::vector<unsigned char> colors;
+        std::vector<unsigned short> indices;
+    };
+
+    struct MeshEntry {
+        Mesh mesh;
+        int references;
+    };
+
+    struct MaterialEntry {
+        Material material;
+        int references;
+    };
+
+    template <typename Generate>
+    Mesh AcquireMesh(const std::string& key, Generate generate);
+    static Mesh UploadStored(const StoredMesh& stored);
+    static StoredMesh Store(const Mesh& mesh);
+    void ReadMeshCache();
+    void WriteMeshCache() const;
+
+    std::string meshCachePath;
+    std::map<std::string, MeshEntry> meshes;
+    std::map<std::string, MaterialEntry> materials;
+    std::map<std::string, StoredMesh> storedMeshes;  // Contents of the cache file, plus this run's additions
+    bool storedRead;
+    bool storedDirty;
+    int loadedMeshCount;
+    int generatedMeshCount;
+};
+
+#endif // RESOURCE_CACHE_H
@@ -0,0 +1,18 @@
+#include "segment_kernel.h"
+
+// One axis at a time: with only three arrays in play the compiler's
+// runtime aliasing checks stay cheap enough for it to vectorize the loop
+static void BlendAxis(float* out, const float* from, const float* to, std::size_t count, float blend) {
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = from[i] + (to[i] - from[i]) * blend;
+    }
+}
+
+void BlendSegments(float* x, float* y, float* z,
+                   const float* fromX, const float* fromY, const float* fromZ,
+                   const float* toX, const float* toY, const float* toZ,
+                   std::size_t count, float blend) {
+    BlendAxis(x, fromX, toX, count, blend);
+    BlendAxis(y, fromY, toY, count, blend);
+    BlendAxis(z, fromZ, toZ, count, blend);
+}
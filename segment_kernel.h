@@ -0,0 +1,13 @@
+#ifndef SEGMENT_KERNEL_H
+#define SEGMENT_KERNEL_H
+
+#include <cstddef>
+
+// Places count segments at from + (to - from) * blend, i.e. a fraction of the
+// way between two tick states. Plain loops the compiler vectorizes by itself.
+void BlendSegments(float* x, float* y, float* z,
+                   const float* fromX, const float* fromY, const float* fromZ,
+                   const float* toX, const float* toY, const float* toZ,
+                   std::size_t count, float blend);
+
+#endif // SEGMENT_KERNEL_H
@@ -0,0 +1,86 @@
+// Simulation server: serves VectorEnvs to other local processes over a
+// Unix domain socket until interrupted (POSIX only).
+//
+//   snake_server [--socket PATH] [--threads T]
+//
+// See sim_protocol.h for the wire format and sim_client.h for a C++
+// client; snake_client measures the round trip against in-process steps.
+
+#include "sim_server.h"
+#include "trace.h"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct ServerOptions {
+    const char* socketPath = "/tmp/snake_sim.sock";
+    unsigned int threads = 0;
+};
+
+static SimServer* runningServer = nullptr;
+
+static void HandleSignal(int) {
+    if (runningServer) {
+        runningServer->Stop();
+    }
+}
+
+static bool ParseOptions(int argc, char** argv, ServerOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--socket") == 0) options.socketPath = value;
+        else if (std::strcmp(arg, "--threads") == 0) options.threads = static_cast<unsigned int>(std::atoi(value));
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: snake_server [--socket PATH] [--threads T]\n");
+        return 1;
+    }
+
+    TRACE_THREAD_NAME("Main");
+
+    SimServer server(options.threads);
+    if (!server.Listen(options.socketPath)) {
+        std::fprintf(stderr, "cannot listen on %s: %s\n", options.socketPath, std::strerror(errno));
+        return 1;
+    }
+
+    runningServer = &server;
+    std::signal(SIGINT, HandleSignal);
+    std::signal(SIGTERM, HandleSignal);
+    std::printf("listening on %s\n", options.socketPath);
+    std::fflush(stdout);
+
+    auto start = std::chrono::steady_clock::now();
+    server.Run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    runningServer = nullptr;
+
+    std::printf("served %llu requests, %llu env steps in %.1f s\n",
+                server.GetRequestCount(), server.GetStepCount(), seconds);
+
+    // Only written in SNAKE_TRACING builds
+    TRACE_DUMP("trace.json");
+
+    return 0;
+}
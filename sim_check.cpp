@@ -0,0 +1,545 @@
+// Self-checks for the simulation core. Each case plays something two ways
+// and compares the results, or feeds in bad input and expects it turned
+// down with nothing changed. Headless, like snake_bench; ctest runs it.
+//
+//   snake_check [--filter TEXT]
+//
+// Prints one line per case and exits with 1 if any of them failed.
+//
+// Cases:
+//   loadstate   SaveState/LoadState round trip, then corrupt blobs rejected
+//   replay      ReplayReader::Seek against linear playback, damaged files rejected
+//   cycle       HamiltonianCycle is one closed tour of free cells, spawn row first,
+//               and HamiltonianSolver wins a few default-arena games
+//   vecenv      VectorEnv's incremental observations against full redraws
+//   fork        GameStateArena forks and restores in lockstep with Simulation
+
+#include "simulation.h"
+#include "replay.h"
+#include "hamiltonian_cycle.h"
+#include "hamiltonian_solver.h"
+#include "vector_env.h"
+#include "game_state.h"
+#include "task_pool.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Failed expectations of the case running now
+static int failures = 0;
+
+static void Expect(bool condition, const char* what) {
+    if (!condition) {
+        std::printf("    failed: %s\n", what);
+        failures++;
+    }
+}
+
+// Any open move, starting from a random one, so games last a while
+static Direction OpenMove(const Simulation& sim, RandomStream& random) {
+    const int first = static_cast<int>(random.NextBelow(4));
+    for (int turn = 0; turn < 4; ++turn) {
+        const Direction direction = static_cast<Direction>((first + turn) & 3);
+        if (!sim.IsBlocked(Neighbor(sim.GetHead(), direction))) {
+            return direction;
+        }
+    }
+    return static_cast<Direction>(first);
+}
+
+// Plays until the snake has some length, restarting games that end early
+static void PlayFor(Simulation& sim, RandomStream& random, int ticks) {
+    for (int i = 0; i < ticks; ++i) {
+        sim.Step(OpenMove(sim, random));
+        if (sim.IsGameOver()) {
+            sim.Reset();
+        }
+    }
+}
+
+static std::string StateOf(const Simulation& sim) {
+    std::string state;
+    sim.SaveState(state);
+    return state;
+}
+
+// Offsets into a SaveState blob, as Simulation::SaveState writes it
+static const std::size_t directionOffset = sizeof(unsigned long long) + sizeof(int);
+static const std::size_t appleOffset = directionOffset + 3;
+static const std::size_t countOffset = appleOffset + sizeof(Cell);
+static const std::size_t bodyOffset = countOffset + sizeof(std::uint32_t);
+
+template <typename Value>
+static std::string Patched(std::string state, std::size_t offset, const Value& value) {
+    std::memcpy(&state[offset], &value, sizeof(value));
+    return state;
+}
+
+static void CheckLoadState() {
+    SimConfig config;
+    config.arenaSize = 10;
+    config.seed = 7;
+    Simulation sim(config);
+    sim.Initialize();
+    RandomStream random(3);
+    PlayFor(sim, random, 400);
+
+    // A copy on the same layout picks up exactly where the original is
+    Simulation copy(config);
+    copy.Initialize();
+    const std::string state = StateOf(sim);
+    Expect(copy.LoadState(state.data(), state.size()), "state loads");
+    Expect(StateOf(copy) == state, "loaded state saves back identically");
+
+    RandomStream moves(11);
+    bool same = true;
+    for (int i = 0; i < 2000 && !sim.IsGameOver(); ++i) {
+        const Direction move = OpenMove(sim, moves);
+        same = same && sim.Step(move) == copy.Step(move) && StateOf(sim) == StateOf(copy);
+    }
+    Expect(same, "copy plays on in lockstep");
+
+    // Bad blobs fail without touching the game
+    const std::string before = StateOf(copy);
+    auto rejected = [&copy, &before](const std::string& blob) {
+        return !copy.LoadState(blob.data(), blob.size()) && StateOf(copy) == before;
+    };
+
+    bool truncations = true;
+    for (std::size_t length = 0; length < state.size(); ++length) {
+        truncations = truncations && rejected(state.substr(0, length));
+    }
+    Expect(truncations, "every truncation is rejected");
+
+    Expect(rejected(Patched(state, directionOffset, static_cast<std::uint8_t>(7))), "direction out of range");
+    Expect(rejected(Patched(state, directionOffset + 1, static_cast<std::uint8_t>(4))), "queued direction out of range");
+    // Flags byte 2 = has an apple, so the apple cell counts
+    const std::string withApple = Patched(state, directionOffset + 2, static_cast<std::uint8_t>(2));
+    Expect(rejected(Patched(withApple, appleOffset, Cell{100000, 100000})), "apple far outside the arena");
+    Expect(rejected(Patched(withApple, appleOffset, Cell{config.arenaSize + 1, 0})), "apple on the wall");
+    Expect(rejected(Patched(state, countOffset, static_cast<std::uint32_t>(0))), "empty body");
+    Expect(rejected(Patched(state, countOffset, static_cast<std::uint32_t>(0xffffffffu))), "body longer than the blob");
+
+    std::uint32_t length;
+    std::memcpy(&length, &state[countOffset], sizeof(length));
+    Expect(length >= 3, "game grew a body to corrupt");
+
+    // The same blob with another body, tail first
+    auto withBody = [&state, length](const std::vector<Cell>& cells) {
+        std::string blob = Patched(state, countOffset, static_cast<std::uint32_t>(cells.size()));
+        blob.replace(bodyOffset, length * sizeof(Cell),
+                     reinterpret_cast<const char*>(cells.data()), cells.size() * sizeof(Cell));
+        return blob;
+    };
+
+    // Some open 2x2 block to lay test bodies on
+    const OccupancyGrid& grid = sim.GetGrid();
+    Cell corner = Cell{0, 0};
+    bool found = false;
+    for (int z = -config.arenaSize; z < config.arenaSize && !found; ++z) {
+        for (int x = -config.arenaSize; x < config.arenaSize && !found; ++x) {
+            corner = Cell{x, z};
+            found = !grid.IsStatic(corner) && !grid.IsStatic(Cell{x + 1, z}) &&
+                    !grid.IsStatic(Cell{x, z + 1}) && !grid.IsStatic(Cell{x + 1, z + 1});
+        }
+    }
+    const Cell a = corner, b = Cell{corner.x + 1, corner.z};
+    const Cell c = Cell{corner.x + 1, corner.z + 1}, d = Cell{corner.x, corner.z + 1};
+    Simulation scratch(config);
+    scratch.Initialize();
+    const std::string handBuilt = withBody({ a, b, c, d });
+    Expect(found && scratch.LoadState(handBuilt.data(), handBuilt.size()), "a body built by hand loads");
+    Expect(rejected(withBody({ a, c, d })), "gap in the body");
+    Expect(rejected(withBody({ a, b, c, d, a })), "body crossing itself");
+    Expect(rejected(withBody({ Cell{config.arenaSize + 1, 0}, Cell{config.arenaSize, 0} })), "segment on the wall");
+
+    // A live head on an obstacle, next to an open neck
+    bool obstacle = false;
+    for (int z = -config.arenaSize; z <= config.arenaSize && !obstacle; ++z) {
+        for (int x = -config.arenaSize; x <= config.arenaSize && !obstacle; ++x) {
+            if (!grid.IsStatic(Cell{x, z})) continue;
+            for (int dir = 0; dir < 4 && !obstacle; ++dir) {
+                const Cell neck = Neighbor(Cell{x, z}, static_cast<Direction>(dir));
+                if (std::abs(neck.x) > config.arenaSize || std::abs(neck.z) > config.arenaSize ||
+                    grid.IsStatic(neck)) {
+                    continue;
+                }
+                Expect(rejected(withBody({ neck, Cell{x, z} })), "live head on an obstacle");
+                obstacle = true;
+            }
+        }
+    }
+    Expect(obstacle, "layout has an obstacle to test against");
+
+    // Flags byte 4 = game over
+    const std::string over = Patched(state, directionOffset + 2, static_cast<std::uint8_t>(4));
+    Expect(!scratch.LoadState(over.data(), over.size(), false), "finished game turned down when asked");
+    Expect(scratch.LoadState(over.data(), over.size()) && scratch.IsGameOver(), "finished game loads otherwise");
+
+    const std::size_t freeOffset = bodyOffset + length * sizeof(Cell);
+    Expect(rejected(Patched(state, freeOffset + sizeof(std::uint32_t), static_cast<std::int32_t>(-1))),
+           "free cell index out of range");
+    Expect(rejected(Patched(state, freeOffset, static_cast<std::uint32_t>(0x7fffffffu))), "free list longer than the blob");
+}
+
+static std::string ReadFile(const char* path) {
+    std::string bytes;
+    if (std::FILE* file = std::fopen(path, "rb")) {
+        char buffer[4096];
+        std::size_t count;
+        while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            bytes.append(buffer, count);
+        }
+        std::fclose(file);
+    }
+    return bytes;
+}
+
+static void WriteFile(const char* path, const std::string& bytes) {
+    if (std::FILE* file = std::fopen(path, "wb")) {
+        std::fwrite(bytes.data(), 1, bytes.size(), file);
+        std::fclose(file);
+    }
+}
+
+static void CheckReplay() {
+    const char* path = "snake_check_replay.snkr";
+
+    // Small blocks, so seeks land in many of them and mid-block
+    SimConfig config;
+    config.arenaSize = 10;
+    config.seed = 5;
+    Simulation sim(config);
+    sim.Initialize();
+    ReplayWriter writer;
+    Expect(writer.Open(path, sim, 64), "recording opens");
+
+    std::vector<std::string> states(1, StateOf(sim));
+    RandomStream random(9);
+    while (!sim.IsGameOver() && sim.GetTick() < 3000) {
+        sim.Step(OpenMove(sim, random));
+        writer.Record(sim);
+        states.push_back(StateOf(sim));
+    }
+    Expect(writer.Close(), "recording closes cleanly");
+
+    ReplayReader reader;
+    Expect(reader.Open(path), "recording reads back");
+    Expect(reader.GetTickCount() + 1 == states.size(), "tick count matches");
+
+    // Linear playback passes through every recorded state
+    Simulation replay(reader.GetConfig());
+    replay.Initialize();
+    bool linear = reader.Seek(replay, 0) && StateOf(replay) == states[0];
+    for (std::uint64_t tick = 0; tick < reader.GetTickCount(); ++tick) {
+        replay.Step(reader.GetDirection(tick, replay.GetDirection()));
+        linear = linear && StateOf(replay) == states[tick + 1];
+    }
+    Expect(linear, "linear playback matches the game");
+
+    // Seeking anywhere, in any order, lands on the same state
+    bool seeks = true;
+    for (std::uint64_t tick = 0; tick <= reader.GetTickCount(); tick += 1 + tick % 37) {
+        const std::uint64_t target = reader.GetTickCount() - tick;
+        seeks = seeks && reader.Seek(replay, target) && StateOf(replay) == states[target];
+    }
+    Expect(seeks, "seeks match linear playback");
+    reader.Close();
+
+    // Damaged copies must fail in Open, not later
+    const std::string bytes = ReadFile(path);
+    bool truncations = true;
+    for (std::size_t length = 0; length < bytes.size(); length += 1 + length / 8) {
+        WriteFile(path, bytes.substr(0, length));
+        truncations = truncations && !reader.Open(path);
+    }
+    Expect(truncations, "truncated files are rejected");
+
+    ReplayHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    const std::uint64_t badOffset = bytes.size() * 2;
+    WriteFile(path, Patched(bytes, header.indexOffset + sizeof(std::uint64_t), badOffset));
+    Expect(!reader.Open(path), "block offset past the end is rejected");
+    WriteFile(path, Patched(bytes, offsetof(ReplayHeader, tickCount), header.tickCount + 10 * header.ticksPerBlock));
+    Expect(!reader.Open(path), "tick count beyond the blocks is rejected");
+
+    std::uint64_t lastBlock;
+    std::memcpy(&lastBlock, &bytes[header.indexOffset + (header.blockCount - 1) * sizeof(std::uint64_t)], sizeof(lastBlock));
+    WriteFile(path, Patched(bytes, lastBlock, static_cast<std::uint32_t>(0x7fffffffu)));
+    Expect(!reader.Open(path), "block state running past the index is rejected");
+    std::remove(path);
+
+    // A full disk shows up in Close
+    ReplayWriter full;
+    if (full.Open("/dev/full", sim, 64)) {
+        for (int i = 0; i < 100000; ++i) {
+            full.Record(sim);
+        }
+        Expect(!full.Close(), "failed writes are reported");
+    }
+}
+
+static void CheckCycle() {
+    bool built = true, closed = true, free = true, unique = true, spawnRow = true;
+    for (int arenaSize : { 3, 5, 8, SimConfig().arenaSize }) {
+        for (std::uint64_t seed = 0; seed < 20; ++seed) {
+            SimConfig config;
+            config.arenaSize = arenaSize;
+            config.seed = seed;
+            Simulation sim(config);
+            sim.Initialize();
+
+            const OccupancyGrid& grid = sim.GetGrid();
+            // Small arenas may have no tour through the spawn row; the default must
+            HamiltonianCycle cycle;
+            if (!cycle.Build(grid, Cell{-2, 0}, 3)) {
+                built = built && arenaSize != SimConfig().arenaSize;
+                continue;
+            }
+
+            std::vector<char> seen(grid.CellCount(), 0);
+            for (int position = 0; position < cycle.Length(); ++position) {
+                const int index = cycle.CellAtOrder(position);
+                const Cell cell = grid.CellAt(index);
+                const Cell next = grid.CellAt(cycle.CellAtOrder((position + 1) % cycle.Length()));
+                closed = closed && std::abs(cell.x - next.x) + std::abs(cell.z - next.z) == 1;
+                free = free && grid.InArena(cell) && !grid.IsStatic(cell);
+                unique = unique && !seen[index] && cycle.OrderOf(index) == position;
+                seen[index] = 1;
+            }
+            for (int k = 0; k < 3; ++k) {
+                spawnRow = spawnRow && grid.CellAt(cycle.CellAtOrder(k)) == Cell{k - 2, 0};
+            }
+        }
+    }
+    Expect(closed, "consecutive tour cells are neighbors, last to first too");
+    Expect(free, "the tour stays on free arena cells");
+    Expect(unique, "every cell is on the tour once, at its OrderOf");
+    Expect(spawnRow, "the tour starts along the spawn row");
+    Expect(built, "every default-arena layout has a tour");
+
+    // The solver plays for the full board; these seeds must clear it
+    HamiltonianSolver solver;
+    int wins = 0;
+    for (std::uint64_t seed = 0; seed < 16; ++seed) {
+        SimConfig config;
+        config.seed = seed;
+        Simulation sim(config);
+        sim.Initialize();
+        solver.Reset();
+        while (!sim.IsGameOver() && sim.GetTick() < 3000000) {
+            sim.Step(solver.Decide(sim));
+        }
+        wins += sim.HasWon() ? 1 : 0;
+    }
+    Expect(wins == 16, "the cycle solver wins default-arena games");
+}
+
+static void CheckVectorEnv() {
+    VectorEnvConfig config;
+    config.envCount = 40;  // Blocks of 16 on the pool, the last one short
+    config.sim.arenaSize = 6;
+    config.seed = 4;
+    config.maxTicks = 600;
+    config.starveTicks = 150;  // Truncations restart envs as well as deaths
+    VectorEnv env(config);
+    TaskPool pool(2);
+
+    const int count = env.GetEnvCount();
+    const std::size_t size = env.GetObservationSize();
+    std::vector<std::uint8_t> observations(count * size), other(count * size), redrawn(size);
+    std::vector<int> actions(count);
+    std::vector<float> rewards(count);
+    std::vector<std::uint8_t> dones(count);
+
+    // Every env's part of the buffer must equal a redraw from scratch
+    auto matches = [&](const std::vector<std::uint8_t>& buffer) {
+        bool same = true;
+        for (int i = 0; i < count; ++i) {
+            env.WriteObservation(i, redrawn.data());
+            same = same && std::memcmp(buffer.data() + i * size, redrawn.data(), size) == 0;
+        }
+        return same;
+    };
+
+    env.Reset(observations.data());
+    Expect(matches(observations), "reset writes full observations");
+
+    RandomStream random(21);
+    bool incremental = true, swapped = true, finished = false;
+    for (int step = 0; step < 3000; ++step) {
+        // Mostly open moves; now and then a reversal or junk, which keeps the heading
+        for (int i = 0; i < count; ++i) {
+            const std::uint32_t roll = random.NextBelow(20);
+            actions[i] = roll == 0 ? 9 : roll == 1 ? static_cast<int>(random.NextBelow(4))
+                                                   : static_cast<int>(OpenMove(env.GetSimulation(i), random));
+        }
+
+        // Every 500 steps one step goes to another buffer and back, which forces redraws
+        std::vector<std::uint8_t>& buffer = step % 500 == 250 ? other : observations;
+        env.Step(actions.data(), buffer.data(), rewards.data(), dones.data(), step % 2 ? &pool : nullptr);
+        if (&buffer == &other) {
+            swapped = swapped && matches(other);
+        } else {
+            incremental = incremental && matches(observations);
+        }
+        for (std::uint8_t done : dones) {
+            finished = finished || done != envRunning;
+        }
+    }
+    Expect(finished, "episodes ended and restarted along the way");
+    Expect(incremental, "incremental steps match redraws");
+    Expect(swapped, "a different buffer gets redrawn");
+
+    // Loading a state redraws that env, and steps carry on incrementally from it
+    const std::string saved = StateOf(env.GetSimulation(3));
+    for (int step = 0; step < 50; ++step) {
+        for (int i = 0; i < count; ++i) {
+            actions[i] = static_cast<int>(OpenMove(env.GetSimulation(i), random));
+        }
+        env.Step(actions.data(), observations.data(), rewards.data(), dones.data(), &pool);
+    }
+    Expect(env.LoadState(3, saved.data(), saved.size(), observations.data()), "saved state loads back");
+    Expect(StateOf(env.GetSimulation(3)) == saved, "loaded env is the saved game");
+    bool resumed = matches(observations);
+    for (int step = 0; step < 100; ++step) {
+        for (int i = 0; i < count; ++i) {
+            actions[i] = static_cast<int>(OpenMove(env.GetSimulation(i), random));
+        }
+        env.Step(actions.data(), observations.data(), rewards.data(), dones.data(), &pool);
+        resumed = resumed && matches(observations);
+    }
+    Expect(resumed, "steps after LoadState match redraws");
+
+    // A finished game is turned down and the env keeps its game and observation
+    const std::string before = StateOf(env.GetSimulation(5));
+    const std::uint8_t flags = static_cast<std::uint8_t>(before[directionOffset + 2]);
+    const std::string dead = Patched(before, directionOffset + 2, static_cast<std::uint8_t>(flags | 4));  // Game over
+    const std::vector<std::uint8_t> observed = observations;
+    Expect(!env.LoadState(5, dead.data(), dead.size(), observations.data()), "finished game is rejected");
+    Expect(StateOf(env.GetSimulation(5)) == before && observations == observed, "rejected load changes nothing");
+}
+
+// Same game, as far as a GameState can tell
+static bool SameGame(const GameStateArena& arena, const GameState& state, const Simulation& sim) {
+    std::vector<Cell> body;
+    arena.CopyBody(state, body);
+    bool same = body.size() == sim.GetBody().Size() && state.length == body.size() &&
+                state.head == sim.GetHead() && state.tail == sim.GetBody().Tail() &&
+                state.tick == sim.GetTick() && state.score == sim.GetScore() &&
+                state.gameOver == sim.IsGameOver() && state.shouldGrow == sim.IsGrowing() &&
+                state.direction == sim.GetDirection();
+    for (std::size_t i = 0; same && i < body.size(); ++i) {
+        same = body[i] == sim.GetBody()[i];
+    }
+    return same;
+}
+
+static void CheckFork() {
+    bool captured = true, lockstep = true, untouched = true, restored = true, recycled = true;
+    int apples = 0;
+
+    for (std::uint64_t seed = 0; seed < 20; ++seed) {
+        SimConfig config;
+        config.arenaSize = 8;
+        config.seed = seed;
+        Simulation sim(config);
+        sim.Initialize();
+        RandomStream random(seed + 100);
+        PlayFor(sim, random, 50 + static_cast<int>(seed) * 7);
+        if (sim.IsGameOver()) continue;
+
+        GameStateArena arena(std::make_shared<const GameLayout>(sim));
+        const GameState root = arena.Capture(sim);
+        captured = captured && SameGame(arena, root, sim);
+
+        // A fork plays exactly like the game until the first apple it eats
+        Simulation copy(config);
+        copy.Initialize();
+        const std::string state = StateOf(sim);
+        copy.LoadState(state.data(), state.size());
+
+        GameState fork = arena.Fork(root);
+        std::vector<Direction> moves;
+        for (int i = 0; i < 400 && !copy.IsGameOver(); ++i) {
+            const Direction move = OpenMove(copy, random);
+            moves.push_back(move);
+            const StepResult result = copy.Step(move);
+            lockstep = lockstep && arena.Step(fork, move) == result && SameGame(arena, fork, copy);
+            if (result == StepResult::ATE_APPLE) {
+                apples++;
+                break;
+            }
+        }
+        untouched = untouched && SameGame(arena, root, sim);
+
+        // Restore brings a used fork back to the root, in its own block, and
+        // it then replays the same moves the same way
+        GameState other = arena.Fork(root);
+        for (Direction move : moves) {
+            arena.Step(other, move);
+        }
+        arena.Restore(other, root);
+        restored = restored && SameGame(arena, other, sim) && other.block != root.block;
+        for (Direction move : moves) {
+            arena.Step(other, move);
+        }
+        restored = restored && SameGame(arena, other, copy);
+
+        // Released blocks are handed out again rather than new ones
+        const std::size_t inUse = arena.GetBlocksInUse();
+        arena.Release(fork);
+        arena.Release(other);
+        for (int i = 0; i < 10; ++i) {
+            arena.Release(arena.Fork(root));
+        }
+        recycled = recycled && arena.GetBlocksInUse() == inUse - 2;
+    }
+
+    Expect(apples > 0, "some forks reached an apple");
+    Expect(captured, "captured state matches the game");
+    Expect(lockstep, "forks step like Simulation until the first apple");
+    Expect(untouched, "stepping a fork leaves its root alone");
+    Expect(restored, "restored forks match the root and replay the same");
+    Expect(recycled, "released blocks are reused");
+}
+
+int main(int argc, char** argv) {
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::fprintf(stderr, "usage: snake_check [--filter TEXT]\n");
+            return 1;
+        }
+    }
+
+    struct Case {
+        const char* name;
+        std::function<void()> run;
+    };
+    const Case cases[] = {
+        { "loadstate", CheckLoadState },
+        { "replay", CheckReplay },
+        { "cycle", CheckCycle },
+        { "vecenv", CheckVectorEnv },
+        { "fork", CheckFork },
+    };
+
+    int failed = 0;
+    for (const Case& check : cases) {
+        if (filter && !std::strstr(check.name, filter)) continue;
+
+        failures = 0;
+        check.run();
+        std::printf("%-12s %s\n", check.name, failures == 0 ? "ok" : "FAILED");
+        failed += failures > 0 ? 1 : 0;
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+#include "sim_client.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#if defined(MSG_NOSIGNAL)
+static const int sendFlags = MSG_NOSIGNAL;  // A vanished server is an error code, not SIGPIPE
+#else
+static const int sendFlags = 0;
+#endif
+
+SimClient::SimClient() :
+    fd(-1),
+    lastStatus(statusOk) {
+}
+
+SimClient::~SimClient() {
+    Disconnect();
+}
+
+bool SimClient::Connect(const std::string& path) {
+    Disconnect();
+
+    sockaddr_un address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    lastStatus = statusOk;
+    return true;
+}
+
+void SimClient::Disconnect() {
+    while (!mappings.empty()) {
+        Unmap(mappings.begin()->first);
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+}
+
+bool SimClient::IsConnected() const {
+    return fd >= 0;
+}
+
+bool SimClient::Create(const VectorEnvConfig& config, RemoteEnvInfo& env) {
+    CreateRequest create = CreateRequest();
+    create.version = simProtocolVersion;
+    create.envCount = static_cast<std::uint32_t>(config.envCount);
+    create.arenaSize = config.sim.arenaSize;
+    create.maxObstacles = config.sim.maxObstacles;
+    create.seed = config.seed;
+    create.maxTicks = config.maxTicks;
+    create.starveTicks = config.starveTicks;
+    create.appleReward = config.appleReward;
+    create.deathReward = config.deathReward;
+
+    std::uint32_t size = 0;
+    int shared = -1;
+    if (!Send(messageCreate, &create, sizeof(create), nullptr, 0) || !Receive(messageCreate, size, &shared)) {
+        if (shared >= 0) close(shared);
+        return false;
+    }
+
+    CreateReply reply;
+    if (size != sizeof(reply) || shared < 0 || !ReadExact(&reply, sizeof(reply))) {
+        if (shared >= 0) close(shared);
+        return Fail();
+    }
+
+    void* mapping = mmap(nullptr, reply.mappingSize, PROT_READ, MAP_SHARED, shared, 0);
+    close(shared);
+    if (mapping == MAP_FAILED) {
+        // The env exists but is no use without its observations
+        RemoteEnvInfo orphan;
+        orphan.handle = reply.handle;
+        Destroy(orphan);
+        lastStatus = statusFailed;
+        return false;
+    }
+    mappings[reply.handle] = std::make_pair(mapping, static_cast<std::size_t>(reply.mappingSize));
+
+    env.handle = reply.handle;
+    env.envCount = static_cast<int>(reply.envCount);
+    env.gridWidth = static_cast<int>(reply.gridWidth);
+    env.observationSize = reply.observationSize;
+    env.observations = static_cast<const std::uint8_t*>(mapping);
+    return true;
+}
+
+bool SimClient::Reset(const RemoteEnvInfo& env) {
+    EnvRequest target = { env.handle, 0 };
+    std::uint32_t size = 0;
+    return Send(messageReset, &target, sizeof(target), nullptr, 0) && Receive(messageReset, size) &&
+           (size == 0 || Fail());
+}
+
+bool SimClient::Step(const RemoteEnvInfo& env, const std::uint8_t* actions, float* rewards, std::uint8_t* dones) {
+    const std::size_t count = static_cast<std::size_t>(env.envCount);
+    EnvRequest target = { env.handle, 0 };
+    std::uint32_t size = 0;
+    if (!Send(messageStep, &target, sizeof(target), actions, count) || !Receive(messageStep, size)) {
+        return false;
+    }
+    if (size != count * sizeof(float) + count) return Fail();
+    return ReadExact(rewards, count * sizeof(float)) && ReadExact(dones, count);
+}
+
+bool SimClient::Snapshot(const RemoteEnvInfo& env, int index, SnapshotReply& summary, std::string& state) {
+    EnvRequest target = { env.handle, static_cast<std::uint32_t>(index) };
+    std::uint32_t size = 0;
+    if (!Send(messageSnapshot, &target, sizeof(target), nullptr, 0) || !Receive(messageSnapshot, size)) {
+        return false;
+    }
+    if (size < sizeof(summary) || !ReadExact(&summary, sizeof(summary)) ||
+        size - sizeof(summary) != summary.stateSize) {
+        return Fail();
+    }
+    state.resize(summary.stateSize);
+    return ReadExact(&state[0], state.size());
+}
+
+bool SimClient::Restore(const RemoteEnvInfo& env, int index, const std::string& state) {
+    EnvRequest target = { env.handle, static_cast<std::uint32_t>(index) };
+    std::uint32_t size = 0;
+    return Send(messageRestore, &target, sizeof(target), state.data(), state.size()) &&
+           Receive(messageRestore, size) && (size == 0 || Fail());
+}
+
+bool SimClient::Destroy(RemoteEnvInfo& env) {
+    Unmap(env.handle);
+    env.observations = nullptr;
+
+    EnvRequest target = { env.handle, 0 };
+    std::uint32_t size = 0;
+    return Send(messageDestroy, &target, sizeof(target), nullptr, 0) && Receive(messageDestroy, size) &&
+           (size == 0 || Fail());
+}
+
+std::uint16_t SimClient::GetLastStatus() const {
+    return lastStatus;
+}
+
+bool SimClient::Send(std::uint16_t type, const void* head, std::size_t headSize, const void* body, std::size_t bodySize) {
+    if (fd < 0) {
+        lastStatus = statusFailed;
+        return false;
+    }
+
+    // One buffer, one send: a request never goes out in pieces
+    MessageHeader header;
+    header.type = type;
+    header.status = 0;
+    header.size = static_cast<std::uint32_t>(headSize + bodySize);
+    request.resize(sizeof(header) + headSize + bodySize);
+    std::memcpy(request.data(), &header, sizeof(header));
+    std::memcpy(request.data() + sizeof(header), head, headSize);
+    if (bodySize > 0) {
+        std::memcpy(request.data() + sizeof(header) + headSize, body, bodySize);
+    }
+
+    std::size_t sent = 0;
+    while (sent < request.size()) {
+        ssize_t count = send(fd, request.data() + sent, request.size() - sent, sendFlags);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return Fail();
+        sent += static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+bool SimClient::Receive(std::uint16_t type, std::uint32_t& size, int* passedFd) {
+    MessageHeader header;
+    iovec part = { &header, sizeof(header) };
+    msghdr message = msghdr();
+    message.msg_iov = &part;
+    message.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    ssize_t count;
+    do {
+        count = recvmsg(fd, &message, MSG_WAITALL);
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) return Fail();
+
+    // Only a create reply carries an fd; close anything else that turns up
+    for (cmsghdr* item = CMSG_FIRSTHDR(&message); item; item = CMSG_NXTHDR(&message, item)) {
+        if (item->cmsg_level == SOL_SOCKET && item->cmsg_type == SCM_RIGHTS) {
+            int passed;
+            std::memcpy(&passed, CMSG_DATA(item), sizeof(passed));
+            if (passedFd && *passedFd < 0) {
+                *passedFd = passed;
+            } else {
+                close(passed);
+            }
+        }
+    }
+
+    const std::size_t have = static_cast<std::size_t>(count);
+    if (have < sizeof(header) && !ReadExact(reinterpret_cast<char*>(&header) + have, sizeof(header) - have)) {
+        return false;
+    }
+    if (header.type != type || header.size > simMaxPayload) return Fail();
+
+    lastStatus = header.status;
+    size = header.size;
+    if (header.status != statusOk) {
+        // Error replies have no payload, but skip one rather than lose sync
+        char skip[256];
+        while (size > 0) {
+            std::size_t chunk = size < sizeof(skip) ? size : sizeof(skip);
+            if (!ReadExact(skip, chunk)) return false;
+            size -= static_cast<std::uint32_t>(chunk);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool SimClient::ReadExact(void* out, std::size_t size) {
+    char* bytes = static_cast<char*>(out);
+    while (size > 0) {
+        ssize_t count = recv(fd, bytes, size, MSG_WAITALL);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return Fail();
+        bytes += count;
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+void SimClient::Unmap(std::uint32_t handle) {
+    auto found = mappings.find(handle);
+    if (found == mappings.end()) return;
+    munmap(found->second.first, found->second.second);
+    mappings.erase(found);
+}
+
+// Anything unexpected on the wire leaves the stream out of sync, so the
+// connection is dropped rather than trusted any further
+bool SimClient::Fail() {
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    lastStatus = statusFailed;
+    return false;
+}
@@ -0,0 +1,62 @@
+#ifndef SIM_CLIENT_H
+#define SIM_CLIENT_H
+
+#include "sim_protocol.h"
+#include "vector_env.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Server-side VectorEnv as seen from a client. observations points into
+// memory shared with the server, laid out as in VectorEnv, and is read-only.
+struct RemoteEnvInfo {
+    std::uint32_t handle = 0;
+    int envCount = 0;
+    int gridWidth = 0;
+    std::size_t observationSize = 0;  // Bytes per env
+    const std::uint8_t* observations = nullptr;
+};
+
+// Blocking client for snake_server, one connection (POSIX only). Every
+// call is one round trip and returns false on a failed request or a lost
+// connection; GetLastStatus tells which. Not thread-safe - give each
+// thread its own client.
+class SimClient {
+public:
+    SimClient();
+    ~SimClient();
+
+    SimClient(const SimClient&) = delete;
+    SimClient& operator=(const SimClient&) = delete;
+
+    bool Connect(const std::string& path);
+    void Disconnect();  // Also unmaps every env's observations
+    bool IsConnected() const;
+
+    // Envs start playing on creation; their first observations are ready
+    bool Create(const VectorEnvConfig& config, RemoteEnvInfo& env);
+    bool Reset(const RemoteEnvInfo& env);
+    // actions: envCount Direction values. rewards and dones as in VectorEnv::Step.
+    bool Step(const RemoteEnvInfo& env, const std::uint8_t* actions, float* rewards, std::uint8_t* dones);
+    bool Snapshot(const RemoteEnvInfo& env, int index, SnapshotReply& summary, std::string& state);
+    bool Restore(const RemoteEnvInfo& env, int index, const std::string& state);
+    bool Destroy(RemoteEnvInfo& env);
+
+    std::uint16_t GetLastStatus() const;  // statusOk, an error status, or statusFailed for a lost connection
+
+private:
+    bool Send(std::uint16_t type, const void* head, std::size_t headSize, const void* body, std::size_t bodySize);
+    bool Receive(std::uint16_t type, std::uint32_t& size, int* passedFd = nullptr);  // Reads the reply header
+    bool ReadExact(void* out, std::size_t size);
+    void Unmap(std::uint32_t handle);
+    bool Fail();
+
+    int fd;
+    std::uint16_t lastStatus;
+    std::vector<char> request;  // Reused so steps allocate nothing
+    std::map<std::uint32_t, std::pair<void*, std::size_t>> mappings;  // Per handle
+};
+
+#endif // SIM_CLIENT_H
@@ -0,0 +1,97 @@
+#ifndef SIM_PROTOCOL_H
+#define SIM_PROTOCOL_H
+
+#include <cstdint>
+
+// Wire format between snake_server and its clients over a Unix domain
+// socket, host byte order - both ends are on the same machine. Every
+// message, either way, is a MessageHeader followed by `size` payload
+// bytes. A client sends one request and reads one reply per request;
+// requests it sends ahead are answered in order.
+//
+//   request          payload                                  reply payload
+//   messageCreate    CreateRequest                            CreateReply + the observation fd
+//   messageReset     EnvRequest (env ignored)                 -
+//   messageStep      EnvRequest (env ignored) + uint8 actions[envCount]
+//                                                             float rewards[envCount] + uint8 dones[envCount]
+//   messageSnapshot  EnvRequest                               SnapshotReply + stateSize state bytes
+//   messageRestore   EnvRequest + state bytes                 -
+//   messageDestroy   EnvRequest (env ignored)                 -
+//
+// Observations never travel over the socket. The create reply passes a
+// shared memory fd (SCM_RIGHTS) the client maps read-only; the server
+// writes VectorEnv observations straight into it, [env][channel][z][x]
+// as in vector_env.h, and they are up to date when a reset, step or
+// restore reply arrives. A step only touches the bytes that changed.
+//
+// Actions are Direction values; anything else keeps the heading. Dones
+// are the envRunning / envTerminated / envTruncated flags, and finished
+// envs restart within the step as in VectorEnv.
+
+static const std::uint32_t simProtocolVersion = 1;
+
+// Bigger payloads are taken as garbage and drop the connection
+static const std::uint32_t simMaxPayload = 64u << 20;
+
+enum MessageType : std::uint16_t {
+    messageCreate = 1,
+    messageReset = 2,
+    messageStep = 3,
+    messageSnapshot = 4,
+    messageRestore = 5,
+    messageDestroy = 6
+};
+
+enum MessageStatus : std::uint16_t {
+    statusOk = 0,
+    statusBadRequest = 1,  // Unknown type, wrong payload size or out of range values
+    statusBadHandle = 2,   // Not an env of this connection
+    statusFailed = 3       // Valid request the server could not carry out
+};
+
+struct MessageHeader {
+    std::uint16_t type;    // Replies repeat the request's type
+    std::uint16_t status;  // Replies only; 0 in requests
+    std::uint32_t size;    // Payload bytes that follow
+};
+
+struct CreateRequest {
+    std::uint32_t version;      // simProtocolVersion
+    std::uint32_t envCount;
+    std::int32_t arenaSize;
+    std::int32_t maxObstacles;
+    std::uint64_t seed;
+    std::uint64_t maxTicks;
+    std::uint64_t starveTicks;
+    float appleReward;
+    float deathReward;
+};
+
+struct CreateReply {
+    std::uint32_t handle;           // Names the env in later requests; per connection
+    std::uint32_t envCount;
+    std::uint32_t gridWidth;
+    std::uint32_t observationSize;  // Bytes per env
+    std::uint64_t mappingSize;      // Bytes to map from the fd
+};
+
+struct EnvRequest {
+    std::uint32_t handle;
+    std::uint32_t env;  // Index within the batch, where it matters
+};
+
+struct SnapshotReply {
+    std::uint64_t tick;
+    std::int32_t score;
+    std::int32_t length;
+    std::int32_t headX;
+    std::int32_t headZ;
+    std::int32_t appleX;
+    std::int32_t appleZ;
+    std::uint8_t direction;
+    std::uint8_t hasApple;
+    std::uint8_t padding[2];
+    std::uint32_t stateSize;  // Simulation::SaveState bytes that follow, for messageRestore
+};
+
+#endif // SIM_PROTOCOL_H
@@ -0,0 +1,531 @@
+#include "sim_server.h"
+#include "trace.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Largest observation mapping one create may ask for
+static const std::uint64_t maxMappingSize = 1ull << 30;
+
+// Bytes read from a socket per readable event
+static const std::size_t receiveChunk = 64 * 1024;
+
+#if defined(MSG_NOSIGNAL)
+static const int sendFlags = MSG_NOSIGNAL;  // A vanished client is an error code, not SIGPIPE
+#else
+static const int sendFlags = 0;
+#endif
+
+static bool SetNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 &&
+           fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+}
+
+// Anonymous shared memory: the name is unlinked straight away, so the
+// segment lives exactly as long as the last fd or mapping of it
+static int CreateSharedMemory(std::size_t size) {
+    static std::atomic<unsigned int> counter(0);
+
+    char name[64];
+    std::snprintf(name, sizeof(name), "/snake_sim.%d.%u", static_cast<int>(getpid()), counter++);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return -1;
+    shm_unlink(name);
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool HasRequest(const std::vector<char>& input) {
+    if (input.size() < sizeof(MessageHeader)) return false;
+    MessageHeader header;
+    std::memcpy(&header, input.data(), sizeof(header));
+    return input.size() - sizeof(header) >= header.size;
+}
+
+SimServer::SimServer(unsigned int threadCount) :
+    pool(threadCount),
+    listenFd(-1),
+    stopping(false),
+    requests(0),
+    steps(0) {
+    wakeFds[0] = wakeFds[1] = -1;
+    if (pipe(wakeFds) == 0) {
+        SetNonBlocking(wakeFds[0]);
+        SetNonBlocking(wakeFds[1]);
+    }
+}
+
+SimServer::~SimServer() {
+    pool.Wait();
+    for (auto& connection : connections) {
+        Close(*connection);
+        for (auto& entry : connection->envs) {
+            FreeEnv(entry.second);
+        }
+    }
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (wakeFds[0] >= 0) close(wakeFds[0]);
+    if (wakeFds[1] >= 0) close(wakeFds[1]);
+}
+
+bool SimServer::Listen(const std::string& path) {
+    sockaddr_un address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path) || wakeFds[0] < 0) {
+        errno = EINVAL;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        // Taken - unless nobody answers there, which is a crashed server's leftover
+        int probe = errno == EADDRINUSE ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+        bool stale = probe >= 0 &&
+                     connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 &&
+                     errno == ECONNREFUSED;
+        if (probe >= 0) close(probe);
+
+        if (!stale || unlink(path.c_str()) != 0 ||
+            bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            int error = stale ? errno : EADDRINUSE;
+            close(fd);
+            errno = error;
+            return false;
+        }
+    }
+
+    if (!SetNonBlocking(fd) || listen(fd, SOMAXCONN) != 0) {
+        int error = errno;
+        close(fd);
+        unlink(path.c_str());
+        errno = error;
+        return false;
+    }
+
+    listenFd = fd;
+    socketPath = path;
+    return true;
+}
+
+void SimServer::Run() {
+    TRACE_THREAD_NAME("Server loop");
+
+    std::vector<pollfd> polls;
+    std::vector<Connection*> polled;  // Connection of polls[i + 2]
+    while (!stopping) {
+        polls.clear();
+        polled.clear();
+        polls.push_back(pollfd{ listenFd, POLLIN, 0 });
+        polls.push_back(pollfd{ wakeFds[0], POLLIN, 0 });
+
+        // Busy connections sit out; whatever they sent next waits in the kernel
+        for (auto& connection : connections) {
+            Connection& c = *connection;
+            if (c.closing || c.busy) continue;
+
+            short events = c.sent < c.output.size() ? POLLOUT : HasRequest(c.input) ? 0 : POLLIN;
+            if (events == 0) continue;
+            polls.push_back(pollfd{ c.fd, events, 0 });
+            polled.push_back(&c);
+        }
+
+        if (poll(polls.data(), polls.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::perror("poll");
+            break;
+        }
+
+        if (polls[1].revents & POLLIN) {
+            char drain[256];
+            while (read(wakeFds[0], drain, sizeof(drain)) > 0) {
+            }
+            CollectFinished();
+        }
+        if (polls[0].revents & POLLIN) {
+            Accept();
+        }
+
+        for (std::size_t i = 0; i < polled.size(); ++i) {
+            Connection& c = *polled[i];
+            const short revents = polls[i + 2].revents;
+            if (revents == 0 || c.closing) continue;
+
+            if (polls[i + 2].events & POLLIN) {
+                Receive(c);
+            } else if ((revents & (POLLERR | POLLHUP)) || !Flush(c)) {
+                Close(c);
+            }
+        }
+
+        for (auto& connection : connections) {
+            Connection& c = *connection;
+            if (!c.busy && !c.closing && c.output.empty() && HasRequest(c.input)) {
+                Dispatch(c);
+            }
+        }
+
+        // Gone peers whose envs no task is using any more
+        connections.erase(std::remove_if(connections.begin(), connections.end(),
+            [](const std::unique_ptr<Connection>& connection) {
+                if (!connection->closing || connection->busy) return false;
+                for (auto& entry : connection->envs) {
+                    FreeEnv(entry.second);
+                }
+                return true;
+            }), connections.end());
+    }
+
+    pool.Wait();
+    for (auto& connection : connections) {
+        Close(*connection);
+        for (auto& entry : connection->envs) {
+            FreeEnv(entry.second);
+        }
+    }
+    connections.clear();
+    close(listenFd);
+    unlink(socketPath.c_str());
+    listenFd = -1;
+}
+
+void SimServer::Stop() {
+    stopping = true;
+    char wake = 1;
+    ssize_t ignored = write(wakeFds[1], &wake, 1);
+    (void)ignored;
+}
+
+void SimServer::Accept() {
+    for (;;) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) return;  // EAGAIN once the backlog is empty
+        if (!SetNonBlocking(fd)) {
+            close(fd);
+            continue;
+        }
+
+        std::unique_ptr<Connection> connection(new Connection());
+        connection->fd = fd;
+        connection->sent = 0;
+        connection->passFd = -1;
+        connection->busy = false;
+        connection->closing = false;
+        connection->broken = false;
+        connection->nextHandle = 1;
+        connections.push_back(std::move(connection));
+    }
+}
+
+void SimServer::Receive(Connection& connection) {
+    char buffer[receiveChunk];
+    ssize_t count = read(connection.fd, buffer, sizeof(buffer));
+    if (count == 0 || (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        Close(connection);
+        return;
+    }
+    if (count > 0) {
+        connection.input.insert(connection.input.end(), buffer, buffer + count);
+    }
+
+    if (connection.input.size() >= sizeof(MessageHeader)) {
+        MessageHeader header;
+        std::memcpy(&header, connection.input.data(), sizeof(header));
+        if (header.size > simMaxPayload) {
+            Close(connection);
+        }
+    }
+}
+
+bool SimServer::Flush(Connection& connection) {
+    while (connection.sent < connection.output.size()) {
+        iovec part = { connection.output.data() + connection.sent, connection.output.size() - connection.sent };
+        msghdr message = msghdr();
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+
+        // The fd rides along with the first byte of the reply
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+        if (connection.passFd >= 0) {
+            std::memset(control, 0, sizeof(control));
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(sizeof(int));
+            std::memcpy(CMSG_DATA(header), &connection.passFd, sizeof(int));
+        }
+
+        ssize_t count = sendmsg(connection.fd, &message, sendFlags);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;  // Rest goes out on POLLOUT
+        }
+        connection.sent += static_cast<std::size_t>(count);
+        if (connection.passFd >= 0) {
+            close(connection.passFd);
+            connection.passFd = -1;
+        }
+    }
+
+    connection.output.clear();
+    connection.sent = 0;
+    return true;
+}
+
+void SimServer::Dispatch(Connection& connection) {
+    connection.busy = true;
+    pool.Submit([this, &connection]() {
+        Handle(connection);
+
+        // Sent from here rather than from the loop, saving the reply a
+        // thread hop; the loop only takes over what the socket would not take
+        connection.broken = !Flush(connection);
+        {
+            std::lock_guard<std::mutex> lock(finishedMutex);
+            finished.push_back(&connection);
+        }
+        char wake = 1;
+        ssize_t ignored = write(wakeFds[1], &wake, 1);  // A full pipe already has a wake-up pending
+        (void)ignored;
+    });
+}
+
+void SimServer::Close(Connection& connection) {
+    if (connection.fd >= 0) {
+        close(connection.fd);
+        connection.fd = -1;
+    }
+    if (connection.passFd >= 0) {
+        close(connection.passFd);
+        connection.passFd = -1;
+    }
+    connection.closing = true;
+}
+
+void SimServer::CollectFinished() {
+    std::vector<Connection*> done;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        done.swap(finished);
+    }
+
+    for (Connection* connection : done) {
+        connection->busy = false;
+        if (connection->broken) {
+            Close(*connection);
+        }
+    }
+}
+
+void SimServer::Handle(Connection& connection) {
+    TRACE_ZONE("SimServer::Handle");
+
+    MessageHeader request;
+    std::memcpy(&request, connection.input.data(), sizeof(request));
+    const char* payload = connection.input.data() + sizeof(request);
+
+    // The reply's header is filled in last, once its size is known
+    connection.output.resize(sizeof(MessageHeader));
+    connection.sent = 0;
+
+    std::uint16_t status = statusBadRequest;
+    if (request.type == messageCreate) {
+        status = HandleCreate(connection, payload, request.size);
+    } else if (request.size >= sizeof(EnvRequest)) {
+        EnvRequest target;
+        std::memcpy(&target, payload, sizeof(target));
+        auto found = connection.envs.find(target.handle);
+        const std::uint32_t rest = request.size - static_cast<std::uint32_t>(sizeof(target));
+
+        if (found == connection.envs.end()) {
+            status = statusBadHandle;
+        } else {
+            RemoteEnv& remote = found->second;
+            const bool inRange = target.env < static_cast<std::uint32_t>(remote.env->GetEnvCount());
+            switch (request.type) {
+                case messageReset:
+                    if (rest == 0) {
+                        remote.env->Reset(remote.observations);
+                        status = statusOk;
+                    }
+                    break;
+                case messageStep:
+                    status = HandleStep(connection, remote, payload + sizeof(target), rest);
+                    break;
+                case messageSnapshot:
+                    if (rest == 0 && inRange) {
+                        status = HandleSnapshot(connection, remote, target.env);
+                    }
+                    break;
+                case messageRestore:
+                    if (inRange) {
+                        status = HandleRestore(remote, target.env, payload + sizeof(target), rest);
+                    }
+                    break;
+                case messageDestroy:
+                    if (rest == 0) {
+                        FreeEnv(remote);
+                        connection.envs.erase(found);
+                        status = statusOk;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Failures carry no payload
+    if (status != statusOk) {
+        connection.output.resize(sizeof(MessageHeader));
+        if (connection.passFd >= 0) {
+            close(connection.passFd);
+            connection.passFd = -1;
+        }
+    }
+    MessageHeader reply;
+    reply.type = request.type;
+    reply.status = status;
+    reply.size = static_cast<std::uint32_t>(connection.output.size() - sizeof(MessageHeader));
+    std::memcpy(connection.output.data(), &reply, sizeof(reply));
+
+    connection.input.erase(connection.input.begin(), connection.input.begin() + sizeof(request) + request.size);
+    requests++;
+}
+
+std::uint16_t SimServer::HandleCreate(Connection& connection, const char* payload, std::uint32_t size) {
+    CreateRequest request;
+    if (size != sizeof(request)) return statusBadRequest;
+    std::memcpy(&request, payload, sizeof(request));
+
+    if (request.version != simProtocolVersion || request.envCount == 0 || request.envCount > 65536 ||
+        request.arenaSize < 2 || request.arenaSize > 1024 || request.maxObstacles < 0) {
+        return statusBadRequest;
+    }
+
+    VectorEnvConfig config;
+    config.envCount = static_cast<int>(request.envCount);
+    config.sim.arenaSize = request.arenaSize;
+    config.sim.maxObstacles = request.maxObstacles;
+    config.seed = request.seed;
+    config.maxTicks = request.maxTicks;
+    config.starveTicks = request.starveTicks;
+    config.appleReward = request.appleReward;
+    config.deathReward = request.deathReward;
+
+    const std::uint64_t width = 2 * static_cast<std::uint64_t>(request.arenaSize) + 1;
+    const std::uint64_t mappingSize = request.envCount * observationChannels * width * width;
+    if (mappingSize > maxMappingSize) return statusBadRequest;
+
+    int fd = CreateSharedMemory(mappingSize);
+    if (fd < 0) return statusFailed;
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        return statusFailed;
+    }
+
+    RemoteEnv remote;
+    remote.env.reset(new VectorEnv(config));
+    remote.observations = static_cast<std::uint8_t*>(mapping);
+    remote.mappingSize = mappingSize;
+    remote.actions.resize(request.envCount);
+    remote.env->Reset(remote.observations);
+
+    CreateReply reply;
+    reply.handle = connection.nextHandle++;
+    reply.envCount = request.envCount;
+    reply.gridWidth = static_cast<std::uint32_t>(remote.env->GetGridWidth());
+    reply.observationSize = static_cast<std::uint32_t>(remote.env->GetObservationSize());
+    reply.mappingSize = mappingSize;
+    connection.envs[reply.handle] = std::move(remote);
+
+    const char* bytes = reinterpret_cast<const char*>(&reply);
+    connection.output.insert(connection.output.end(), bytes, bytes + sizeof(reply));
+    connection.passFd = fd;
+    return statusOk;
+}
+
+std::uint16_t SimServer::HandleStep(Connection& connection, RemoteEnv& remote, const char* payload, std::uint32_t size) {
+    const std::size_t count = remote.actions.size();
+    if (size != count) return statusBadRequest;
+
+    for (std::size_t i = 0; i < count; ++i) {
+        remote.actions[i] = static_cast<std::uint8_t>(payload[i]);
+    }
+
+    // Rewards then dones, written by the step in place
+    const std::size_t offset = connection.output.size();
+    connection.output.resize(offset + count * sizeof(float) + count);
+    float* rewards = reinterpret_cast<float*>(connection.output.data() + offset);
+    std::uint8_t* dones = reinterpret_cast<std::uint8_t*>(connection.output.data() + offset + count * sizeof(float));
+
+    // Stepped on this task alone: a nested pool Wait would wait on every client
+    remote.env->Step(remote.actions.data(), remote.observations, rewards, dones);
+    steps += count;
+    return statusOk;
+}
+
+std::uint16_t SimServer::HandleSnapshot(Connection& connection, RemoteEnv& remote, std::uint32_t env) {
+    const Simulation& sim = remote.env->GetSimulation(static_cast<int>(env));
+    std::string state;
+    sim.SaveState(state);
+
+    SnapshotReply reply = SnapshotReply();
+    reply.tick = sim.GetTick();
+    reply.score = sim.GetScore();
+    reply.length = sim.GetLength();
+    reply.headX = sim.GetHead().x;
+    reply.headZ = sim.GetHead().z;
+    reply.appleX = sim.GetApple().x;
+    reply.appleZ = sim.GetApple().z;
+    reply.direction = static_cast<std::uint8_t>(sim.GetDirection());
+    reply.hasApple = sim.HasApple() ? 1 : 0;
+    reply.stateSize = static_cast<std::uint32_t>(state.size());
+
+    const char* bytes = reinterpret_cast<const char*>(&reply);
+    connection.output.insert(connection.output.end(), bytes, bytes + sizeof(reply));
+    connection.output.insert(connection.output.end(), state.begin(), state.end());
+    return statusOk;
+}
+
+std::uint16_t SimServer::HandleRestore(RemoteEnv& remote, std::uint32_t env, const char* payload, std::uint32_t size) {
+    return remote.env->LoadState(static_cast<int>(env), payload, size, remote.observations)
+        ? statusOk : statusBadRequest;
+}
+
+void SimServer::FreeEnv(RemoteEnv& remote) {
+    if (remote.observations) {
+        munmap(remote.observations, remote.mappingSize);
+        remote.observations = nullptr;
+    }
+    remote.env.reset();
+}
+
+unsigned long long SimServer::GetRequestCount() const {
+    return requests;
+}
+
+unsigned long long SimServer::GetStepCount() const {
+    return steps;
+}
@@ -0,0 +1,96 @@
+#ifndef SIM_SERVER_H
+#define SIM_SERVER_H
+
+#include "sim_protocol.h"
+#include "task_pool.h"
+#include "vector_env.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Serves VectorEnvs to other local processes over a Unix domain socket,
+// speaking sim_protocol.h (POSIX only).
+//
+// One event loop thread owns every socket: it accepts, reads requests and
+// writes replies without blocking. Each complete request is handed to the
+// pool, so many clients' batches step in parallel while the loop stays
+// free. A connection has at most one request in flight - its envs are
+// only ever touched by that request's task, so they need no locks, and
+// replies come back in request order.
+class SimServer {
+public:
+    explicit SimServer(unsigned int threadCount = 0);  // Pool size; 0 = one per hardware thread
+    ~SimServer();
+
+    SimServer(const SimServer&) = delete;
+    SimServer& operator=(const SimServer&) = delete;
+
+    // Binds the socket, replacing a stale one left at path
+    bool Listen(const std::string& path);
+
+    // Serves until Stop, then closes every connection and removes the socket
+    void Run();
+
+    // Safe from any thread and from signal handlers
+    void Stop();
+
+    unsigned long long GetRequestCount() const;
+    unsigned long long GetStepCount() const;  // Env steps over all requests
+
+private:
+    // One VectorEnv and the shared memory its observations live in
+    struct RemoteEnv {
+        std::unique_ptr<VectorEnv> env;
+        std::uint8_t* observations;
+        std::size_t mappingSize;
+        std::vector<int> actions;  // Scratch, so steps allocate nothing
+    };
+
+    struct Connection {
+        int fd;
+        std::vector<char> input;   // Received bytes, requests not yet handled
+        std::vector<char> output;  // Reply being sent
+        std::size_t sent;
+        int passFd;                // Sent along with the reply's first byte, then closed; -1 if none
+        bool busy;                 // A task is handling the request at the front of input
+        bool closing;              // Peer gone; freed once the task finishes
+        bool broken;               // The task could not send its reply
+        std::map<std::uint32_t, RemoteEnv> envs;
+        std::uint32_t nextHandle;
+    };
+
+    void Accept();
+    void Receive(Connection& connection);
+    bool Flush(Connection& connection);
+    void Dispatch(Connection& connection);
+    void Close(Connection& connection);
+    void CollectFinished();
+
+    // On a pool thread: the request at the front of input, reply into output
+    void Handle(Connection& connection);
+    std::uint16_t HandleCreate(Connection& connection, const char* payload, std::uint32_t size);
+    std::uint16_t HandleStep(Connection& connection, RemoteEnv& remote, const char* payload, std::uint32_t size);
+    std::uint16_t HandleSnapshot(Connection& connection, RemoteEnv& remote, std::uint32_t env);
+    std::uint16_t HandleRestore(RemoteEnv& remote, std::uint32_t env, const char* payload, std::uint32_t size);
+    static void FreeEnv(RemoteEnv& remote);
+
+    TaskPool pool;
+    int listenFd;
+    int wakeFds[2];  // Self-pipe: pool threads and Stop poke the loop through it
+    std::string socketPath;
+    std::atomic<bool> stopping;
+
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::mutex finishedMutex;
+    std::vector<Connection*> finished;  // Tasks done since the loop last looked
+
+    std::atomic<unsigned long long> requests;
+    std::atomic<unsigned long long> steps;
+};
+
+#endif // SIM_SERVER_H
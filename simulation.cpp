@@ -0,0 +1,818 @@
+#include "simulation.h"
+#include "trace.h"
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// Keep a minimum distance from the center where the snake starts
+static const float minDistanceFromCenter = 4.0f;
+
+// Chunked arenas draw apple spots at random until one is free; only a
+// nearly full board gets through this many misses
+static const int maxSpawnAttempts = 64;
+
+// Same distance rules the game always used, evaluated for a head sitting on the cell
+static bool ObstacleBlocks(const Obstacle& obs, const Cell& cell) {
+    float dx = static_cast<float>(cell.x - obs.cell.x);
+    float dz = static_cast<float>(cell.z - obs.cell.z);
+
+    if (obs.type == ObstacleType::TREE) {
+        // Trees only block at the trunk, measured horizontally
+        return std::sqrt(dx*dx + dz*dz) < 0.3f * obs.scale;
+    }
+
+    // Rocks sit on the ground while the snake rides half a unit above it
+    return std::sqrt(dx*dx + 0.25f + dz*dz) < 0.7f * obs.scale;
+}
+
+// Calls mark(cell) for every cell whose center the obstacle's collision shape covers
+template <typename Mark>
+static void ForEachBlockedCell(const Obstacle& obs, Mark mark) {
+    const float radius = (obs.type == ObstacleType::TREE ? 0.3f : 0.7f) * obs.scale;
+    const int reach = static_cast<int>(std::ceil(radius));
+
+    for (int dz = -reach; dz <= reach; ++dz) {
+        for (int dx = -reach; dx <= reach; ++dx) {
+            Cell cell{obs.cell.x + dx, obs.cell.z + dz};
+            if (ObstacleBlocks(obs, cell)) {
+                mark(cell);
+            }
+        }
+    }
+}
+
+// Calls mark(cell) for every cell too close to the obstacle for an apple
+template <typename Mark>
+static void ForEachShadowedCell(const Obstacle& obs, Mark mark) {
+    float obstacleRadius = (obs.type == ObstacleType::TREE) ? 0.7f : 0.8f;
+    const int reach = static_cast<int>(std::ceil(obstacleRadius + 1.0f));
+
+    for (int dz = -reach; dz <= reach; ++dz) {
+        for (int dx = -reach; dx <= reach; ++dx) {
+            float fx = static_cast<float>(dx);
+            float fz = static_cast<float>(dz);
+            if (std::sqrt(fx*fx + 0.25f + fz*fz) < obstacleRadius + 1.0f) {
+                mark(Cell{obs.cell.x + dx, obs.cell.z + dz});
+            }
+        }
+    }
+}
+
+// Placement rules for a new obstacle of the given spacing radius
+static bool ClearOfWalls(const Cell& cell, float radius, int arenaSize) {
+    // Make sure not too close to walls - use smaller margin to allow obstacles closer to walls
+    float margin = radius * 1.2f;
+    float size = static_cast<float>(arenaSize);
+    return !(cell.x > size - margin || cell.x < -size + margin ||
+             cell.z > size - margin || cell.z < -size + margin);
+}
+
+// isStatic(cell) tells whether a nearby cell holds an obstacle. Each one
+// marks exactly its own cell, so only the cells within reach need a look
+// instead of the whole obstacle list
+template <typename IsStatic>
+static bool ClearOfObstacles(const Cell& cell, float radius, IsStatic isStatic) {
+    const int reach = static_cast<int>(std::ceil(radius * 2.0f));
+    for (int dz = -reach; dz <= reach; ++dz) {
+        for (int dx = -reach; dx <= reach; ++dx) {
+            float fx = static_cast<float>(dx);
+            float fz = static_cast<float>(dz);
+            if (std::sqrt(fx*fx + fz*fz) < radius * 2.0f && isStatic(Cell{cell.x + dx, cell.z + dz})) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Seed of one chunk's own generator. Odd multipliers keep neighbouring
+// chunks and streams apart before SplitMix64 spreads the bits.
+static std::uint64_t ChunkSeed(std::uint64_t seed, std::uint64_t stream, int x, int z) {
+    return seed ^ (stream * 0x9E3779B97F4A7C15ull) ^
+           (static_cast<std::uint64_t>(x) * 0xC2B2AE3D27D4EB4Full) ^
+           (static_cast<std::uint64_t>(z) * 0x165667B19E3779F9ull);
+}
+
+// Raw little helpers for the state blob; host byte order
+template <typename Value>
+static void AppendValue(std::string& out, const Value& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(Value));
+}
+
+template <typename Value>
+static bool ReadValue(const char*& data, const char* end, Value& value) {
+    if (static_cast<std::size_t>(end - data) < sizeof(Value)) return false;
+    std::memcpy(&value, data, sizeof(Value));
+    data += sizeof(Value);
+    return true;
+}
+
+Simulation::Simulation(const SimConfig& config) :
+    config(config),
+    apple(Cell{0, 0}),
+    direction(Direction::RIGHT),
+    nextDirection(Direction::RIGHT),
+    shouldGrow(false),
+    hasApple(false),
+    gameOver(false),
+    won(false),
+    score(0),
+    tick(0),
+    rng(RandomStream::ForStream(config.seed, config.stream)) {
+    if (config.chunked) {
+        // Nothing sized by the arena; the body grows as it needs to
+        world.Reset(config.arenaSize);
+        body.Reserve(ChunkedWorld::chunkCells);
+    } else {
+        // The body can never be longer than the arena, so moves never reallocate
+        const int side = config.arenaSize * 2 + 1;
+        body.Reserve(static_cast<std::size_t>(side) * side);
+        grid.Resize(config.arenaSize);
+        freeCells.Resize(grid.CellCount());
+        RebuildSpawnArea();
+    }
+    ResetSnake();
+}
+
+void Simulation::Seed(std::uint64_t seed, std::uint64_t stream) {
+    Seed(seed, stream, RandomStream::ForStream(seed, stream));
+}
+
+void Simulation::Seed(std::uint64_t seed, std::uint64_t stream, const RandomStream& start) {
+    config.seed = seed;
+    config.stream = stream;
+    rng = start;
+}
+
+int Simulation::Random(int range) {
+    // Unbiased and fully specified, so a seed plays out the same on every platform
+    return static_cast<int>(rng.NextBelow(static_cast<std::uint32_t>(range)));
+}
+
+void Simulation::Initialize() {
+    GenerateObstacles();
+    Reset();
+}
+
+void Simulation::Reset() {
+    ResetSnake();
+    RebuildFreeCells();
+    SpawnApple();
+    score = 0;
+    gameOver = false;
+    won = false;
+    tick = 0;
+}
+
+void Simulation::ResetSnake() {
+    direction = Direction::RIGHT;
+    nextDirection = Direction::RIGHT;
+    shouldGrow = false;
+
+    // Start at the center of the arena heading right, pushed tail first
+    body.Clear();
+    body.PushHead(Cell{-2, 0});
+    body.PushHead(Cell{-1, 0});
+    body.PushHead(Cell{0, 0});
+
+    if (config.chunked) {
+        world.ClearSnake();
+        for (const auto& segment : body) {
+            OccupyCell(segment);
+        }
+        return;
+    }
+
+    grid.ClearSnake();
+    for (const auto& segment : body) {
+        grid.SetSnake(segment);
+    }
+}
+
+void Simulation::SaveState(std::string& out) const {
+    out.clear();
+    AppendValue(out, tick);
+    AppendValue(out, score);
+    AppendValue(out, static_cast<std::uint8_t>(direction));
+    AppendValue(out, static_cast<std::uint8_t>(nextDirection));
+    AppendValue(out, static_cast<std::uint8_t>((shouldGrow ? 1 : 0) | (hasApple ? 2 : 0) |
+                                               (gameOver ? 4 : 0) | (won ? 8 : 0)));
+    AppendValue(out, apple);
+
+    // Tail first, so loading can push heads in order
+    AppendValue(out, static_cast<std::uint32_t>(body.Size()));
+    for (std::size_t i = body.Size(); i-- > 0;) {
+        AppendValue(out, body[i]);
+    }
+
+    // Spawn picks index into the free list, so its order is part of the state
+    AppendValue(out, static_cast<std::uint32_t>(freeCells.Size()));
+    for (int slot = 0; slot < freeCells.Size(); ++slot) {
+        AppendValue(out, static_cast<std::int32_t>(freeCells.At(slot)));
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        AppendValue(out, rng.GetState()[i]);
+    }
+}
+
+bool Simulation::LoadState(const char* data, std::size_t size, bool allowFinished) {
+    // Everything is read and checked before any member changes, so a
+    // rejected blob leaves the game exactly as it was
+    const char* end = data + size;
+    unsigned long long loadedTick;
+    int loadedScore;
+    std::uint8_t dir, next, flags;
+    Cell loadedApple;
+    std::uint32_t count;
+
+    if (!ReadValue(data, end, loadedTick) || !ReadValue(data, end, loadedScore) ||
+        !ReadValue(data, end, dir) || !ReadValue(data, end, next) ||
+        !ReadValue(data, end, flags) || !ReadValue(data, end, loadedApple) ||
+        !ReadValue(data, end, count)) {
+        return false;
+    }
+    const bool loadedGrowing = (flags & 1) != 0;
+    const bool loadedHasApple = (flags & 2) != 0;
+    const bool loadedGameOver = (flags & 4) != 0;
+    const bool loadedWon = (flags & 8) != 0;
+    if (dir > 3 || next > 3 || (loadedGameOver && !allowFinished)) return false;
+
+    const int arenaSize = config.arenaSize;
+    auto inArena = [arenaSize](const Cell& cell, int margin) {
+        return std::abs(cell.x) <= arenaSize + margin && std::abs(cell.z) <= arenaSize + margin;
+    };
+    auto openCell = [this](const Cell& cell) {
+        // Chunked layouts are only generated on demand; their walls are out of bounds anyway
+        return config.chunked || !grid.IsStatic(cell);
+    };
+    if (loadedHasApple && (!inArena(loadedApple, 0) || !openCell(loadedApple))) return false;
+
+    // Tail first. Only a dead head may sit on the border, an obstacle or
+    // the body; every other segment is an open arena cell of its own.
+    if (count == 0 || count > static_cast<std::size_t>(end - data) / sizeof(Cell)) return false;
+    std::vector<Cell> cells(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        ReadValue(data, end, cells[i]);
+        const bool deadHead = loadedGameOver && i + 1 == count;
+        if (!inArena(cells[i], deadHead ? 1 : 0) || (!deadHead && !openCell(cells[i]))) return false;
+        if (i > 0 && std::abs(cells[i].x - cells[i - 1].x) + std::abs(cells[i].z - cells[i - 1].z) != 1) {
+            return false;
+        }
+    }
+
+    auto before = [](const Cell& a, const Cell& b) { return a.x != b.x ? a.x < b.x : a.z < b.z; };
+    std::vector<Cell> sorted(cells.begin(), cells.end() - 1);
+    std::sort(sorted.begin(), sorted.end(), before);
+    if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) return false;
+    if (!loadedGameOver && std::binary_search(sorted.begin(), sorted.end(), cells.back(), before)) return false;
+
+    // Chunked arenas keep no free list, so the count is always 0 there
+    std::uint32_t freeCount;
+    if (!ReadValue(data, end, freeCount) ||
+        freeCount > static_cast<std::size_t>(end - data) / sizeof(std::int32_t) ||
+        (config.chunked && freeCount != 0)) {
+        return false;
+    }
+    std::vector<std::int32_t> freeList(freeCount);
+    for (std::uint32_t i = 0; i < freeCount; ++i) {
+        ReadValue(data, end, freeList[i]);
+        if (freeList[i] < 0 || freeList[i] >= grid.CellCount()) return false;
+    }
+
+    std::uint64_t words[4];
+    for (int i = 0; i < 4; ++i) {
+        if (!ReadValue(data, end, words[i])) return false;
+    }
+
+    tick = loadedTick;
+    score = loadedScore;
+    direction = static_cast<Direction>(dir);
+    nextDirection = static_cast<Direction>(next);
+    shouldGrow = loadedGrowing;
+    hasApple = loadedHasApple;
+    gameOver = loadedGameOver;
+    won = loadedWon;
+    apple = loadedApple;
+
+    body.Clear();
+    if (config.chunked) {
+        world.ClearSnake();
+    } else {
+        grid.ClearSnake();
+    }
+    for (const Cell& cell : cells) {
+        body.PushHead(cell);
+        if (config.chunked) {
+            OccupyCell(cell);
+        } else {
+            grid.SetSnake(cell);
+        }
+    }
+
+    freeCells.Clear();
+    for (std::int32_t index : freeList) {
+        freeCells.Add(index);
+    }
+    rng.SetState(words);
+    return true;
+}
+
+void Simulation::SetDirection(Direction dir) {
+    // Prevent 180-degree turns (e.g., can't go right when moving left)
+    if ((dir == Direction::LEFT && direction == Direction::RIGHT) ||
+        (dir == Direction::RIGHT && direction == Direction::LEFT) ||
+        (dir == Direction::UP && direction == Direction::DOWN) ||
+        (dir == Direction::DOWN && direction == Direction::UP)) {
+        return;
+    }
+
+    nextDirection = dir;
+}
+
+StepResult Simulation::Step(Direction action) {
+    SetDirection(action);
+    return Step();
+}
+
+StepResult Simulation::Step() {
+    TRACE_ZONE("Simulation::Step");
+
+    if (gameOver) return StepResult::DIED;
+
+    direction = nextDirection;
+    tick++;
+
+    Cell head = Neighbor(body.Head(), direction);
+
+    // Growth keeps the tail in place for one tick
+    if (shouldGrow) {
+        shouldGrow = false;
+    } else {
+        VacateCell(body.Tail());
+        body.PopTail();
+    }
+    body.PushHead(head);
+
+    // Far chunks the snake has left are dropped as the head moves on
+    if (config.chunked) {
+        world.KeepAround(head, residentChunkRadius);
+    }
+
+    // Apple is checked first, same as the original rules
+    if (hasApple && head == apple) {
+        OccupyCell(head);
+        shouldGrow = true;
+        score += 10;
+        SpawnApple();
+
+        // Nowhere left to put an apple - the board is full
+        if (!hasApple) {
+            gameOver = true;
+            won = true;
+        }
+        return StepResult::ATE_APPLE;
+    }
+
+    // Walls, obstacles and the body are all a single grid (or chunk) lookup
+    if (config.chunked ? ChunkBlocked(head) : grid.IsBlocked(head)) {
+        gameOver = true;
+        return StepResult::DIED;
+    }
+
+    OccupyCell(head);
+    return StepResult::MOVED;
+}
+
+void Simulation::OccupyCell(const Cell& cell) {
+    if (config.chunked) {
+        ChunkedWorld::Chunk& chunk = ChunkAt(cell);
+        int index = world.LocalIndex(cell);
+        if (!ChunkedWorld::Chunk::Test(chunk.snakeBits, index)) {
+            ChunkedWorld::Chunk::Set(chunk.snakeBits, index);
+            chunk.snakeCells++;
+        }
+        return;
+    }
+
+    grid.SetSnake(cell);
+    freeCells.Remove(grid.IndexOf(cell));
+}
+
+void Simulation::VacateCell(const Cell& cell) {
+    if (config.chunked) {
+        ChunkedWorld::Chunk& chunk = ChunkAt(cell);
+        int index = world.LocalIndex(cell);
+        if (ChunkedWorld::Chunk::Test(chunk.snakeBits, index)) {
+            ChunkedWorld::Chunk::Clear(chunk.snakeBits, index);
+            chunk.snakeCells--;
+        }
+        return;
+    }
+
+    grid.ClearSnake(cell);
+    freeCells.Add(grid.IndexOf(cell));
+}
+
+void Simulation::SpawnApple() {
+    TRACE_ZONE("Simulation::SpawnApple");
+
+    if (config.chunked) {
+        SpawnAppleInChunks();
+        return;
+    }
+
+    // Every member of the set is a valid spot, so one uniform draw is enough
+    if (freeCells.Empty()) {
+        hasApple = false;
+        return;
+    }
+
+    apple = grid.CellAt(freeCells.At(Random(freeCells.Size())));
+    hasApple = true;
+}
+
+void Simulation::SpawnAppleInChunks() {
+    const int arenaSize = config.arenaSize;
+    auto canSpawn = [this](const Cell& cell) {
+        const ChunkedWorld::Chunk& chunk = ChunkAt(cell);
+        int index = world.LocalIndex(cell);
+        return ChunkedWorld::Chunk::Test(chunk.spawnBits, index) && !ChunkedWorld::Chunk::Test(chunk.snakeBits, index);
+    };
+
+    // A uniform draw over the spawn range, retried until it lands on a free
+    // spot, picks from the same spots as the free list without keeping one
+    // for the whole arena
+    for (int attempt = 0; attempt < maxSpawnAttempts; ++attempt) {
+        Cell cell{Random(arenaSize * 2) - arenaSize, Random(arenaSize * 2) - arenaSize};
+        if (canSpawn(cell)) {
+            apple = cell;
+            hasApple = true;
+            return;
+        }
+    }
+
+    // Nearly full board: pick among the free spots of the chunks the snake
+    // is in, which are resident anyway, and only widen ring by ring while
+    // those are full. Counting the whole arena would generate every chunk.
+    // The rings depend on the snake alone, not on what happens to be
+    // resident, so a game replays the same after LoadState.
+    auto spotsIn = [](const ChunkedWorld::Chunk& chunk) {
+        long long spots = 0;
+        for (int word = 0; word < ChunkedWorld::chunkWords; ++word) {
+            spots += static_cast<long long>(std::bitset<64>(chunk.spawnBits[word] & ~chunk.snakeBits[word]).count());
+        }
+        return spots;
+    };
+
+    std::vector<std::pair<int, int>> ring;  // Chunk z, x
+    world.ForEachResident([&ring](const ChunkedWorld::Chunk& chunk) {
+        if (chunk.snakeCells > 0) ring.emplace_back(chunk.z, chunk.x);
+    });
+    std::unordered_set<std::uint64_t> seen;
+    const std::uint64_t chunksPerSide = static_cast<std::uint64_t>(world.ChunksPerSide());
+    for (const auto& at : ring) {
+        seen.insert(static_cast<std::uint64_t>(at.first) * chunksPerSide + static_cast<std::uint64_t>(at.second));
+    }
+
+    while (!ring.empty()) {
+        std::sort(ring.begin(), ring.end());
+
+        long long spots = 0;
+        for (const auto& at : ring) {
+            spots += spotsIn(TouchChunk(at.second, at.first));
+        }
+
+        if (spots > 0) {
+            long long pick = Random(static_cast<int>(std::min<long long>(spots, INT_MAX)));
+            for (const auto& at : ring) {
+                const ChunkedWorld::Chunk& chunk = TouchChunk(at.second, at.first);
+                for (int index = 0; index < ChunkedWorld::chunkCells; ++index) {
+                    if (ChunkedWorld::Chunk::Test(chunk.spawnBits, index) &&
+                        !ChunkedWorld::Chunk::Test(chunk.snakeBits, index) && pick-- == 0) {
+                        apple = world.CellAt(chunk, index & (ChunkedWorld::chunkSize - 1), index >> ChunkedWorld::chunkShift);
+                        hasApple = true;
+                        return;
+                    }
+                }
+            }
+        }
+
+        // The chunks around this ring not looked at yet
+        std::vector<std::pair<int, int>> next;
+        const int steps[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+        for (const auto& at : ring) {
+            for (const auto& step : steps) {
+                const int z = at.first + step[0];
+                const int x = at.second + step[1];
+                if (z < 0 || x < 0 || z >= world.ChunksPerSide() || x >= world.ChunksPerSide()) continue;
+                if (seen.insert(static_cast<std::uint64_t>(z) * chunksPerSide + static_cast<std::uint64_t>(x)).second) {
+                    next.emplace_back(z, x);
+                }
+            }
+        }
+        ring.swap(next);
+    }
+
+    hasApple = false;
+}
+
+void Simulation::RebuildSpawnArea() {
+    const int arenaSize = config.arenaSize;
+
+    // Apples spawn on -arenaSize..arenaSize-1, like the original random range
+    for (int index = 0; index < grid.CellCount(); ++index) {
+        Cell cell = grid.CellAt(index);
+        freeCells.SetEligible(index, cell.x >= -arenaSize && cell.x < arenaSize &&
+                                     cell.z >= -arenaSize && cell.z < arenaSize);
+    }
+
+    // Keep apples out of reach of obstacles
+    for (const auto& obs : obstacles) {
+        ForEachShadowedCell(obs, [this](const Cell& cell) {
+            if (grid.InArena(cell)) {
+                freeCells.SetEligible(grid.IndexOf(cell), false);
+            }
+        });
+    }
+}
+
+void Simulation::RebuildFreeCells() {
+    if (config.chunked) return;  // Spawning asks the chunks instead
+    freeCells.Clear();
+
+    const int arenaSize = config.arenaSize;
+    for (int z = -arenaSize; z <= arenaSize; ++z) {
+        for (int x = -arenaSize; x <= arenaSize; ++x) {
+            Cell cell{x, z};
+            if (!grid.IsSnake(cell)) {
+                freeCells.Add(grid.IndexOf(cell));
+            }
+        }
+    }
+}
+
+void Simulation::GenerateObstacles() {
+    TRACE_ZONE("Simulation::GenerateObstacles");
+
+    // Chunks fill in their own obstacles when first touched
+    if (config.chunked) {
+        world.Reset(config.arenaSize);
+        return;
+    }
+
+    obstacles.clear();
+    grid.ClearObstacles();
+
+    const int range = static_cast<int>(config.arenaSize * 1.8f);
+    const int offset = static_cast<int>(config.arenaSize * 0.9f);
+
+    for (int i = 0; i < config.maxObstacles; i++) {
+        Obstacle obs;
+
+        // Decide if it's a tree or rock
+        obs.type = (Random(2) == 0) ? ObstacleType::TREE : ObstacleType::ROCK;
+
+        bool validPosition = false;
+        int attempts = 0;
+
+        while (!validPosition && attempts < 20) {
+            // Random position within arena bounds
+            int x = Random(range) - offset;
+            int z = Random(range) - offset;
+
+            // Check distance from center
+            if (std::sqrt(static_cast<float>(x*x + z*z)) < minDistanceFromCenter) {
+                attempts++;
+                continue;
+            }
+
+            obs.cell = Cell{x, z};
+            obs.rotation = static_cast<float>(Random(360));
+            obs.scale = 0.8f + Random(50) / 100.0f; // 0.8 to 1.3
+
+            if (IsPositionFree(obs.cell, obs.type == ObstacleType::TREE ? 1.0f : 0.8f)) {
+                validPosition = true;
+            }
+
+            attempts++;
+        }
+
+        if (validPosition) {
+            obstacles.push_back(obs);
+            RasterizeObstacle(obs);
+        }
+    }
+
+    RebuildSpawnArea();
+}
+
+void Simulation::RasterizeObstacle(const Obstacle& obs) {
+    ForEachBlockedCell(obs, [this](const Cell& cell) {
+        if (grid.InArena(cell)) {
+            grid.SetObstacle(cell);
+        }
+    });
+}
+
+bool Simulation::IsPositionFree(const Cell& cell, float radius) const {
+    return ClearOfWalls(cell, radius, config.arenaSize) &&
+           ClearOfObstacles(cell, radius, [this](const Cell& other) { return grid.IsStatic(other); });
+}
+
+ChunkedWorld::Chunk& Simulation::TouchChunk(int x, int z) const {
+    ChunkedWorld::Chunk* chunk = world.Find(x, z);
+    if (!chunk) {
+        chunk = &world.Insert(x, z);
+        GenerateChunk(*chunk);
+    }
+    return *chunk;
+}
+
+bool Simulation::ChunkBlocked(const Cell& cell) const {
+    const ChunkedWorld::Chunk& chunk = ChunkAt(cell);
+    int index = world.LocalIndex(cell);
+    return ChunkedWorld::Chunk::Test(chunk.staticBits, index) || ChunkedWorld::Chunk::Test(chunk.snakeBits, index);
+}
+
+void Simulation::GenerateChunk(ChunkedWorld::Chunk& chunk) const {
+    TRACE_ZONE("Simulation::GenerateChunk");
+
+    const int arenaSize = config.arenaSize;
+    const int size = ChunkedWorld::chunkSize;
+
+    // Walls (and the unused cells past them in the last chunks) and the
+    // apple spawn range, the same as the dense grid
+    for (int localZ = 0; localZ < size; ++localZ) {
+        for (int localX = 0; localX < size; ++localX) {
+            Cell cell = world.CellAt(chunk, localX, localZ);
+            int index = localZ * size + localX;
+            if (std::abs(cell.x) > arenaSize || std::abs(cell.z) > arenaSize) {
+                ChunkedWorld::Chunk::Set(chunk.staticBits, index);
+            } else if (cell.x < arenaSize && cell.z < arenaSize) {
+                ChunkedWorld::Chunk::Set(chunk.spawnBits, index);
+            }
+        }
+    }
+
+    // Cells of this chunk only; the edge margin below keeps every rule from
+    // reaching past it, so a chunk never depends on its neighbours
+    auto localIndex = [&](const Cell& cell, int& index) {
+        if (world.ChunkX(cell) != chunk.x || world.ChunkZ(cell) != chunk.z) return false;
+        index = world.LocalIndex(cell);
+        return true;
+    };
+
+    // Its own generator keyed by its coordinates, so the layout does not
+    // depend on which chunks were generated before or dropped since
+    RandomStream random(ChunkSeed(config.seed, config.stream, chunk.x, chunk.z));
+
+    // maxObstacles is the expected count over the same placement square the
+    // dense layout draws from; the fraction is settled with one more draw
+    const int range = std::max(1, static_cast<int>(arenaSize * 1.8f));
+    const double expected = static_cast<double>(config.maxObstacles) * ChunkedWorld::chunkCells /
+                            (static_cast<double>(range) * range);
+    int count = static_cast<int>(expected);
+    if ((random.Next() >> 11) * (1.0 / 9007199254740992.0) < expected - count) {
+        count++;
+    }
+
+    for (int i = 0; i < count; i++) {
+        Obstacle obs;
+        obs.type = (random.NextBelow(2) == 0) ? ObstacleType::TREE : ObstacleType::ROCK;
+        const float radius = obs.type == ObstacleType::TREE ? 1.0f : 0.8f;
+
+        bool validPosition = false;
+        for (int attempts = 0; !validPosition && attempts < 20; attempts++) {
+            // One cell of margin from the chunk edge
+            obs.cell = world.CellAt(chunk, 1 + static_cast<int>(random.NextBelow(size - 2)),
+                                    1 + static_cast<int>(random.NextBelow(size - 2)));
+            if (std::sqrt(static_cast<float>(obs.cell.x*obs.cell.x + obs.cell.z*obs.cell.z)) < minDistanceFromCenter) {
+                continue;
+            }
+
+            obs.rotation = static_cast<float>(random.NextBelow(360));
+            obs.scale = 0.8f + random.NextBelow(50) / 100.0f; // 0.8 to 1.3
+
+            validPosition = ClearOfWalls(obs.cell, radius, arenaSize) &&
+                            ClearOfObstacles(obs.cell, radius, [&](const Cell& other) {
+                                int index;
+                                return localIndex(other, index) && ChunkedWorld::Chunk::Test(chunk.staticBits, index);
+                            });
+        }
+
+        if (validPosition) {
+            chunk.obstacles.push_back(obs);
+            ForEachBlockedCell(obs, [&](const Cell& cell) {
+                int index;
+                if (localIndex(cell, index)) {
+                    ChunkedWorld::Chunk::Set(chunk.staticBits, index);
+                }
+            });
+        }
+    }
+
+    for (const auto& obs : chunk.obstacles) {
+        ForEachShadowedCell(obs, [&](const Cell& cell) {
+            int index;
+            if (localIndex(cell, index)) {
+                ChunkedWorld::Chunk::Clear(chunk.spawnBits, index);
+            }
+        });
+    }
+}
+
+const SnakeBody& Simulation::GetBody() const {
+    return body;
+}
+
+Cell Simulation::GetHead() const {
+    return body.Head();
+}
+
+int Simulation::GetLength() const {
+    return static_cast<int>(body.Size());
+}
+
+Cell Simulation::GetApple() const {
+    return apple;
+}
+
+bool Simulation::HasApple() const {
+    return hasApple;
+}
+
+const std::vector<Obstacle>& Simulation::GetObstacles() const {
+    return obstacles;
+}
+
+Direction Simulation::GetDirection() const {
+    return direction;
+}
+
+int Simulation::GetScore() const {
+    return score;
+}
+
+bool Simulation::IsBlocked(const Cell& cell) const {
+    // Anything past the border is as deadly as the border itself
+    if (cell.x < -config.arenaSize - 1 || cell.x > config.arenaSize + 1 ||
+        cell.z < -config.arenaSize - 1 || cell.z > config.arenaSize + 1) {
+        return true;
+    }
+    return config.chunked ? ChunkBlocked(cell) : grid.IsBlocked(cell);
+}
+
+bool Simulation::IsSpawnArea(const Cell& cell) const {
+    if (config.chunked) {
+        return ChunkedWorld::Chunk::Test(ChunkAt(cell).spawnBits, world.LocalIndex(cell));
+    }
+    return freeCells.IsEligible(grid.IndexOf(cell));
+}
+
+const OccupancyGrid& Simulation::GetGrid() const {
+    return grid;
+}
+
+bool Simulation::IsGameOver() const {
+    return gameOver;
+}
+
+bool Simulation::IsGrowing() const {
+    return shouldGrow;
+}
+
+bool Simulation::HasWon() const {
+    return won;
+}
+
+unsigned long long Simulation::GetTick() const {
+    return tick;
+}
+
+int Simulation::GetArenaSize() const {
+    return config.arenaSize;
+}
+
+const SimConfig& Simulation::GetConfig() const {
+    return config;
+}
+
+const RandomStream& Simulation::GetRandom() const {
+    return rng;
+}
+
+const ChunkedWorld::Chunk& Simulation::GetChunk(int x, int z) const {
+    return TouchChunk(x, z);
+}
+
+const ChunkedWorld& Simulation::GetWorld() const {
+    return world;
+}
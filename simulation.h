@@ -0,0 +1,116 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "simulation_types.h"
+#include "snake_body.h"
+#include "occupancy_grid.h"
+#include "free_cell_set.h"
+#include "chunked_world.h"
+#include "random_stream.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Game rules without any raylib dependency. Everything here lives on the
+// integer grid the snake moves on; Game and Snake only turn it into pixels.
+
+struct SimConfig {
+    int arenaSize = 20;     // Playable cells span -arenaSize..arenaSize on both axes
+    int maxObstacles = 15;
+    std::uint64_t seed = 0;    // Same seed, stream and inputs always play out the same game
+    std::uint64_t stream = 0;  // Jump-ahead streams of one seed never overlap
+    // Keep the arena as chunks generated on first touch instead of whole
+    // (for arenas far past the default). Obstacles are then placed per chunk,
+    // maxObstacles still being the expected count for the whole arena, and
+    // the dense views (GetGrid, GetObstacles) stay empty.
+    bool chunked = false;
+};
+
+class Simulation {
+public:
+    explicit Simulation(const SimConfig& config = SimConfig());
+
+    // Restart the random stream; takes effect on the next Initialize/Reset
+    void Seed(std::uint64_t seed, std::uint64_t stream = 0);
+    // Same, with the stream's start state already at hand (must equal
+    // RandomStream::ForStream(seed, stream)) to skip the jumps
+    void Seed(std::uint64_t seed, std::uint64_t stream, const RandomStream& start);
+    void Initialize();  // New obstacle layout, snake and apple
+    void Reset();       // New snake, apple and score on the current layout
+
+    // Everything that changes while playing (body, apple, score, random
+    // stream, ...) as a byte blob. The obstacle layout is not included, so a
+    // state only loads into a simulation with the same layout. LoadState
+    // checks the whole blob first - a connected body of distinct open
+    // cells, apple and directions in range - and changes nothing when it
+    // fails. allowFinished = false also turns down a game that is over.
+    void SaveState(std::string& out) const;
+    bool LoadState(const char* data, std::size_t size, bool allowFinished = true);
+
+    void SetDirection(Direction dir);
+    StepResult Step();                  // Advance one tick with the queued direction
+    StepResult Step(Direction action);  // SetDirection(action) + Step()
+
+    const SnakeBody& GetBody() const;  // Head first
+    Cell GetHead() const;
+    int GetLength() const;
+    Cell GetApple() const;
+    bool HasApple() const;  // False once the board is full
+    const std::vector<Obstacle>& GetObstacles() const;  // Empty for chunked arenas
+    Direction GetDirection() const;
+    bool IsBlocked(const Cell& cell) const;  // Wall, obstacle or body
+    bool IsSpawnArea(const Cell& cell) const;  // An apple may ever go here (body aside); cell in the arena
+    const OccupancyGrid& GetGrid() const;    // Index-level access for searches; empty for chunked arenas
+    int GetScore() const;
+    bool IsGameOver() const;
+    bool IsGrowing() const;  // Just ate; the tail stays put on the next step
+    bool HasWon() const;    // Game ended because the snake filled the board
+    unsigned long long GetTick() const;
+    int GetArenaSize() const;
+    const SimConfig& GetConfig() const;
+    const RandomStream& GetRandom() const;  // Where the next draw comes from
+
+    // Chunked arenas: the chunk at these chunk coordinates, generated now if
+    // it is not resident. Chunks past this many from the head get dropped.
+    static const int residentChunkRadius = 2;
+    const ChunkedWorld::Chunk& GetChunk(int x, int z) const;
+    const ChunkedWorld& GetWorld() const;
+
+private:
+    int Random(int range);
+    void ResetSnake();
+    void OccupyCell(const Cell& cell);
+    void VacateCell(const Cell& cell);
+    void SpawnApple();
+    void RebuildSpawnArea();
+    void RebuildFreeCells();
+    void GenerateObstacles();
+    bool IsPositionFree(const Cell& cell, float radius) const;
+    void RasterizeObstacle(const Obstacle& obs);
+    ChunkedWorld::Chunk& TouchChunk(int x, int z) const;
+    ChunkedWorld::Chunk& ChunkAt(const Cell& cell) const { return TouchChunk(world.ChunkX(cell), world.ChunkZ(cell)); }
+    bool ChunkBlocked(const Cell& cell) const;
+    void GenerateChunk(ChunkedWorld::Chunk& chunk) const;
+    void SpawnAppleInChunks();
+
+    SimConfig config;
+    SnakeBody body;
+    OccupancyGrid grid;
+    FreeCellSet freeCells;  // Apple spawn candidates, maintained as the snake moves
+    std::vector<Obstacle> obstacles;
+    // Chunks are only a cache of what the seed generates, so filling one in
+    // from a const lookup does not change the game
+    mutable ChunkedWorld world;
+    Cell apple;
+    Direction direction;
+    Direction nextDirection;
+    bool shouldGrow;
+    bool hasApple;
+    bool gameOver;
+    bool won;
+    int score;
+    unsigned long long tick;
+    RandomStream rng;       // Per-game stream, so games can run side by side on threads
+};
+
+#endif // SIMULATION_H
@@ -0,0 +1,55 @@
+#ifndef SIMULATION_TYPES_H
+#define SIMULATION_TYPES_H
+
+// Plain value types shared by the simulation core and the front end
+
+enum class Direction {
+    UP,
+    DOWN,
+    LEFT,
+    RIGHT
+};
+
+enum class ObstacleType {
+    TREE,
+    ROCK
+};
+
+struct Cell {
+    int x;
+    int z;
+};
+
+inline bool operator==(const Cell& a, const Cell& b) {
+    return a.x == b.x && a.z == b.z;
+}
+
+inline bool operator!=(const Cell& a, const Cell& b) {
+    return !(a == b);
+}
+
+// The cell one step away in the given direction (UP is -z)
+inline Cell Neighbor(const Cell& cell, Direction direction) {
+    switch (direction) {
+        case Direction::UP:    return Cell{cell.x, cell.z - 1};
+        case Direction::DOWN:  return Cell{cell.x, cell.z + 1};
+        case Direction::LEFT:  return Cell{cell.x - 1, cell.z};
+        case Direction::RIGHT: return Cell{cell.x + 1, cell.z};
+    }
+    return cell;
+}
+
+struct Obstacle {
+    ObstacleType type;
+    Cell cell;
+    float scale;
+    float rotation;
+};
+
+enum class StepResult {
+    MOVED,
+    ATE_APPLE,
+    DIED
+};
+
+#endif // SIMULATION_TYPES_H
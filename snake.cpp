@@ -1,204 +1,397 @@
 #include "snake.h"
 #include <cstddef>  // Add this for size_t
+#include <algorithm>
+#include <cmath>
 #include "raymath.h"  // For Vector3 operations
+#include "rlgl.h"     // For the per-instance color buffer
+#include "segment_kernel.h"
+#include "trace.h"
 
-Snake::Snake() : 
-    direction(Direction::RIGHT),
-    nextDirection(Direction::RIGHT),
-    shouldGrow(false),
-    moveSpeed(5.0f),
-    isMoving(false) {
+// Radius of the segment spheres
+static const float segmentRadius = 0.5f;
+
+// Positions come from the per-instance transform, color from a per-instance attribute
+static const char* instanceVertexShader = R"(
+#version 330
+in vec3 vertexPosition;
+in mat4 instanceTransform;
+in vec4 instanceColor;
+uniform mat4 mvp;
+out vec4 fragColor;
+void main() {
+    fragColor = instanceColor;
+    gl_Position = mvp*instanceTransform*vec4(vertexPosition, 1.0);
 }
+)";
 
-Snake::~Snake() {
-    UnloadModel(sphereModel);
-    UnloadTexture(snakeTexture);
+static const char* instanceFragmentShader = R"(
+#version 330
+in vec4 fragColor;
+uniform vec4 colDiffuse;
+out vec4 finalColor;
+void main() {
+    finalColor = fragColor*colDiffuse;
 }
+)";
 
-void Snake::Initialize(const Vector3& startPos) {
-    // Create initial segments
-    segments.clear();
-    targetPositions.clear();
-    
-    // Initialize both segments and target positions with the same values
-    segments.push_back(startPos);
-    segments.push_back(Vector3{startPos.x - 1.0f, startPos.y, startPos.z});
-    segments.push_back(Vector3{startPos.x - 2.0f, startPos.y, startPos.z});
+// Gradient along the body; the head keeps its own color
+static Color SegmentColor(std::size_t index, std::size_t count) {
+    // Base snake colors - vibrant green palette
+    Color headColor = (Color){ 0, 180, 0, 255 };       // Bright green for head
+    Color bodyBaseColor = (Color){ 0, 220, 40, 255 };  // Lighter green for body
     
-    targetPositions = segments; // Copy segments to targetPositions
+    if (index == 0) {
+        return headColor;
+    }
     
-    // Create optimized sphere model for segments
-    sphereModel = LoadModelFromMesh(GenMeshSphere(0.5f, 16, 16)); // Higher detail
+    // Shift toward darker and more blue with each segment
+    Color segmentColor;
+    float fadeFactor = static_cast<float>(index) / static_cast<float>(count);
+    segmentColor.r = static_cast<unsigned char>(bodyBaseColor.r * (1.0f - fadeFactor * 0.5f));
+    segmentColor.g = static_cast<unsigned char>(bodyBaseColor.g * (1.0f - fadeFactor * 0.3f));
+    segmentColor.b = static_cast<unsigned char>(bodyBaseColor.b + (135 - bodyBaseColor.b) * fadeFactor);
+    segmentColor.a = 255;
+    return segmentColor;
+}
+
+Snake::Snake() : 
+    lastTick(0),
+    targetHead(0),
+    targetCount(0),
+    tailFrom(Vector3{0.0f, 0.0f, 0.0f}),
+    appliedBlend(NAN),
+    resources(nullptr),
+    sphereMeshes(),
+    sphereMaterial(),
+    colorsDirty(true),
+    dirtyBegin(),
+    dirtyEnd(),
+    colorBuffers(),
+    colorCapacities() {
+}
+
+Snake::~Snake() {
+    Unload();
+}
+
+void Snake::Initialize(ResourceCache* resources) {
+    Unload();
+    this->resources = resources;
     
-    // Default green texture for snake
-    snakeTexture = LoadTexture("resources/snake_texture.png");
+    // Segment spheres at each detail level, full detail first
+    const int rings[ViewFrustum::lodCount] = { 16, 10, 6 };
+    for (int lod = 0; lod < ViewFrustum::lodCount; ++lod) {
+        sphereMeshes[lod] = resources->AcquireSphere(segmentRadius, rings[lod], rings[lod]);
+    }
     
-    Material material = LoadMaterialDefault();
-    material.maps[MATERIAL_MAP_DIFFUSE].color = GREEN;
-    sphereModel.materials[0] = material;
+    // Segment colors come from the instance buffer, so the material stays white
+    sphereMaterial = resources->AcquireMaterial("snake_instanced", WHITE, instanceVertexShader, instanceFragmentShader);
+    instanceShader = sphereMaterial.shader;
+    instanceShader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(instanceShader, "instanceTransform");
+}
+
+void Snake::Unload() {
+    if (!resources) return;
     
-    direction = Direction::RIGHT;
-    nextDirection = Direction::RIGHT;
-    shouldGrow = false;
-    isMoving = false;
+    // The color buffers are this snake's own; meshes and material go back to the cache
+    for (int lod = 0; lod < ViewFrustum::lodCount; ++lod) {
+        if (colorBuffers[lod] != 0) rlUnloadVertexBuffer(colorBuffers[lod]);
+        colorBuffers[lod] = 0;
+        colorCapacities[lod] = 0;
+        resources->Release(sphereMeshes[lod]);
+    }
+    resources->Release(sphereMaterial);
+    resources = nullptr;
 }
 
-void Snake::Reset(const Vector3& startPos) {
-    direction = Direction::RIGHT;
-    nextDirection = Direction::RIGHT;
-    shouldGrow = false;
-    isMoving = false;
+void Snake::Reset(const std::vector<Cell>& body, unsigned long long tick) {
+    lastTick = tick;
     
-    segments.clear();
-    targetPositions.clear();
+    // Mirror the body, pushed tail first so the ring ends up head first
+    targetHead = 0;
+    targetCount = 0;
+    for (std::size_t i = body.size(); i > 0; --i) {
+        PushTarget(body[i - 1]);
+    }
     
-    segments.push_back(startPos);
-    segments.push_back(Vector3{startPos.x - 1.0f, startPos.y, startPos.z});
-    segments.push_back(Vector3{startPos.x - 2.0f, startPos.y, startPos.z});
+    // Visual segments start exactly on their grid positions
+    positionX.clear();
+    positionY.clear();
+    positionZ.clear();
+    for (std::size_t i = 0; i < targetCount; ++i) {
+        AddSegment(GetTarget(i));
+    }
     
-    targetPositions = segments;
+    // Nothing to slide from - the tail stays put until the next tick
+    tailFrom = targetCount > 0 ? GetTarget(targetCount - 1) : Vector3{0.0f, 0.0f, 0.0f};
+    appliedBlend = NAN;
 }
 
-void Snake::Move() {
-    // Don't move if already moving (waiting for interpolation to complete)
-    if (isMoving) return;
+void Snake::Move(const std::vector<Cell>& body, unsigned long long tick) {
+    TRACE_ZONE("Snake::Move");
     
-    // Update the current direction
-    direction = nextDirection;
+    // Anything other than a single tick since the last sync is a jump - resync
+    if (tick != lastTick + 1 || body.size() < targetCount || body.size() > targetCount + 1) {
+        Reset(body, tick);
+        return;
+    }
+    lastTick = tick;
     
-    // Store the last target position in case we need to grow
-    Vector3 lastPosition = targetPositions.back();
+    // The old tail cell is where the last segment slides from - whether it
+    // moved on, or it is a segment that just grew there
+    tailFrom = GetTarget(targetCount - 1);
     
-    // Move all target positions except the head
-    for (int i = targetPositions.size() - 1; i > 0; --i) {
-        targetPositions[i] = targetPositions[i - 1];
+    // A tick adds a head cell and drops the tail cell unless the body grew
+    bool grew = body.size() > targetCount;
+    if (!grew) {
+        targetCount--;
     }
+    PushTarget(body.front());
     
-    // Move the head target position based on current direction
-    switch (direction) {
-        case Direction::UP:
-            targetPositions[0].z -= 1.0f;
-            break;
-        case Direction::DOWN:
-            targetPositions[0].z += 1.0f;
-            break;
-        case Direction::LEFT:
-            targetPositions[0].x -= 1.0f;
-            break;
-        case Direction::RIGHT:
-            targetPositions[0].x += 1.0f;
-            break;
+    // New segments appear on the tail cell they grew from
+    if (grew) {
+        AddSegment(GetTarget(targetCount - 1));
     }
     
-    // Grow if needed
-    if (shouldGrow) {
-        targetPositions.push_back(lastPosition);
-        segments.push_back(lastPosition); // Add new segment at the same position
-        shouldGrow = false;
+    appliedBlend = NAN;
+}
+
+Vector3 Snake::GetTarget(std::size_t index) const {
+    std::size_t slot = (targetHead + index) & (targetX.size() - 1);
+    return Vector3{targetX[slot], targetY[slot], targetZ[slot]};
+}
+
+void Snake::PushTarget(const Cell& cell) {
+    // Double the ring when full, unwrapping it so the head starts at slot 0
+    if (targetCount == targetX.size()) {
+        std::size_t capacity = targetX.empty() ? 16 : targetX.size() * 2;
+        std::vector<float> newX(capacity), newY(capacity), newZ(capacity);
+        for (std::size_t i = 0; i < targetCount; ++i) {
+            Vector3 target = GetTarget(i);
+            newX[i] = target.x;
+            newY[i] = target.y;
+            newZ[i] = target.z;
+        }
+        targetX.swap(newX);
+        targetY.swap(newY);
+        targetZ.swap(newZ);
+        targetHead = 0;
     }
     
-    // Set the move flag to true to start interpolation
-    isMoving = true;
+    Vector3 target = CellToVector3(cell, 0.5f);
+    targetHead = (targetHead - 1) & (targetX.size() - 1);
+    targetX[targetHead] = target.x;
+    targetY[targetHead] = target.y;
+    targetZ[targetHead] = target.z;
+    targetCount++;
 }
 
-void Snake::Update(float deltaTime) {
-    // If not moving, do nothing
-    if (!isMoving) return;
+void Snake::AddSegment(const Vector3& position) {
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    positionZ.push_back(position.z);
+    colorsDirty = true;
+}
+
+void Snake::Update(float blend) {
+    TRACE_ZONE("Snake::Update");
+
+    // Nothing changed since the last frame (paused, game over, high frame rate)
+    if (blend == appliedBlend || positionX.empty()) return;
+    appliedBlend = blend;
     
-    // Calculate base speed - increase with snake length to maintain smoothness
-    float baseSpeed = moveSpeed * (1.0f + (segments.size() - 3) * 0.05f);
-    baseSpeed = fmin(baseSpeed, moveSpeed * 3.0f); // Cap the speed increase
+    // Segment i slides from target i + 1 (where it sat on the previous tick)
+    // to target i. The ring may wrap, so walk it in stretches where both
+    // slots are contiguous; the tail slides from the cell it just left.
+    const std::size_t count = positionX.size();
+    const std::size_t mask = targetX.size() - 1;
+    std::size_t segment = 0;
+    while (segment + 1 < count) {
+        std::size_t slot = (targetHead + segment) & mask;
+        std::size_t run = std::min(count - 1 - segment, mask - slot);
+        if (run == 0) {
+            // Last slot of the array, its predecessor wrapped around to slot 0
+            BlendSegments(&positionX[segment], &positionY[segment], &positionZ[segment], &targetX[0], &targetY[0], &targetZ[0],
+                          &targetX[slot], &targetY[slot], &targetZ[slot], 1, blend);
+            segment++;
+        } else {
+            BlendSegments(&positionX[segment], &positionY[segment], &positionZ[segment],
+                          &targetX[slot + 1], &targetY[slot + 1], &targetZ[slot + 1],
+                          &targetX[slot], &targetY[slot], &targetZ[slot], run, blend);
+            segment += run;
+        }
+    }
+    Vector3 tail = GetTarget(count - 1);
+    positionX[count - 1] = tailFrom.x + (tail.x - tailFrom.x) * blend;
+    positionY[count - 1] = tailFrom.y + (tail.y - tailFrom.y) * blend;
+    positionZ[count - 1] = tailFrom.z + (tail.z - tailFrom.z) * blend;
+}
+
+void Snake::Draw(const ViewFrustum& view) {
+    if (positionX.empty()) return;
     
-    // Only check if head has reached target - not waiting for all segments
-    if (Vector3Distance(segments[0], targetPositions[0]) < baseSpeed * deltaTime) {
-        segments[0] = targetPositions[0]; // Snap head to target
-        isMoving = false; // Allow new movement once head reaches target
-    } else {
-        // Move head towards target
-        Vector3 moveDir = Vector3Normalize(Vector3Subtract(targetPositions[0], segments[0]));
-        segments[0] = Vector3Add(segments[0], Vector3Scale(moveDir, baseSpeed * deltaTime));
+    // A resync onto a shorter body leaves slots pointing past the tail
+    if (segmentLods.size() > positionX.size()) {
+        ClearSlots();
     }
+    segmentLods.resize(positionX.size(), -1);
+    segmentSlots.resize(positionX.size(), 0);
     
-    // Always update all other segments to follow, regardless of head position
-    for (std::size_t i = 1; i < segments.size(); ++i) {
-        if (i >= targetPositions.size()) continue; // Safety check
+    if (colorsDirty) {
+        RebuildColors();
+    }
+    
+    // Squared camera distances where segments drop to the next detail level
+    float lodDistances[ViewFrustum::lodCount - 1];
+    view.LodDistancesSquared(segmentRadius, lodDistances);
+    const Vector3 eye = view.GetPosition();
+    
+    // Move the segments whose detail level changed; the rest keep their slots
+    for (std::size_t i = 0; i < positionX.size(); ++i) {
+        Vector3 center = Vector3{positionX[i], positionY[i], positionZ[i]};
+        int lod = -1;
+        if (view.SphereVisible(center, segmentRadius)) {
+            float dx = center.x - eye.x;
+            float dy = center.y - eye.y;
+            float dz = center.z - eye.z;
+            float distanceSquared = dx*dx + dy*dy + dz*dz;
+            
+            lod = 0;
+            while (lod < ViewFrustum::lodCount - 1 && distanceSquared > lodDistances[lod]) {
+                lod++;
+            }
+        }
+        if (lod != segmentLods[i]) {
+            PlaceSegment(i, lod);
+        }
+    }
+    
+    // One instanced draw per level that has anything in it; transforms
+    // change every frame, colors only where slots changed hands
+    for (int lod = 0; lod < ViewFrustum::lodCount; ++lod) {
+        const std::vector<std::size_t>& segments = lodSegments[lod];
+        if (segments.empty()) continue;
         
-        // Calculate movement speed - slightly faster for trailing segments for catchup
-        float segmentSpeed = baseSpeed * (1.0f + 0.1f * i);
-        float moveDelta = segmentSpeed * deltaTime;
+        lodTransforms[lod].resize(segments.size());
+        for (std::size_t slot = 0; slot < segments.size(); ++slot) {
+            std::size_t segment = segments[slot];
+            lodTransforms[lod][slot] = MatrixTranslate(positionX[segment], positionY[segment], positionZ[segment]);
+        }
         
-        // Check if we're close enough to snap to target position
-        if (Vector3Distance(segments[i], targetPositions[i]) < moveDelta) {
-            segments[i] = targetPositions[i]; // Snap to target
-        } else {
-            // Move towards target position with increased speed for trailing segments
-            Vector3 moveDir = Vector3Normalize(Vector3Subtract(targetPositions[i], segments[i]));
-            segments[i] = Vector3Add(segments[i], Vector3Scale(moveDir, moveDelta));
+        UploadColors(lod);
+        DrawMeshInstanced(sphereMeshes[lod], sphereMaterial, lodTransforms[lod].data(), static_cast<int>(segments.size()));
+    }
+    
+    // Add highlight to head for better visibility
+    if (view.SphereVisible(GetHeadPosition(), segmentRadius)) {
+        DrawSphere(Vector3Add(GetHeadPosition(), (Vector3){ 0.2f, 0.2f, 0.0f }), 0.15f, (Color){ 255, 255, 200, 120 });
+    }
+}
+
+void Snake::RebuildColors() {
+    colors.resize(positionX.size());
+    for (std::size_t i = 0; i < colors.size(); ++i) {
+        colors[i] = SegmentColor(i, colors.size());
+    }
+    colorsDirty = false;
+    
+    // The whole gradient shifted, so every slot gets its new color
+    for (int lod = 0; lod < ViewFrustum::lodCount; ++lod) {
+        for (std::size_t slot = 0; slot < lodSegments[lod].size(); ++slot) {
+            lodColors[lod][slot] = colors[lodSegments[lod][slot]];
         }
+        MarkColors(lod, 0, lodSegments[lod].size());
     }
 }
 
-void Snake::Grow() {
-    shouldGrow = true;
+void Snake::ClearSlots() {
+    segmentLods.clear();
+    segmentSlots.clear();
+    for (int lod = 0; lod < ViewFrustum::lodCount; ++lod) {
+        lodSegments[lod].clear();
+        lodColors[lod].clear();
+    }
 }
 
-void Snake::Draw() {
-    // Base snake colors - vibrant green palette
-    Color headColor = (Color){ 0, 180, 0, 255 };       // Bright green for head
-    Color bodyBaseColor = (Color){ 0, 220, 40, 255 };  // Lighter green for body
-    
-    // Draw each segment with a gradient effect
-    for (std::size_t i = 0; i < segments.size(); ++i) {
-        Color segmentColor;
-        
-        if (i == 0) {
-            // Head is distinctly colored
-            segmentColor = headColor;
-        } else {
-            // Create gradient effect for body - shift toward darker and more blue with each segment
-            float fadeFactor = static_cast<float>(i) / static_cast<float>(segments.size());
-            segmentColor.r = static_cast<unsigned char>(bodyBaseColor.r * (1.0f - fadeFactor * 0.5f));
-            segmentColor.g = static_cast<unsigned char>(bodyBaseColor.g * (1.0f - fadeFactor * 0.3f));
-            segmentColor.b = static_cast<unsigned char>(bodyBaseColor.b + (135 - bodyBaseColor.b) * fadeFactor);
-            segmentColor.a = 255;
-        }
-        
-        // Apply material color
-        Material material = sphereModel.materials[0];
-        material.maps[MATERIAL_MAP_DIFFUSE].color = segmentColor;
-        sphereModel.materials[0] = material;
-        
-        // Draw the segment
-        DrawModel(sphereModel, segments[i], 1.0f, WHITE);
-        
-        // Add highlight to head for better visibility
-        if (i == 0) {
-            DrawSphere(Vector3Add(segments[i], (Vector3){ 0.2f, 0.2f, 0.0f }), 0.15f, (Color){ 255, 255, 200, 120 });
+void Snake::PlaceSegment(std::size_t segment, int lod) {
+    // Leave the old batch by moving its last segment into the freed slot
+    int oldLod = segmentLods[segment];
+    if (oldLod >= 0) {
+        std::vector<std::size_t>& segments = lodSegments[oldLod];
+        std::size_t slot = segmentSlots[segment];
+        std::size_t last = segments.back();
+        segments[slot] = last;
+        segmentSlots[last] = slot;
+        lodColors[oldLod][slot] = lodColors[oldLod].back();
+        segments.pop_back();
+        lodColors[oldLod].pop_back();
+        if (last != segment) {
+            MarkColors(oldLod, slot, slot + 1);
         }
     }
+    
+    // Join the new one at the end
+    segmentLods[segment] = lod;
+    if (lod >= 0) {
+        segmentSlots[segment] = lodSegments[lod].size();
+        lodSegments[lod].push_back(segment);
+        lodColors[lod].push_back(colors[segment]);
+        MarkColors(lod, segmentSlots[segment], segmentSlots[segment] + 1);
+    }
 }
 
-Direction Snake::GetDirection() const {
-    return direction;
+void Snake::MarkColors(int lod, std::size_t begin, std::size_t end) {
+    if (begin >= end) return;
+    if (dirtyBegin[lod] >= dirtyEnd[lod]) {
+        dirtyBegin[lod] = begin;
+        dirtyEnd[lod] = end;
+    } else {
+        dirtyBegin[lod] = std::min(dirtyBegin[lod], begin);
+        dirtyEnd[lod] = std::max(dirtyEnd[lod], end);
+    }
 }
 
-void Snake::SetDirection(Direction dir) {
-    // Prevent 180-degree turns (e.g., can't go right when moving left)
-    if ((dir == Direction::LEFT && direction == Direction::RIGHT) ||
-        (dir == Direction::RIGHT && direction == Direction::LEFT) ||
-        (dir == Direction::UP && direction == Direction::DOWN) ||
-        (dir == Direction::DOWN && direction == Direction::UP)) {
-        return;
+void Snake::UploadColors(int lod) {
+    const std::vector<Color>& batch = lodColors[lod];
+    
+    // Reallocate the buffer with headroom when the batch outgrows it
+    if (batch.size() > colorCapacities[lod]) {
+        if (colorBuffers[lod] != 0) rlUnloadVertexBuffer(colorBuffers[lod]);
+        
+        std::size_t capacity = colorCapacities[lod] == 0 ? 64 : colorCapacities[lod];
+        while (capacity < batch.size()) {
+            capacity *= 2;
+        }
+        colorCapacities[lod] = capacity;
+        
+        int location = GetShaderLocationAttrib(instanceShader, "instanceColor");
+        rlEnableVertexArray(sphereMeshes[lod].vaoId);
+        colorBuffers[lod] = rlLoadVertexBuffer(nullptr, static_cast<int>(capacity * sizeof(Color)), true);
+        rlSetVertexAttribute(location, 4, RL_UNSIGNED_BYTE, true, 0, 0);
+        rlEnableVertexAttribute(location);
+        rlSetVertexAttributeDivisor(location, 1);
+        rlDisableVertexArray();
+        
+        // A fresh buffer holds nothing yet
+        MarkColors(lod, 0, batch.size());
     }
     
-    // Always allow direction change, even when moving
-    nextDirection = dir;
+    // Only the slots that changed since the last upload; the range may
+    // still cover slots that were dropped since
+    std::size_t end = std::min(dirtyEnd[lod], batch.size());
+    if (dirtyBegin[lod] < end) {
+        rlUpdateVertexBuffer(colorBuffers[lod], batch.data() + dirtyBegin[lod],
+                             static_cast<int>((end - dirtyBegin[lod]) * sizeof(Color)),
+                             static_cast<int>(dirtyBegin[lod] * sizeof(Color)));
+    }
+    dirtyBegin[lod] = 0;
+    dirtyEnd[lod] = 0;
 }
 
-const std::vector<Vector3>& Snake::GetSegments() const {
-    return segments;
+Vector3 Snake::GetHeadPosition() const {
+    return Vector3{positionX[0], positionY[0], positionZ[0]};
 }
 
 float Snake::GetLength() const {
-    return static_cast<float>(segments.size());
+    return static_cast<float>(positionX.size());
 }
@@ -2,43 +2,82 @@
 #define SNAKE_H
 
 #include "raylib.h"
+#include "simulation.h"
+#include "resource_cache.h"
+#include "view_frustum.h"
 #include <vector>
 
-enum class Direction {
-    UP,
-    DOWN,
-    LEFT,
-    RIGHT
-};
+// World-space position of a grid cell at the given height
+inline Vector3 CellToVector3(const Cell& cell, float y) {
+    return Vector3{static_cast<float>(cell.x), y, static_cast<float>(cell.z)};
+}
 
+// Visual side of the snake: smoothly follows copies of the simulation body
+// (head first) taken once per tick
 class Snake {
 public:
     Snake();
     ~Snake();
     
-    void Initialize(const Vector3& startPos);
-    void Reset(const Vector3& startPos);
-    void Move();
-    void Update(float deltaTime);  // New update method for smooth movement
-    void Grow();
-    void Draw();
-    
-    Direction GetDirection() const;
-    void SetDirection(Direction dir);
+    void Initialize(ResourceCache* resources);  // Meshes and material come from the shared cache
+    void Unload();  // Before the window closes
+    void Reset(const std::vector<Cell>& body, unsigned long long tick);  // Snap visuals onto the body
+    void Move(const std::vector<Cell>& body, unsigned long long tick);   // The simulation advanced; resyncs on jumps
+    void Update(float blend);      // Place segments between the last two ticks (0 = previous, 1 = latest)
+    void Draw(const ViewFrustum& view);  // Skips off-screen segments, thins out distant ones
     
-    const std::vector<Vector3>& GetSegments() const;
+    Vector3 GetHeadPosition() const;
     float GetLength() const;
     
 private:
-    std::vector<Vector3> segments;        // Current visual positions
-    std::vector<Vector3> targetPositions; // Target grid positions
-    Direction direction;
-    Direction nextDirection;
-    Model sphereModel;
-    Texture2D snakeTexture;
-    bool shouldGrow;
-    float moveSpeed;                      // Speed for smooth movement
-    bool isMoving;                        // Flag to track if currently moving
+    Vector3 GetTarget(std::size_t index) const;
+    void PushTarget(const Cell& cell);
+    void AddSegment(const Vector3& position);
+    void RebuildColors();
+    void ClearSlots();
+    void PlaceSegment(std::size_t segment, int lod);
+    void MarkColors(int lod, std::size_t begin, std::size_t end);
+    void UploadColors(int lod);
+    
+    unsigned long long lastTick;          // Simulation tick the targets mirror
+    
+    // Current visual positions in body order (head first), one array per axis
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    
+    // Grid targets mirrored from the simulation body as a ring buffer, so a
+    // tick writes one new head target instead of shifting them all
+    std::vector<float> targetX;
+    std::vector<float> targetY;
+    std::vector<float> targetZ;
+    std::size_t targetHead;
+    std::size_t targetCount;
+    Vector3 tailFrom;                     // Cell the tail left on the latest tick
+    
+    // Blend the positions were last computed for; NaN forces a recompute
+    float appliedBlend;
+    
+    ResourceCache* resources;             // Null until initialized and again once unloaded
+    Mesh sphereMeshes[ViewFrustum::lodCount];  // Same sphere at falling detail
+    Material sphereMaterial;
+    
+    // Instanced drawing: visible segments sit in one batch per detail level,
+    // with a transform and a color per instance. A segment keeps its slot
+    // until it changes level or leaves the view, so between frames only the
+    // slots that changed hands need their colors uploaded again.
+    Shader instanceShader;                // Owned by the material
+    std::vector<Color> colors;            // Gradient over the whole body
+    bool colorsDirty;                     // Gradient depends on length, so growth recolors
+    std::vector<int> segmentLods;         // Batch each segment sits in, -1 when culled
+    std::vector<std::size_t> segmentSlots;
+    std::vector<std::size_t> lodSegments[ViewFrustum::lodCount];  // Segment in each slot
+    std::vector<Matrix> lodTransforms[ViewFrustum::lodCount];
+    std::vector<Color> lodColors[ViewFrustum::lodCount];  // Mirrors the color buffer
+    std::size_t dirtyBegin[ViewFrustum::lodCount];  // Slots not uploaded yet
+    std::size_t dirtyEnd[ViewFrustum::lodCount];
+    unsigned int colorBuffers[ViewFrustum::lodCount];  // Per-instance color VBO attached to each mesh VAO
+    std::size_t colorCapacities[ViewFrustum::lodCount];
 };
 
 #endif // SNAKE_H
@@ -0,0 +1,490 @@
+// Microbenchmark and scaling suite for the per-tick hot paths. Headless and
+// self-contained, so it builds with -DSNAKE_BUILD_GAME=OFF and never fetches
+// raylib.
+//
+//   snake_bench [--filter TEXT] [--json FILE] [--compare BASELINE] [--threshold PCT]
+//
+// Every case is timed in batches of operations; the percentiles are over
+// the per-batch ns/op. --json writes the results, --compare reads an earlier
+// --json file and flags cases whose median got slower than the threshold
+// (exit code 1 if any did).
+//
+// Cases, with the game code they stand for:
+//   step/len=N         Simulation::Step on a long snake (Snake::Move + CheckCollision)
+//   eat/len=N          a Step that eats, including SpawnApple (one op per batch)
+//   interpolate/len=N  BlendSegments over the whole body (Snake::Update)
+//   obstacles/N        Simulation::Initialize, i.e. GenerateObstacles + Reset
+//   fork/arena=N       GameStateArena::Fork + Release of a game mid-play (search lookahead)
+//   savestate/arena=N  the same copy through SaveState + LoadState, for comparison
+//   vecenv/envs=N      VectorEnv::Step per env, observations updated from the move
+//   vecenv-redraw/envs=N  the same with every observation drawn from scratch
+
+#include "simulation.h"
+#include "game_state.h"
+#include "hamiltonian_cycle.h"
+#include "segment_kernel.h"
+#include "vector_env.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct BenchOptions {
+    const char* filter = nullptr;
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    double threshold = 10.0;  // Percent slower than the baseline median
+};
+
+struct BenchResult {
+    std::string name;
+    unsigned long long ops;
+    double min, p50, p90, p99, mean;  // ns/op
+};
+
+// Runs `run(count)` until at least minSamples batches and minSeconds have
+// passed. run does `count` operations and returns the nanoseconds they took,
+// so cases can keep setup out of the measurement.
+static BenchResult Measure(const std::string& name, int batch, const std::function<double(int)>& run) {
+    const int minSamples = 30;
+    const int maxSamples = 2000;
+    const double minSeconds = 0.25;
+
+    std::vector<double> samples;
+    auto start = std::chrono::steady_clock::now();
+    while (static_cast<int>(samples.size()) < maxSamples) {
+        samples.push_back(run(batch) / batch);
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (static_cast<int>(samples.size()) >= minSamples && elapsed >= minSeconds) break;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        return samples[static_cast<std::size_t>(p * (samples.size() - 1))];
+    };
+
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+
+    return BenchResult{name, static_cast<unsigned long long>(samples.size()) * batch,
+                       samples.front(), percentile(0.5), percentile(0.9), percentile(0.99), sum / samples.size()};
+}
+
+static double NanosecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Direction DirectionBetween(const Cell& from, const Cell& to) {
+    if (to.x > from.x) return Direction::RIGHT;
+    if (to.x < from.x) return Direction::LEFT;
+    return to.z > from.z ? Direction::DOWN : Direction::UP;
+}
+
+// Smallest arena (at least the default) whose tour leaves as many free
+// cells as the snake is long
+static int ArenaForLength(int length) {
+    int arenaSize = 20;
+    while (4 * arenaSize * arenaSize < 2 * length) {
+        arenaSize++;
+    }
+    return arenaSize;
+}
+
+// Roughly 40 cells per obstacle, so the random placement still finds room
+static int ArenaForObstacles(int obstacles) {
+    return std::max(20, static_cast<int>(std::ceil(std::sqrt(obstacles * 40.0) / 1.8)));
+}
+
+template <typename Value>
+static void AppendValue(std::string& out, const Value& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(Value));
+}
+
+// A Simulation::SaveState blob with the snake laid along the first `length`
+// positions of the tour, head last. Growing a 100k snake by playing would
+// take far longer than the benchmark itself.
+static std::string SnakeOnTour(const Simulation& sim, const HamiltonianCycle& cycle, int length, bool appleAhead) {
+    const OccupancyGrid& grid = sim.GetGrid();
+    const Cell head = grid.CellAt(cycle.CellAtOrder(length - 1));
+    const Cell next = grid.CellAt(cycle.CellAtOrder(length % cycle.Length()));
+    const Direction direction = DirectionBetween(head, next);
+
+    std::string state;
+    AppendValue(state, static_cast<unsigned long long>(0));  // tick
+    AppendValue(state, 0);                                    // score
+    AppendValue(state, static_cast<std::uint8_t>(direction));
+    AppendValue(state, static_cast<std::uint8_t>(direction));
+    AppendValue(state, static_cast<std::uint8_t>(appleAhead ? 2 : 0));
+    AppendValue(state, next);
+
+    AppendValue(state, static_cast<std::uint32_t>(length));
+    std::vector<std::uint8_t> onBody(grid.CellCount(), 0);
+    for (int position = 0; position < length; ++position) {
+        AppendValue(state, grid.CellAt(cycle.CellAtOrder(position)));
+        onBody[cycle.CellAtOrder(position)] = 1;
+    }
+
+    // LoadState drops cells apples may not spawn on, so every other arena cell can go in
+    std::vector<std::int32_t> freeCells;
+    for (int index = 0; index < grid.CellCount(); ++index) {
+        if (!onBody[index] && grid.InArena(grid.CellAt(index)) && !grid.IsBlocked(index)) {
+            freeCells.push_back(index);
+        }
+    }
+    AppendValue(state, static_cast<std::uint32_t>(freeCells.size()));
+    for (std::int32_t index : freeCells) {
+        AppendValue(state, index);
+    }
+
+    for (int i = 0; i < 4; ++i) {
+        AppendValue(state, static_cast<std::uint64_t>(0x9e3779b97f4a7c15ull * (i + 1)));
+    }
+    return state;
+}
+
+static void BenchSnakeLength(int length, std::vector<BenchResult>& results,
+                             const std::function<bool(const std::string&)>& selected) {
+    SimConfig config;
+    config.arenaSize = ArenaForLength(length);
+    config.maxObstacles = 0;  // Obstacles only shorten the tour; a step costs the same
+    Simulation sim(config);
+    sim.Initialize();
+
+    HamiltonianCycle cycle;
+    cycle.Build(sim.GetGrid(), Cell{-2, 0}, 3);
+    const OccupancyGrid& grid = sim.GetGrid();
+
+    // Direction out of every tour position, so the stepping loop is a lookup
+    std::vector<Direction> turns(cycle.Length());
+    for (int position = 0; position < cycle.Length(); ++position) {
+        turns[position] = DirectionBetween(grid.CellAt(cycle.CellAtOrder(position)),
+                                           grid.CellAt(cycle.CellAtOrder((position + 1) % cycle.Length())));
+    }
+
+    const std::string lengthSuffix = "/len=" + std::to_string(length);
+
+    if (selected("step" + lengthSuffix)) {
+        // No apple on the board, so every step is a plain move along the tour forever
+        const std::string state = SnakeOnTour(sim, cycle, length, false);
+        sim.LoadState(state.data(), state.size());
+        int position = length - 1;
+
+        results.push_back(Measure("step" + lengthSuffix, 1000, [&](int count) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < count; ++i) {
+                sim.Step(turns[position]);
+                position = position + 1 == cycle.Length() ? 0 : position + 1;
+            }
+            return NanosecondsSince(start);
+        }));
+
+        // A dead snake steps for free, which would make the numbers meaningless
+        if (sim.IsGameOver()) {
+            std::fprintf(stderr, "step%s: snake died, results are invalid\n", lengthSuffix.c_str());
+        }
+    }
+
+    if (selected("eat" + lengthSuffix)) {
+        // The apple sits right in front of the head; reloading stays outside the clock
+        const std::string state = SnakeOnTour(sim, cycle, length, true);
+        const Direction turn = turns[length - 1];
+
+        results.push_back(Measure("eat" + lengthSuffix, 1, [&](int) {
+            sim.LoadState(state.data(), state.size());
+            auto start = std::chrono::steady_clock::now();
+            StepResult result = sim.Step(turn);
+            double elapsed = NanosecondsSince(start);
+            if (result != StepResult::ATE_APPLE) {
+                std::fprintf(stderr, "eat%s: apple was missed, results are invalid\n", lengthSuffix.c_str());
+            }
+            return elapsed;
+        }));
+    }
+
+    if (selected("interpolate" + lengthSuffix)) {
+        // Targets head first plus the cell the tail just left; every segment
+        // is drawn between the target behind it and its own, as Snake::Update does
+        std::vector<float> x(length), y(length), z(length), tx(length + 1), ty(length + 1), tz(length + 1);
+        for (int i = 0; i <= length; ++i) {
+            Cell cell = grid.CellAt(cycle.CellAtOrder(length - i));
+            tx[i] = static_cast<float>(cell.x); ty[i] = 0.5f; tz[i] = static_cast<float>(cell.z);
+        }
+
+        int batch = std::max(1, 100000 / length);
+        results.push_back(Measure("interpolate" + lengthSuffix, batch, [&](int count) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < count; ++i) {
+                BlendSegments(x.data(), y.data(), z.data(), tx.data() + 1, ty.data() + 1, tz.data() + 1,
+                              tx.data(), ty.data(), tz.data(), static_cast<std::size_t>(length), (i & 15) / 16.0f);
+            }
+            return NanosecondsSince(start);
+        }));
+    }
+}
+
+static void BenchObstacles(int obstacles, std::vector<BenchResult>& results,
+                           const std::function<bool(const std::string&)>& selected) {
+    const std::string name = "obstacles/" + std::to_string(obstacles);
+    if (!selected(name)) return;
+
+    SimConfig config;
+    config.arenaSize = ArenaForObstacles(obstacles);
+    config.maxObstacles = obstacles;
+    Simulation sim(config);
+
+    // A fresh layout per op; seeds without jumps so reseeding costs nothing
+    std::uint64_t seed = 0;
+    std::size_t placed = 0;
+    results.push_back(Measure(name, 1, [&](int) {
+        sim.Seed(++seed);
+        auto start = std::chrono::steady_clock::now();
+        sim.Initialize();
+        double elapsed = NanosecondsSince(start);
+        placed = sim.GetObstacles().size();
+        return elapsed;
+    }));
+
+    std::printf("  (%s: arena %d, %zu of %d obstacles placed)\n", name.c_str(), config.arenaSize, placed, obstacles);
+}
+
+static bool WriteJson(const char* path, const std::vector<BenchResult>& results) {
+    std::FILE* file = std::fopen(path, "w");
+    if (!file) return false;
+
+    // One case per line, which is all ReadBaseline needs to parse it back
+    std::fprintf(file, "{\"benchmark\":\"snake_bench\",\"unit\":\"ns/op\",\"cases\":[\n");
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        std::fprintf(file, "{\"name\":\"%s\",\"ops\":%llu,\"min\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"mean\":%.3f}%s\n",
+                     r.name.c_str(), r.ops, r.min, r.p50, r.p90, r.p99, r.mean, i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "]}\n");
+
+    return std::fclose(file) == 0;
+}
+
+static bool ReadBaseline(const char* path, std::vector<BenchResult>& baseline) {
+    std::FILE* file = std::fopen(path, "r");
+    if (!file) return false;
+
+    char line[1024];
+    while (std::fgets(line, sizeof(line), file)) {
+        const char* name = std::strstr(line, "\"name\":\"");
+        const char* p50 = std::strstr(line, "\"p50\":");
+        if (!name || !p50) continue;
+
+        name += std::strlen("\"name\":\"");
+        const char* nameEnd = std::strchr(name, '"');
+        if (!nameEnd) continue;
+
+        BenchResult result = BenchResult();
+        result.name.assign(name, nameEnd);
+        result.p50 = std::strtod(p50 + std::strlen("\"p50\":"), nullptr);
+        baseline.push_back(result);
+    }
+
+    std::fclose(file);
+    return true;
+}
+
+// Prints every case found in both runs; returns the number of regressions
+static int Compare(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& results, double threshold) {
+    int regressions = 0;
+
+    std::printf("\n%-24s %12s %12s %9s\n", "case", "base p50", "p50", "change");
+    for (const auto& result : results) {
+        auto match = std::find_if(baseline.begin(), baseline.end(),
+                                  [&result](const BenchResult& b) { return b.name == result.name; });
+        if (match == baseline.end() || match->p50 <= 0.0) continue;
+
+        double change = 100.0 * (result.p50 - match->p50) / match->p50;
+        bool regressed = change > threshold;
+        regressions += regressed ? 1 : 0;
+
+        std::printf("%-24s %12.1f %12.1f %+8.1f%%%s\n", result.name.c_str(), match->p50, result.p50, change,
+                    regressed ? "  REGRESSION" : "");
+    }
+
+    return regressions;
+}
+
+static bool ParseOptions(int argc, char** argv, BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--filter") == 0) options.filter = value;
+        else if (std::strcmp(arg, "--json") == 0) options.jsonPath = value;
+        else if (std::strcmp(arg, "--compare") == 0) options.baselinePath = value;
+        else if (std::strcmp(arg, "--threshold") == 0) options.threshold = std::atof(value);
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    return true;
+}
+
+static void BenchFork(int arenaSize, std::vector<BenchResult>& results,
+                      const std::function<bool(const std::string&)>& selected) {
+    const std::string suffix = "/arena=" + std::to_string(arenaSize);
+    if (!selected("fork" + suffix) && !selected("savestate" + suffix)) return;
+
+    SimConfig config;
+    config.arenaSize = arenaSize;
+    Simulation sim(config);
+    sim.Initialize();
+
+    // A body of some length, grown the ordinary way along the tour
+    HamiltonianCycle cycle;
+    cycle.Build(sim.GetGrid(), Cell{-2, 0}, 3);
+    const std::string state = SnakeOnTour(sim, cycle, std::min(200, cycle.Length() / 2), false);
+    sim.LoadState(state.data(), state.size());
+
+    if (selected("fork" + suffix)) {
+        GameStateArena arena(std::make_shared<const GameLayout>(sim));
+        const GameState root = arena.Capture(sim);
+
+        results.push_back(Measure("fork" + suffix, 1000, [&](int count) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < count; ++i) {
+                arena.Release(arena.Fork(root));
+            }
+            return NanosecondsSince(start);
+        }));
+        std::printf("  (fork%s: %zu byte state + %zu byte body block)\n", suffix.c_str(), sizeof(GameState), arena.GetBlockBytes());
+    }
+
+    if (selected("savestate" + suffix)) {
+        Simulation copy(config);
+        copy.Initialize();
+        std::string blob;
+
+        results.push_back(Measure("savestate" + suffix, 100, [&](int count) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < count; ++i) {
+                sim.SaveState(blob);
+                copy.LoadState(blob.data(), blob.size());
+            }
+            return NanosecondsSince(start);
+        }));
+    }
+}
+
+static void BenchVectorEnv(int envCount, std::vector<BenchResult>& results,
+                           const std::function<bool(const std::string&)>& selected) {
+    const std::string suffix = "/envs=" + std::to_string(envCount);
+    for (bool redraw : {false, true}) {
+        const std::string name = (redraw ? "vecenv-redraw" : "vecenv") + suffix;
+        if (!selected(name)) continue;
+
+        VectorEnvConfig config;
+        config.envCount = envCount;
+        VectorEnv env(config);
+
+        // Two buffers; switching between them every step forces the redraw
+        std::vector<std::uint8_t> observations[2];
+        observations[0].resize(envCount * env.GetObservationSize());
+        observations[1].resize(envCount * env.GetObservationSize());
+        std::vector<float> rewards(envCount);
+        std::vector<std::uint8_t> dones(envCount);
+        std::vector<int> actions(envCount);
+        env.Reset(observations[0].data());
+
+        // Any open move, so games last long enough to be typical
+        RandomStream random(1);
+        int buffer = 0;
+        results.push_back(Measure(name, envCount * 4, [&](int count) {
+            double nanoseconds = 0.0;
+            for (int step = 0; step < count; step += envCount) {
+                for (int i = 0; i < envCount; ++i) {
+                    const Simulation& sim = env.GetSimulation(i);
+                    const int first = static_cast<int>(random.NextBelow(4));
+                    actions[i] = first;
+                    for (int turn = 0; turn < 4; ++turn) {
+                        const Direction direction = static_cast<Direction>((first + turn) & 3);
+                        if (!sim.IsBlocked(Neighbor(sim.GetHead(), direction))) {
+                            actions[i] = static_cast<int>(direction);
+                            break;
+                        }
+                    }
+                }
+                if (redraw) buffer ^= 1;
+
+                auto start = std::chrono::steady_clock::now();
+                env.Step(actions.data(), observations[buffer].data(), rewards.data(), dones.data());
+                nanoseconds += NanosecondsSince(start);
+            }
+            return nanoseconds;
+        }));
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: snake_bench [--filter TEXT] [--json FILE] [--compare BASELINE] [--threshold PCT]\n");
+        return 1;
+    }
+
+    // Read up front so a bad path fails before minutes of measuring
+    std::vector<BenchResult> baseline;
+    if (options.baselinePath && !ReadBaseline(options.baselinePath, baseline)) {
+        std::fprintf(stderr, "cannot read baseline %s\n", options.baselinePath);
+        return 1;
+    }
+
+    auto selected = [&options](const std::string& name) {
+        return !options.filter || name.find(options.filter) != std::string::npos;
+    };
+
+    std::vector<BenchResult> results;
+    for (int length : {3, 100, 1000, 10000, 100000}) {
+        BenchSnakeLength(length, results, selected);
+    }
+    for (int obstacles : {15, 100, 1000, 10000, 100000}) {
+        BenchObstacles(obstacles, results, selected);
+    }
+    for (int arenaSize : {20, 100}) {
+        BenchFork(arenaSize, results, selected);
+    }
+    BenchVectorEnv(64, results, selected);
+
+    std::printf("%-24s %10s %12s %12s %12s %12s %12s\n", "case", "ops", "min", "p50", "p90", "p99", "mean");
+    for (const auto& r : results) {
+        std::printf("%-24s %10llu %12.1f %12.1f %12.1f %12.1f %12.1f\n",
+                    r.name.c_str(), r.ops, r.min, r.p50, r.p90, r.p99, r.mean);
+    }
+    std::printf("(ns/op; eat and obstacles time one op per sample, so they include the clock's own cost)\n");
+
+    if (options.jsonPath && !WriteJson(options.jsonPath, results)) {
+        std::fprintf(stderr, "cannot write %s\n", options.jsonPath);
+        return 1;
+    }
+
+    if (options.baselinePath) {
+        int regressions = Compare(baseline, results, options.threshold);
+        if (regressions > 0) {
+            std::printf("%d case(s) more than %.1f%% slower than the baseline\n", regressions, options.threshold);
+            return 1;
+        }
+    }
+
+    return 0;
+}
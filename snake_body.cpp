@@ -0,0 +1,36 @@
+#include "snake_body.h"
+
+SnakeBody::SnakeBody() :
+    head(0),
+    length(0),
+    mask(0) {
+    Reserve(16);
+}
+
+void SnakeBody::Reserve(std::size_t capacity) {
+    if (capacity <= cells.size()) return;
+
+    std::size_t newCapacity = cells.empty() ? 1 : cells.size();
+    while (newCapacity < capacity) {
+        newCapacity *= 2;
+    }
+
+    // Unwrap into head-first order so the new buffer starts at index 0
+    std::vector<Cell> newCells(newCapacity);
+    for (std::size_t i = 0; i < length; ++i) {
+        newCells[i] = (*this)[i];
+    }
+
+    cells.swap(newCells);
+    head = 0;
+    mask = newCapacity - 1;
+}
+
+void SnakeBody::Clear() {
+    head = 0;
+    length = 0;
+}
+
+void SnakeBody::GrowStorage() {
+    Reserve(cells.size() * 2);
+}
@@ -0,0 +1,68 @@
+#ifndef SNAKE_BODY_H
+#define SNAKE_BODY_H
+
+#include "simulation_types.h"
+#include <cstddef>
+#include <vector>
+
+// Snake body stored as a circular buffer. The head index walks backwards
+// through the buffer, so a move writes one cell and a tail drop only
+// shortens the length - no element is ever shifted.
+class SnakeBody {
+public:
+    class ConstIterator {
+    public:
+        ConstIterator(const SnakeBody* body, std::size_t index) : body(body), index(index) {}
+        const Cell& operator*() const { return (*body)[index]; }
+        const Cell* operator->() const { return &(*body)[index]; }
+        ConstIterator& operator++() { ++index; return *this; }
+        bool operator==(const ConstIterator& other) const { return index == other.index; }
+        bool operator!=(const ConstIterator& other) const { return index != other.index; }
+
+    private:
+        const SnakeBody* body;
+        std::size_t index;
+    };
+
+    SnakeBody();
+
+    void Reserve(std::size_t capacity);  // Rounded up to a power of two
+    void Clear();
+
+    // Adds a new head; the body grows unless the tail is dropped afterwards
+    void PushHead(const Cell& cell) {
+        if (length == cells.size()) {
+            GrowStorage();
+        }
+        head = (head - 1) & mask;
+        cells[head] = cell;
+        length++;
+    }
+
+    void PopTail() {
+        length--;
+    }
+
+    // Index 0 is the head, Size() - 1 the tail
+    const Cell& operator[](std::size_t index) const {
+        return cells[(head + index) & mask];
+    }
+
+    const Cell& Head() const { return cells[head]; }
+    const Cell& Tail() const { return (*this)[length - 1]; }
+    std::size_t Size() const { return length; }
+    bool Empty() const { return length == 0; }
+
+    ConstIterator begin() const { return ConstIterator(this, 0); }
+    ConstIterator end() const { return ConstIterator(this, length); }
+
+private:
+    void GrowStorage();
+
+    std::vector<Cell> cells;
+    std::size_t head;
+    std::size_t length;
+    std::size_t mask;
+};
+
+#endif // SNAKE_BODY_H
@@ -0,0 +1,354 @@
+#include "static_world.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+#include "raymath.h"
+
+// Batches are split well before vertex counts get unwieldy for a single upload
+static const std::size_t maxBatchVertices = 1 << 18;
+
+// Side of the square tiles scenery and obstacles are grouped into for culling
+static const float tileSize = 16.0f;
+
+// Rough radius of one tree or rock, for picking a tile's detail level
+static const float objectRadius = 1.0f;
+
+static const Color treeColor = (Color){ 34, 139, 34, 255 };    // Forest green
+static const Color trunkColor = (Color){ 139, 69, 19, 255 };   // Brown
+static const Color rockColor = (Color){ 169, 169, 169, 255 };  // Dark grey
+
+static Color TintColor(Color color, Color tint) {
+    return Color{
+        static_cast<unsigned char>(color.r * tint.r / 255),
+        static_cast<unsigned char>(color.g * tint.g / 255),
+        static_cast<unsigned char>(color.b * tint.b / 255),
+        static_cast<unsigned char>(color.a * tint.a / 255)
+    };
+}
+
+// Same transform order DrawModelEx uses: scale, then rotate around Y, then translate
+static Matrix ModelTransform(Vector3 position, float rotation, Vector3 scale) {
+    Matrix matScale = MatrixScale(scale.x, scale.y, scale.z);
+    Matrix matRotation = MatrixRotate(Vector3{0, 1, 0}, rotation * DEG2RAD);
+    Matrix matTranslation = MatrixTranslate(position.x, position.y, position.z);
+    return MatrixMultiply(MatrixMultiply(matScale, matRotation), matTranslation);
+}
+
+StaticWorld::MeshBuilder::MeshBuilder(std::vector<Mesh>* output) :
+    output(output),
+    bounds(BoundingBox{Vector3{FLT_MAX, FLT_MAX, FLT_MAX}, Vector3{-FLT_MAX, -FLT_MAX, -FLT_MAX}}) {
+}
+
+void StaticWorld::MeshBuilder::Append(const Mesh& source, const Matrix& transform, Color color) {
+    // Indexed sources (cubes, planes) are expanded so every batch is a plain triangle list
+    int count = source.indices ? source.triangleCount * 3 : source.vertexCount;
+
+    if (vertices.size() / 3 + count > maxBatchVertices) {
+        Flush();
+    }
+
+    // Normals only need the rotation part of the transform
+    Matrix normalTransform = transform;
+    normalTransform.m12 = normalTransform.m13 = normalTransform.m14 = 0.0f;
+
+    for (int i = 0; i < count; ++i) {
+        int v = source.indices ? source.indices[i] : i;
+
+        Vector3 position = Vector3Transform(Vector3{source.vertices[v*3], source.vertices[v*3 + 1], source.vertices[v*3 + 2]}, transform);
+        vertices.push_back(position.x);
+        vertices.push_back(position.y);
+        vertices.push_back(position.z);
+        bounds.min = Vector3{fminf(bounds.min.x, position.x), fminf(bounds.min.y, position.y), fminf(bounds.min.z, position.z)};
+        bounds.max = Vector3{fmaxf(bounds.max.x, position.x), fmaxf(bounds.max.y, position.y), fmaxf(bounds.max.z, position.z)};
+
+        Vector3 normal = Vector3{0.0f, 1.0f, 0.0f};
+        if (source.normals) {
+            normal = Vector3Normalize(Vector3Transform(Vector3{source.normals[v*3], source.normals[v*3 + 1], source.normals[v*3 + 2]}, normalTransform));
+        }
+        normals.push_back(normal.x);
+        normals.push_back(normal.y);
+        normals.push_back(normal.z);
+
+        colors.push_back(color.r);
+        colors.push_back(color.g);
+        colors.push_back(color.b);
+        colors.push_back(color.a);
+    }
+}
+
+void StaticWorld::MeshBuilder::Flush() {
+    if (vertices.empty()) return;
+
+    // raylib frees mesh arrays with its own allocator, so copy into MemAlloc'd buffers
+    Mesh mesh = {};
+    mesh.vertexCount = static_cast<int>(vertices.size() / 3);
+    mesh.triangleCount = mesh.vertexCount / 3;
+    mesh.vertices = static_cast<float*>(MemAlloc(vertices.size() * sizeof(float)));
+    mesh.normals = static_cast<float*>(MemAlloc(normals.size() * sizeof(float)));
+    mesh.texcoords = static_cast<float*>(MemAlloc(mesh.vertexCount * 2 * sizeof(float)));
+    mesh.colors = static_cast<unsigned char*>(MemAlloc(colors.size()));
+    std::memcpy(mesh.vertices, vertices.data(), vertices.size() * sizeof(float));
+    std::memcpy(mesh.normals, normals.data(), normals.size() * sizeof(float));
+    std::memcpy(mesh.colors, colors.data(), colors.size());
+
+    UploadMesh(&mesh, false);
+    output->push_back(mesh);
+
+    vertices.clear();
+    normals.clear();
+    colors.clear();
+}
+
+StaticWorld::StaticWorld() :
+    streamX(-1),
+    streamZ(-1),
+    resources(nullptr),
+    shapes(),
+    batchMaterial() {
+}
+
+StaticWorld::~StaticWorld() {
+    Unload();
+}
+
+void StaticWorld::Build(float arenaSize, const std::vector<Obstacle>& obstacles, ResourceCache* resources) {
+    Unload();
+    this->resources = resources;
+
+    // Source shapes, transformed and merged into the batches below
+    Mesh planeMesh = resources->AcquirePlane(1.0f, 1.0f, 1, 1);
+    Mesh cubeMesh = resources->AcquireCube(1.0f, 1.0f, 1.0f);
+
+    // Tile shapes at full and reduced detail
+    shapes[TREE][0] = resources->AcquireCone(0.7f, 2.0f, 8);
+    shapes[TREE][1] = resources->AcquireCone(0.7f, 2.0f, 5);
+    shapes[TRUNK][0] = resources->AcquireCylinder(1.0f, 1.0f, 8);
+    shapes[TRUNK][1] = resources->AcquireCylinder(1.0f, 1.0f, 4);
+    shapes[ROCK][0] = resources->AcquireSphere(0.8f, 6, 6);
+    shapes[ROCK][1] = resources->AcquireSphere(0.8f, 4, 4);
+    batchMaterial = resources->AcquireMaterial("vertex_colored", WHITE);
+
+    MeshBuilder builder(&ground);
+
+    // Draw extended terrain with clear depth separation
+    float extendedSize = arenaSize * 1.5f;
+
+    // Base terrain (lowest level) - darker grass for outer area
+    builder.Append(planeMesh, ModelTransform(Vector3{0.0f, -0.1f, 0.0f}, 0.0f, Vector3{extendedSize * 2.0f, 1.0f, extendedSize * 2.0f}),
+                   (Color){ 65, 160, 20, 255 });
+
+    // Playable area slightly elevated for clear separation
+    builder.Append(planeMesh, ModelTransform(Vector3{0.0f, 0.0f, 0.0f}, 0.0f, Vector3{arenaSize * 2.0f, 1.0f, arenaSize * 2.0f}),
+                   (Color){ 76, 187, 23, 255 });
+
+    // Borders with clearer positioning
+    float wallHeight = 1.0f;
+    float wallOffset = 0.5f;
+    float wallThickness = 1.0f;
+    Color wallColor = (Color){ 139, 134, 130, 255 };
+
+    Vector3 horizontalWall = Vector3{arenaSize*2 + wallThickness, wallHeight, wallThickness};
+    Vector3 verticalWall = Vector3{wallThickness, wallHeight, arenaSize*2 + wallThickness};
+    builder.Append(cubeMesh, ModelTransform(Vector3{0, wallHeight/2, arenaSize + wallOffset}, 0.0f, horizontalWall), wallColor);
+    builder.Append(cubeMesh, ModelTransform(Vector3{0, wallHeight/2, -arenaSize - wallOffset}, 0.0f, horizontalWall), wallColor);
+    builder.Append(cubeMesh, ModelTransform(Vector3{arenaSize + wallOffset, wallHeight/2, 0}, 0.0f, verticalWall), wallColor);
+    builder.Append(cubeMesh, ModelTransform(Vector3{-arenaSize - wallOffset, wallHeight/2, 0}, 0.0f, verticalWall), wallColor);
+
+    // Corner posts
+    float postSize = 1.2f;
+    Vector3 post = Vector3{postSize, wallHeight*1.5f, postSize};
+    builder.Append(cubeMesh, ModelTransform(Vector3{arenaSize + wallOffset/2, wallHeight/2, arenaSize + wallOffset/2}, 0.0f, post), wallColor);
+    builder.Append(cubeMesh, ModelTransform(Vector3{-arenaSize - wallOffset/2, wallHeight/2, arenaSize + wallOffset/2}, 0.0f, post), wallColor);
+    builder.Append(cubeMesh, ModelTransform(Vector3{arenaSize + wallOffset/2, wallHeight/2, -arenaSize - wallOffset/2}, 0.0f, post), wallColor);
+    builder.Append(cubeMesh, ModelTransform(Vector3{-arenaSize - wallOffset/2, wallHeight/2, -arenaSize - wallOffset/2}, 0.0f, post), wallColor);
+
+    builder.Flush();
+
+    // Everything else is sorted into tiles first and baked per tile below
+    std::map<std::pair<int, int>, std::vector<Part>> tileParts;
+    auto tileOf = [](const Matrix& transform) {
+        return std::pair<int, int>(static_cast<int>(floorf(transform.m12 / tileSize)), static_cast<int>(floorf(transform.m14 / tileSize)));
+    };
+    auto addPart = [&](Shape shape, Vector3 position, float rotation, Vector3 scale, Color color) {
+        Matrix transform = ModelTransform(position, rotation, scale);
+        tileParts[tileOf(transform)].push_back(Part{shape, transform, color});
+    };
+
+    // Decorative objects around the area with height variation to prevent z-fighting
+    for (int i = 0; i < 24; i++) {
+        float angle = (float)i * 15.0f * DEG2RAD;
+
+        // Vary the distance to prevent objects from aligning on the same Z
+        float distance = extendedSize * 0.9f + ((i % 3) * 0.4f);
+
+        float x = sinf(angle) * distance;
+        float z = cosf(angle) * distance;
+
+        // Add slight height variation for each object to prevent z-fighting
+        float baseY = -0.1f + ((i % 5) * 0.02f);
+        float scale = 0.8f + ((i * 13) % 50) / 100.0f;  // Deterministic but varied scale
+
+        if (i % 2 == 0) {
+            // Tree with adjusted base height
+            addPart(TREE, Vector3{x, baseY + 1.0f, z}, (float)(i * 30), Vector3{scale * 1.2f, scale * 1.2f, scale * 1.2f}, treeColor);
+
+            // Trunk
+            float trunkRadius = 0.2f * scale * 1.2f;
+            addPart(TRUNK, Vector3{x, baseY + 0.4f, z}, 0.0f, Vector3{trunkRadius, 0.8f, trunkRadius}, trunkColor);
+        } else {
+            // Rock with varied height
+            addPart(ROCK, Vector3{x, baseY + 0.05f + ((i % 3) * 0.03f), z}, (float)(i * 30), Vector3{scale * 1.5f, scale * 0.9f, scale * 1.5f},
+                    TintColor(rockColor, (Color){ 150, 150, 150, 255 }));
+        }
+    }
+
+    // Obstacles within the playable area
+    std::vector<Part> obstacleParts;
+    for (const auto& obs : obstacles) {
+        AddObstacleParts(obs, obstacleParts);
+    }
+    for (const auto& part : obstacleParts) {
+        tileParts[tileOf(part.transform)].push_back(part);
+    }
+
+    // Sized up front - the builders keep pointers into the tiles
+    tiles.resize(tileParts.size());
+    std::size_t index = 0;
+    for (const auto& entry : tileParts) {
+        BakeTile(tiles[index++], entry.second);
+    }
+
+    resources->Release(planeMesh);
+    resources->Release(cubeMesh);
+}
+
+void StaticWorld::Stream(const Simulation& sim, const Cell& center) {
+    const ChunkedWorld& world = sim.GetWorld();
+    const int centerX = world.ChunkX(center);
+    const int centerZ = world.ChunkZ(center);
+    if (centerX == streamX && centerZ == streamZ) return;
+    streamX = centerX;
+    streamZ = centerZ;
+
+    // The same square of chunks the simulation keeps resident around the head
+    const int radius = Simulation::residentChunkRadius;
+    for (auto it = chunkTiles.begin(); it != chunkTiles.end();) {
+        if (std::abs(it->first.first - centerX) > radius || std::abs(it->first.second - centerZ) > radius) {
+            UnloadTile(it->second);
+            it = chunkTiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    std::vector<Part> parts;
+    for (int z = std::max(centerZ - radius, 0); z <= std::min(centerZ + radius, world.ChunksPerSide() - 1); ++z) {
+        for (int x = std::max(centerX - radius, 0); x <= std::min(centerX + radius, world.ChunksPerSide() - 1); ++x) {
+            std::pair<int, int> key(x, z);
+            if (chunkTiles.count(key)) continue;
+
+            parts.clear();
+            for (const auto& obs : sim.GetChunk(x, z).obstacles) {
+                AddObstacleParts(obs, parts);
+            }
+            BakeTile(chunkTiles[key], parts);
+        }
+    }
+}
+
+void StaticWorld::AddObstacleParts(const Obstacle& obs, std::vector<Part>& parts) {
+    Vector3 position = Vector3{static_cast<float>(obs.cell.x), 0.0f, static_cast<float>(obs.cell.z)};
+
+    if (obs.type == ObstacleType::TREE) {
+        // Tree (cone)
+        parts.push_back(Part{TREE, ModelTransform(Vector3{position.x, position.y + 1.0f, position.z}, obs.rotation,
+                                                  Vector3{obs.scale, obs.scale, obs.scale}), treeColor});
+
+        // Tree trunk (cylinder)
+        float trunkRadius = 0.2f * obs.scale;
+        parts.push_back(Part{TRUNK, ModelTransform(Vector3{position.x, position.y + 0.4f, position.z}, 0.0f,
+                                                   Vector3{trunkRadius, 0.8f, trunkRadius}), trunkColor});
+    } else {
+        // Rock
+        parts.push_back(Part{ROCK, ModelTransform(position, obs.rotation, Vector3{obs.scale, obs.scale * 0.6f, obs.scale}), rockColor});
+    }
+}
+
+void StaticWorld::BakeTile(Tile& tile, const std::vector<Part>& parts) const {
+    for (int lod = 0; lod < tileLodCount; ++lod) {
+        MeshBuilder tileBuilder(&tile.lods[lod]);
+        for (const auto& part : parts) {
+            tileBuilder.Append(shapes[part.shape][lod], part.transform, part.color);
+        }
+        tileBuilder.Flush();
+
+        // The reduced shapes never reach past the full ones
+        if (lod == 0) {
+            tile.bounds = tileBuilder.GetBounds();
+        }
+    }
+}
+
+void StaticWorld::UnloadTile(Tile& tile) {
+    for (auto& lod : tile.lods) {
+        for (auto& batch : lod) {
+            UnloadMesh(batch);
+        }
+        lod.clear();
+    }
+}
+
+void StaticWorld::Draw(const ViewFrustum& view) const {
+    for (const auto& batch : ground) {
+        DrawMesh(batch, batchMaterial, MatrixIdentity());
+    }
+
+    auto drawTile = [this, &view](const Tile& tile) {
+        if (tile.lods[0].empty() || !view.BoxVisible(tile.bounds)) return;
+
+        int lod = std::min(view.SelectLod(view.DistanceTo(tile.bounds), objectRadius), tileLodCount - 1);
+        for (const auto& batch : tile.lods[lod]) {
+            DrawMesh(batch, batchMaterial, MatrixIdentity());
+        }
+    };
+
+    for (const auto& tile : tiles) {
+        drawTile(tile);
+    }
+    for (const auto& entry : chunkTiles) {
+        drawTile(entry.second);
+    }
+}
+
+void StaticWorld::Unload() {
+    for (auto& batch : ground) {
+        UnloadMesh(batch);
+    }
+    ground.clear();
+
+    for (auto& tile : tiles) {
+        UnloadTile(tile);
+    }
+    tiles.clear();
+
+    for (auto& entry : chunkTiles) {
+        UnloadTile(entry.second);
+    }
+    chunkTiles.clear();
+    streamX = -1;
+    streamZ = -1;
+
+    if (resources) {
+        for (auto& shape : shapes) {
+            for (auto& mesh : shape) {
+                resources->Release(mesh);
+            }
+        }
+        resources->Release(batchMaterial);
+        resources = nullptr;
+    }
+}
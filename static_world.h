@@ -0,0 +1,78 @@
+#ifndef STATIC_WORLD_H
+#define STATIC_WORLD_H
+
+#include "raylib.h"
+#include "simulation.h"
+#include "resource_cache.h"
+#include "view_frustum.h"
+#include <map>
+#include <utility>
+#include <vector>
+
+// Everything that does not move between obstacle layouts - terrain, walls,
+// corner posts, decorative scenery and obstacles - baked into a few
+// vertex-colored meshes, all drawn with one shared material, so the static
+// world costs a handful of draw calls.
+// Scenery and obstacles are baked per square tile, at full and reduced
+// detail, so off-screen tiles are skipped and distant ones drawn cheaply.
+// Chunked arenas are streamed instead: one tile per world chunk near the
+// head, baked when it comes into range and unloaded when it leaves.
+class StaticWorld {
+public:
+    StaticWorld();
+    ~StaticWorld();
+
+    // Replaces any previous bake; source shapes and material come from the cache
+    void Build(float arenaSize, const std::vector<Obstacle>& obstacles, ResourceCache* resources);
+    void Stream(const Simulation& sim, const Cell& center);  // Chunked arenas, once per frame
+    void Draw(const ViewFrustum& view) const;
+    void Unload();
+
+private:
+    // Accumulates transformed copies of source meshes into one batch
+    class MeshBuilder {
+    public:
+        explicit MeshBuilder(std::vector<Mesh>* output);
+        void Append(const Mesh& source, const Matrix& transform, Color color);
+        void Flush();
+        BoundingBox GetBounds() const { return bounds; }  // Of everything appended so far
+
+    private:
+        std::vector<Mesh>* output;
+        std::vector<float> vertices;
+        std::vector<float> normals;
+        std::vector<unsigned char> colors;
+        BoundingBox bounds;
+    };
+
+    static const int tileLodCount = 2;
+
+    struct Tile {
+        BoundingBox bounds;
+        std::vector<Mesh> lods[tileLodCount];
+    };
+
+    // Tile shapes, kept loaded so streamed tiles can be baked later
+    enum Shape { TREE, TRUNK, ROCK, SHAPE_COUNT };
+
+    struct Part {
+        Shape shape;
+        Matrix transform;
+        Color color;
+    };
+
+    static void AddObstacleParts(const Obstacle& obs, std::vector<Part>& parts);
+    void BakeTile(Tile& tile, const std::vector<Part>& parts) const;
+    static void UnloadTile(Tile& tile);
+
+    std::vector<Mesh> ground;  // Terrain and walls, on screen nearly all the time
+    std::vector<Tile> tiles;
+    std::map<std::pair<int, int>, Tile> chunkTiles;  // Streamed, keyed by chunk coordinates
+    int streamX;  // Chunk the streamed tiles were last gathered around
+    int streamZ;
+    ResourceCache* resources;  // Null while nothing is built
+    Mesh shapes[SHAPE_COUNT][tileLodCount];
+    Material batchMaterial;    // Default shader, colors come from the vertices
+};
+
+#endif // STATIC_WORLD_H
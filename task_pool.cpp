@@ -0,0 +1,126 @@
+#include "task_pool.h"
+#include "trace.h"
+#include <cassert>
+
+// The pool whose worker runs on this thread, and that worker's index. A
+// thread belongs to one pool at most, but may submit to any other.
+static thread_local const TaskPool* currentPool = nullptr;
+static thread_local int currentWorker = -1;
+
+TaskPool::TaskPool(unsigned int threadCount) :
+    queued(0),
+    unfinished(0),
+    nextWorker(0),
+    stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&TaskPool::Run, this, i);
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void TaskPool::Submit(std::function<void()> task) {
+    unsigned int index = currentPool == this
+        ? static_cast<unsigned int>(currentWorker)
+        : nextWorker++ % static_cast<unsigned int>(workers.size());
+
+    unfinished++;
+
+    // Counted before it is visible so a worker never sees queued drop below zero;
+    // the sleep lock orders the increment against a worker about to sleep
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(workers[index]->mutex);
+        workers[index]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+void TaskPool::Wait() {
+    // The calling task counts as unfinished itself, so this would never return
+    assert(currentPool != this && "TaskPool::Wait called from one of its own tasks");
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    allDone.wait(lock, [this]() { return unfinished.load() == 0; });
+}
+
+unsigned int TaskPool::GetThreadCount() const {
+    return static_cast<unsigned int>(threads.size());
+}
+
+bool TaskPool::TryPop(unsigned int index, std::function<void()>& task) {
+    Worker& worker = *workers[index];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) return false;
+
+    // Newest first - it is the one most likely still warm in cache
+    task = std::move(worker.tasks.back());
+    worker.tasks.pop_back();
+    return true;
+}
+
+bool TaskPool::TrySteal(unsigned int thief, std::function<void()>& task) {
+    const unsigned int count = static_cast<unsigned int>(workers.size());
+
+    for (unsigned int offset = 1; offset < count; ++offset) {
+        Worker& victim = *workers[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) continue;
+
+        // Oldest first - the victim keeps working on its own recent tasks
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+
+    return false;
+}
+
+void TaskPool::Run(unsigned int index) {
+    currentPool = this;
+    currentWorker = static_cast<int>(index);
+    TRACE_THREAD_NAME("TaskPool worker");
+
+    while (true) {
+        std::function<void()> task;
+
+        if (TryPop(index, task) || TrySteal(index, task)) {
+            queued--;
+            task();
+
+            if (--unfinished == 0) {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing anywhere - sleep until a Submit or shutdown
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        workAvailable.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads with one task deque each. A worker takes
+// its own newest task first and, when it runs dry, steals the oldest task
+// from another worker, so uneven jobs (short and long games) even out
+// without a central queue everyone contends on.
+class TaskPool {
+public:
+    explicit TaskPool(unsigned int threadCount = 0);  // 0 = one per hardware thread
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    // Tasks submitted from one of this pool's workers go to that worker's
+    // own deque; from anywhere else (other pools' workers included) they
+    // are dealt round robin
+    void Submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished. Never call it from a
+    // task of the same pool: that task is one of the unfinished ones, so
+    // the wait could not end. Code that may run on a worker (a server
+    // request, say) has to do its part serially instead.
+    void Wait();
+
+    unsigned int GetThreadCount() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void Run(unsigned int index);
+    bool TryPop(unsigned int index, std::function<void()>& task);
+    bool TrySteal(unsigned int thief, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::atomic<std::size_t> queued;    // Submitted but not yet picked up
+    std::atomic<std::size_t> unfinished;  // Submitted but not yet finished
+    std::atomic<unsigned int> nextWorker;
+    bool stopping;
+
+    std::mutex sleepMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+};
+
+#endif // TASK_POOL_H
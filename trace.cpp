@@ -0,0 +1,156 @@
+#include "trace.h"
+
+#if defined(SNAKE_ENABLE_TRACING)
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Most recent events kept per thread (power of two); older ones are overwritten
+static const std::uint64_t ringCapacity = std::uint64_t(1) << 16;
+
+// Fields are relaxed atomics so a dump may read a slot the owner is
+// rewriting; torn copies are detected and dropped afterwards
+struct TraceEvent {
+    std::atomic<const char*> name;
+    std::atomic<std::uint64_t> start;
+    std::atomic<std::uint64_t> duration;
+};
+
+struct ThreadRing {
+    explicit ThreadRing(int id) : id(id), written(0), events(new TraceEvent[ringCapacity]) {}
+
+    int id;
+    std::string name;                    // Guarded by the registry mutex
+    std::atomic<std::uint64_t> written;  // Events ever recorded; only the owner advances it
+    std::unique_ptr<TraceEvent[]> events;
+};
+
+// Rings live until exit so a dump still sees threads that already finished
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+};
+
+static TraceRegistry& Registry() {
+    static TraceRegistry registry;
+    return registry;
+}
+
+static ThreadRing* CurrentRing() {
+    static thread_local ThreadRing* ring = nullptr;
+    if (!ring) {
+        // Once per thread; every later event is lock-free
+        TraceRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.rings.emplace_back(new ThreadRing(static_cast<int>(registry.rings.size()) + 1));
+        ring = registry.rings.back().get();
+    }
+    return ring;
+}
+
+static std::uint64_t NowNanoseconds() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+TraceZone::TraceZone(const char* name) :
+    name(name),
+    start(NowNanoseconds()) {
+}
+
+TraceZone::~TraceZone() {
+    const std::uint64_t end = NowNanoseconds();
+    ThreadRing* ring = CurrentRing();
+
+    const std::uint64_t index = ring->written.load(std::memory_order_relaxed);
+    TraceEvent& event = ring->events[index & (ringCapacity - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.duration.store(end - start, std::memory_order_relaxed);
+    ring->written.store(index + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char* name) {
+    ThreadRing* ring = CurrentRing();
+    std::lock_guard<std::mutex> lock(Registry().mutex);
+    ring->name = name;
+}
+
+bool Trace::Dump(const char* path) {
+    struct Copied {
+        int thread;
+        const char* name;
+        std::uint64_t start;
+        std::uint64_t duration;
+    };
+
+    std::vector<Copied> copied;
+    std::vector<std::pair<int, std::string>> threads;
+
+    {
+        TraceRegistry& registry = Registry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        for (const auto& ring : registry.rings) {
+            threads.emplace_back(ring->id, ring->name);
+
+            const std::uint64_t end = ring->written.load(std::memory_order_acquire);
+            const std::uint64_t begin = end > ringCapacity ? end - ringCapacity : 0;
+            const std::size_t first = copied.size();
+
+            for (std::uint64_t i = begin; i < end; ++i) {
+                const TraceEvent& event = ring->events[i & (ringCapacity - 1)];
+                copied.push_back(Copied{ ring->id,
+                                         event.name.load(std::memory_order_relaxed),
+                                         event.start.load(std::memory_order_relaxed),
+                                         event.duration.load(std::memory_order_relaxed) });
+            }
+
+            // Slots the owner reached while we copied (plus the one it may be
+            // writing right now) can be torn - drop them
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t after = ring->written.load(std::memory_order_acquire) + 1;
+            const std::uint64_t valid = after > ringCapacity ? after - ringCapacity : 0;
+            if (valid > begin) {
+                std::size_t torn = static_cast<std::size_t>(std::min(valid, end) - begin);
+                copied.erase(copied.begin() + first, copied.begin() + first + torn);
+            }
+        }
+    }
+
+    std::FILE* file = std::fopen(path, "w");
+    if (!file) return false;
+
+    // Timestamps relative to the oldest event, in microseconds
+    std::uint64_t origin = ~std::uint64_t(0);
+    for (const auto& event : copied) {
+        origin = std::min(origin, event.start);
+    }
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool firstEntry = true;
+    for (const auto& thread : threads) {
+        if (thread.second.empty()) continue;
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     firstEntry ? "" : ",\n", thread.first, thread.second.c_str());
+        firstEntry = false;
+    }
+    for (const auto& event : copied) {
+        std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                     firstEntry ? "" : ",\n", event.name, event.thread,
+                     (event.start - origin) / 1000.0, event.duration / 1000.0);
+        firstEntry = false;
+    }
+    std::fprintf(file, "\n]}\n");
+
+    return std::fclose(file) == 0;
+}
+
+#endif
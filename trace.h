@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Scoped timing zones for finding frame spikes. Build with SNAKE_TRACING=ON
+// (defines SNAKE_ENABLE_TRACING); otherwise every macro below expands to
+// nothing and costs nothing.
+//
+//   void Snake::Update(float deltaTime) {
+//       TRACE_ZONE("Snake::Update");
+//       ...
+//
+// Each thread records into its own ring of the most recent events. Only
+// the owning thread writes to a ring, so recording takes no locks; a dump
+// copies every ring out as Chrome trace JSON (chrome://tracing, Perfetto).
+
+#if defined(SNAKE_ENABLE_TRACING)
+
+#include <cstdint>
+
+class TraceZone {
+public:
+    explicit TraceZone(const char* name);  // name must outlive the trace (a literal)
+    ~TraceZone();
+
+    TraceZone(const TraceZone&) = delete;
+    TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+    const char* name;
+    std::uint64_t start;
+};
+
+class Trace {
+public:
+    static void SetThreadName(const char* name);
+    static bool Dump(const char* path);  // Safe to call while other threads keep recording
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Trace::SetThreadName(name)
+#define TRACE_DUMP(path) Trace::Dump(path)
+
+#else
+
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_DUMP(path) ((void)0)
+
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,331 @@
+// Neuroevolution trainer: evolves a population of NeuralPolicy networks on
+// seeded headless games and checkpoints it after every generation.
+//
+//   snake_train [--population N] [--generations G] [--games K] [--threads T]
+//               [--seed S] [--arena A] [--obstacles O] [--max-ticks M]
+//               [--starve M] [--sigma X] [--checkpoint FILE] [--resume FILE]
+//
+// Every genome plays the same K games per generation, fresh ones each
+// generation, so fitness compares like with like without overfitting one
+// layout. Blocks of genomes run in lockstep on the pool: one feature
+// extraction per live game, then one batched forward pass for the block.
+// Games and breeding draw only from --seed and the generation number, so
+// a run gives the same population for any --threads, and --resume carries
+// on exactly where the checkpoint left off. Load the result into the game
+// with snake_game --policy FILE.
+
+#include "simulation.h"
+#include "neural_policy.h"
+#include "task_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+struct TrainOptions {
+    int population = 256;
+    int generations = 50;
+    int games = 4;
+    unsigned int threads = 0;
+    std::uint64_t seed = 1;
+    int arenaSize = 20;
+    int obstacles = 15;
+    unsigned long long maxTicks = 5000;
+    unsigned long long starveTicks = 300;  // A game ends after this long without an apple; 0 = never
+    float sigma = 0.3f;                    // Mutation size
+    std::string checkpointPath = "population.bin";
+    std::string resumePath;
+};
+
+// Genomes per pool task, a few vectors' worth of lanes
+static const int lanesPerTask = 32;
+
+// Share of weights a mutation touches
+static const std::uint32_t mutationOdds = 10;  // One in this many
+
+// Fitness per tick survived; well under an apple even for a snake that starves
+static const double survivalBonus = 0.001;
+
+struct Evaluation {
+    double fitness;
+    double apples;
+    unsigned long long ticks;
+};
+
+// Uniform in [0, 1)
+static double NextUnit(RandomStream& random) {
+    return (random.Next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Box-Muller; one of the pair is dropped to keep the draws stateless
+static float NextGaussian(RandomStream& random) {
+    const double u = 1.0 - NextUnit(random);
+    const double v = NextUnit(random);
+    return static_cast<float>(std::sqrt(-2.0 * std::log(u)) * std::cos(6.283185307179586 * v));
+}
+
+static void EvaluateBlock(const TrainOptions& options, const std::vector<float>& weights,
+                          const std::vector<RandomStream>& gameStreams, std::uint64_t firstStream,
+                          int first, int count, std::vector<Evaluation>& results) {
+    TRACE_ZONE("EvaluateBlock");
+
+    SimConfig config;
+    config.arenaSize = options.arenaSize;
+    config.maxObstacles = options.obstacles;
+
+    PolicyBatch batch(count);
+    for (int lane = 0; lane < count; ++lane) {
+        batch.SetGenome(lane, &weights[static_cast<std::size_t>(first + lane) * policyWeightCount]);
+        results[first + lane] = Evaluation{0.0, 0.0, 0};
+    }
+
+    std::vector<Simulation> sims;
+    sims.reserve(count);
+    for (int lane = 0; lane < count; ++lane) {
+        sims.emplace_back(config);
+    }
+
+    FeatureExtractor extractor;
+    std::vector<float> features(policyInputs * batch.GetStride(), 0.0f);
+    std::vector<int> actions(batch.GetStride(), 1);
+    std::vector<unsigned long long> lastApple(count);
+    std::vector<char> playing(count);
+
+    for (int game = 0; game < options.games; ++game) {
+        for (int lane = 0; lane < count; ++lane) {
+            sims[lane].Seed(options.seed, firstStream + game, gameStreams[game]);
+            sims[lane].Initialize();
+            lastApple[lane] = 0;
+            playing[lane] = 1;
+        }
+
+        // Lockstep: finished games keep their lane but are skipped
+        int live = count;
+        while (live > 0) {
+            for (int lane = 0; lane < count; ++lane) {
+                if (playing[lane]) {
+                    extractor.Extract(sims[lane], &features[lane], batch.GetStride());
+                }
+            }
+            batch.Forward(features.data(), actions.data());
+
+            for (int lane = 0; lane < count; ++lane) {
+                if (!playing[lane]) continue;
+
+                Simulation& sim = sims[lane];
+                if (sim.Step(PolicyActionDirection(sim.GetDirection(), actions[lane])) == StepResult::ATE_APPLE) {
+                    lastApple[lane] = sim.GetTick();
+                }
+                if (sim.IsGameOver() || sim.GetTick() >= options.maxTicks ||
+                    (options.starveTicks > 0 && sim.GetTick() - lastApple[lane] >= options.starveTicks)) {
+                    Evaluation& result = results[first + lane];
+                    const double apples = sim.GetScore() / 10.0;
+                    result.apples += apples;
+                    result.fitness += apples + survivalBonus * sim.GetTick();
+                    result.ticks += sim.GetTick();
+                    playing[lane] = 0;
+                    live--;
+                }
+            }
+        }
+    }
+
+    for (int lane = 0; lane < count; ++lane) {
+        results[first + lane].fitness /= options.games;
+        results[first + lane].apples /= options.games;
+    }
+}
+
+// Picks the fittest of three at random
+static int Tournament(const std::vector<float>& fitness, RandomStream& random) {
+    int best = static_cast<int>(random.NextBelow(static_cast<std::uint32_t>(fitness.size())));
+    for (int round = 1; round < 3; ++round) {
+        int challenger = static_cast<int>(random.NextBelow(static_cast<std::uint32_t>(fitness.size())));
+        if (fitness[challenger] > fitness[best]) {
+            best = challenger;
+        }
+    }
+    return best;
+}
+
+// Next generation from one sorted best first: the top twentieth unchanged,
+// the rest uniform crossovers of tournament winners, lightly mutated
+static void Breed(const TrainOptions& options, PolicyPopulation& population, RandomStream& random) {
+    const int count = static_cast<int>(population.fitness.size());
+    const int elites = std::max(1, count / 20);
+    std::vector<float> next(population.weights.size());
+
+    std::copy(population.weights.begin(), population.weights.begin() + static_cast<std::size_t>(elites) * policyWeightCount,
+              next.begin());
+    for (int child = elites; child < count; ++child) {
+        const float* mother = &population.weights[static_cast<std::size_t>(Tournament(population.fitness, random)) * policyWeightCount];
+        const float* father = &population.weights[static_cast<std::size_t>(Tournament(population.fitness, random)) * policyWeightCount];
+        float* genome = &next[static_cast<std::size_t>(child) * policyWeightCount];
+
+        for (int i = 0; i < policyWeightCount; ++i) {
+            genome[i] = (random.Next() >> 63) ? mother[i] : father[i];
+            if (random.NextBelow(mutationOdds) == 0) {
+                genome[i] += options.sigma * NextGaussian(random);
+            }
+        }
+    }
+
+    population.weights.swap(next);
+}
+
+static bool ParseOptions(int argc, char** argv, TrainOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+
+        if (std::strcmp(arg, "--population") == 0) options.population = std::atoi(value);
+        else if (std::strcmp(arg, "--generations") == 0) options.generations = std::atoi(value);
+        else if (std::strcmp(arg, "--games") == 0) options.games = std::atoi(value);
+        else if (std::strcmp(arg, "--threads") == 0) options.threads = static_cast<unsigned int>(std::atoi(value));
+        else if (std::strcmp(arg, "--seed") == 0) options.seed = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--arena") == 0) options.arenaSize = std::atoi(value);
+        else if (std::strcmp(arg, "--obstacles") == 0) options.obstacles = std::atoi(value);
+        else if (std::strcmp(arg, "--max-ticks") == 0) options.maxTicks = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--starve") == 0) options.starveTicks = std::strtoull(value, nullptr, 10);
+        else if (std::strcmp(arg, "--sigma") == 0) options.sigma = static_cast<float>(std::atof(value));
+        else if (std::strcmp(arg, "--checkpoint") == 0) options.checkpointPath = value;
+        else if (std::strcmp(arg, "--resume") == 0) options.resumePath = value;
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        ++i;
+    }
+
+    return options.population > 1 && options.generations > 0 && options.games > 0 && options.arenaSize > 0;
+}
+
+int main(int argc, char** argv) {
+    TrainOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: snake_train [--population N] [--generations G] [--games K] [--threads T] [--seed S] [--arena A] [--obstacles O] [--max-ticks M] [--starve M] [--sigma X] [--checkpoint FILE] [--resume FILE]\n");
+        return 1;
+    }
+
+    TRACE_THREAD_NAME("Main");
+
+    // A resumed run keeps the checkpoint's seed and size; an evaluated
+    // population breeds before its first generation here
+    PolicyPopulation population;
+    bool evaluated = false;
+    if (!options.resumePath.empty()) {
+        if (!LoadPolicyPopulation(options.resumePath, population)) {
+            std::fprintf(stderr, "cannot resume from %s\n", options.resumePath.c_str());
+            return 1;
+        }
+        options.seed = population.seed;
+        options.population = static_cast<int>(population.fitness.size());
+        evaluated = true;
+        std::printf("resumed %d genomes after generation %llu\n", options.population,
+                    static_cast<unsigned long long>(population.generation));
+    } else {
+        population.seed = options.seed;
+        population.fitness.assign(options.population, 0.0f);
+        population.weights.resize(static_cast<std::size_t>(options.population) * policyWeightCount);
+
+        RandomStream random = RandomStream::ForStream(~options.seed, 0);
+        for (float& weight : population.weights) {
+            weight = 0.5f * NextGaussian(random);
+        }
+    }
+
+    std::vector<Evaluation> results(options.population);
+    std::vector<int> order(options.population);
+    std::vector<RandomStream> gameStreams(options.games);
+    PolicyPopulation sorted;
+
+    TaskPool pool(options.threads);
+    const std::uint64_t firstGeneration = population.generation;
+    unsigned long long totalTicks = 0;
+    double totalSeconds = 0.0;
+
+    for (std::uint64_t generation = firstGeneration; generation < firstGeneration + options.generations; ++generation) {
+        TRACE_ZONE("Generation");
+        auto start = std::chrono::steady_clock::now();
+
+        // Breeding draws from stream `generation` of the inverted seed
+        if (evaluated) {
+            RandomStream random = RandomStream::ForStream(~options.seed, generation);
+            Breed(options, population, random);
+        }
+
+        // Games of this generation are streams generation * games onward
+        const std::uint64_t firstStream = generation * options.games;
+        RandomStream stream = RandomStream::ForStream(options.seed, firstStream);
+        for (auto& gameStream : gameStreams) {
+            gameStream = stream;
+            stream.Jump();
+        }
+
+        for (int first = 0; first < options.population; first += lanesPerTask) {
+            int count = std::min(lanesPerTask, options.population - first);
+            pool.Submit([&options, &population, &gameStreams, &results, firstStream, first, count]() {
+                EvaluateBlock(options, population.weights, gameStreams, firstStream, first, count, results);
+            });
+        }
+        pool.Wait();
+
+        // Best first, so genome 0 of every checkpoint is the one to play
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&results](int a, int b) {
+            return results[a].fitness > results[b].fitness;
+        });
+
+        sorted.generation = generation + 1;
+        sorted.seed = options.seed;
+        sorted.fitness.resize(options.population);
+        sorted.weights.resize(population.weights.size());
+        unsigned long long ticks = 0;
+        double fitnessSum = 0.0;
+        for (int rank = 0; rank < options.population; ++rank) {
+            const Evaluation& result = results[order[rank]];
+            sorted.fitness[rank] = static_cast<float>(result.fitness);
+            std::copy_n(&population.weights[static_cast<std::size_t>(order[rank]) * policyWeightCount], policyWeightCount,
+                        &sorted.weights[static_cast<std::size_t>(rank) * policyWeightCount]);
+            ticks += result.ticks;
+            fitnessSum += result.fitness;
+        }
+        std::swap(population, sorted);
+        evaluated = true;
+
+        if (!SavePolicyPopulation(options.checkpointPath, population)) {
+            std::fprintf(stderr, "cannot write %s\n", options.checkpointPath.c_str());
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        totalTicks += ticks;
+        totalSeconds += seconds;
+        std::printf("gen %4llu  best %7.2f  mean %7.2f  best apples %6.2f  %.2f s  %.0f ticks/s\n",
+                    static_cast<unsigned long long>(generation + 1), population.fitness[0],
+                    fitnessSum / options.population, results[order[0]].apples, seconds, ticks / seconds);
+        std::fflush(stdout);
+    }
+
+    const double games = static_cast<double>(options.generations) * options.population * options.games;
+    std::printf("%d generations of %d x %d games on %u threads in %.3f s\n", options.generations,
+                options.population, options.games, pool.GetThreadCount(), totalSeconds);
+    std::printf("games/s  %.0f\n", games / totalSeconds);
+    std::printf("ticks/s  %.0f\n", totalTicks / totalSeconds);
+    std::printf("best genome written to %s\n", options.checkpointPath.c_str());
+
+    // Only written in SNAKE_TRACING builds
+    TRACE_DUMP("trace.json");
+
+    return 0;
+}
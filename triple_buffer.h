@@ -0,0 +1,45 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Hands the latest of a stream of values from one writer thread to one
+// reader thread without locks or waiting. Of the three slots the writer
+// owns one, the reader owns one, and the third is the hand-off: Publish
+// swaps the freshly written slot in, Read swaps it out when it is newer
+// than what the reader has. The reader may skip values but always sees a
+// complete one, and a slow side never holds up the other.
+template <typename Value>
+class TripleBuffer {
+public:
+    TripleBuffer() : back(0), middle(1), front(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer: fill this slot completely (it holds an older value), then Publish
+    Value& Back() { return slots[back]; }
+    void Publish() {
+        back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Reader: the latest published value, or the one from the last Read if
+    // nothing new came in. Stays valid until the next Read.
+    const Value& Read() {
+        if (middle.load(std::memory_order_relaxed) & freshBit) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        }
+        return slots[front];
+    }
+
+private:
+    static const unsigned int indexMask = 3;
+    static const unsigned int freshBit = 4;  // Set while the hand-off slot is unread
+
+    Value slots[3];
+    unsigned int back;                 // Writer only
+    std::atomic<unsigned int> middle;  // Hand-off slot index plus freshBit
+    unsigned int front;                // Reader only
+};
+
+#endif // TRIPLE_BUFFER_H
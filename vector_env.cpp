@@ -0,0 +1,205 @@
+#include "vector_env.h"
+#include "task_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+
+// Envs handed to one pool task; small enough for idle workers to steal
+static const int envsPerTask = 16;
+
+VectorEnv::VectorEnv(const VectorEnvConfig& config) :
+    config(config),
+    gridWidth(2 * config.sim.arenaSize + 1),
+    planeSize(static_cast<std::size_t>(gridWidth) * gridWidth),
+    episodesPerEnv(config.envCount, 0),
+    lastObservations(nullptr),
+    steps(0) {
+    // The obstacle channel comes from the dense grid
+    this->config.sim.chunked = false;
+
+    // One jump per env, walked in order
+    envs.reserve(config.envCount);
+    RandomStream stream(config.seed);
+    for (int i = 0; i < config.envCount; ++i) {
+        envs.push_back(Env{Simulation(this->config.sim), Cell{0, 0}, Cell{0, 0}, Cell{0, 0}, false, 0});
+        envs.back().sim.Seed(config.seed, static_cast<std::uint64_t>(i), stream);
+        StartEpisode(envs.back());
+        stream.Jump();
+    }
+}
+
+void VectorEnv::Reset(std::uint8_t* observations) {
+    TRACE_ZONE("VectorEnv::Reset");
+
+    for (int i = 0; i < GetEnvCount(); ++i) {
+        StartEpisode(envs[i]);
+        WriteObservation(i, observations + i * GetObservationSize());
+    }
+    lastObservations = observations;
+}
+
+void VectorEnv::Step(const int* actions, std::uint8_t* observations, float* rewards, std::uint8_t* dones,
+                     TaskPool* pool) {
+    TRACE_ZONE("VectorEnv::Step");
+
+    const bool redraw = observations != lastObservations;
+    const int count = GetEnvCount();
+    if (pool) {
+        for (int first = 0; first < count; first += envsPerTask) {
+            int last = std::min(first + envsPerTask, count);
+            pool->Submit([this, first, last, actions, observations, rewards, dones, redraw]() {
+                StepRange(first, last, actions, observations, rewards, dones, redraw);
+            });
+        }
+        pool->Wait();
+    } else {
+        StepRange(0, count, actions, observations, rewards, dones, redraw);
+    }
+
+    lastObservations = observations;
+    steps += count;
+}
+
+void VectorEnv::StepRange(int first, int last, const int* actions, std::uint8_t* observations,
+                          float* rewards, std::uint8_t* dones, bool redraw) {
+    for (int i = first; i < last; ++i) {
+        Env& env = envs[i];
+        Simulation& sim = env.sim;
+        std::uint8_t* out = observations + i * GetObservationSize();
+
+        if (actions[i] >= 0 && actions[i] < 4) {
+            sim.SetDirection(static_cast<Direction>(actions[i]));
+        }
+        const StepResult result = sim.Step();
+        if (result == StepResult::ATE_APPLE) {
+            env.lastApple = sim.GetTick();
+        }
+
+        rewards[i] = result == StepResult::ATE_APPLE ? config.appleReward :
+                     result == StepResult::DIED ? config.deathReward : 0.0f;
+        dones[i] = sim.IsGameOver() ? envTerminated :
+                   sim.GetTick() >= config.maxTicks ||
+                   (config.starveTicks > 0 && sim.GetTick() - env.lastApple >= config.starveTicks) ? envTruncated :
+                   envRunning;
+
+        if (dones[i] != envRunning) {
+            episodesPerEnv[i]++;
+            StartEpisode(env);
+            WriteObservation(i, out);
+            continue;
+        }
+        if (redraw) {
+            WriteObservation(i, out);
+            Remember(env);
+            continue;
+        }
+
+        // One tick moves the head one cell and the tail at most one, so the
+        // difference to the last output is a handful of bytes. The tail is
+        // cleared first: the head may have moved into the cell it just left.
+        std::uint8_t* body = out + observationBody * planeSize;
+        std::uint8_t* head = out + observationHead * planeSize;
+        std::uint8_t* apple = out + observationApple * planeSize;
+
+        const Cell newTail = sim.GetBody().Tail();
+        if (newTail != env.tail) {
+            body[CellOffset(env.tail)] = 0;
+        }
+        const Cell newHead = sim.GetHead();
+        head[CellOffset(env.head)] = 0;
+        head[CellOffset(newHead)] = 1;
+        body[CellOffset(newHead)] = 1;
+
+        if (env.hasApple && (!sim.HasApple() || sim.GetApple() != env.apple)) {
+            apple[CellOffset(env.apple)] = 0;
+        }
+        if (sim.HasApple()) {
+            apple[CellOffset(sim.GetApple())] = 1;
+        }
+
+        Remember(env);
+    }
+}
+
+void VectorEnv::StartEpisode(Env& env) {
+    // The simulation's own stream carries on, so every episode gets a new
+    // layout and the env still replays the same from its seed
+    env.sim.Initialize();
+    env.lastApple = 0;
+    Remember(env);
+}
+
+void VectorEnv::Remember(Env& env) {
+    env.head = env.sim.GetHead();
+    env.tail = env.sim.GetBody().Tail();
+    env.apple = env.sim.GetApple();
+    env.hasApple = env.sim.HasApple();
+}
+
+void VectorEnv::WriteObservation(int index, std::uint8_t* out) const {
+    const Simulation& sim = envs[index].sim;
+    std::memset(out, 0, GetObservationSize());
+
+    std::uint8_t* body = out + observationBody * planeSize;
+    for (const Cell& cell : sim.GetBody()) {
+        body[CellOffset(cell)] = 1;
+    }
+    out[observationHead * planeSize + CellOffset(sim.GetHead())] = 1;
+    if (sim.HasApple()) {
+        out[observationApple * planeSize + CellOffset(sim.GetApple())] = 1;
+    }
+
+    const OccupancyGrid& grid = sim.GetGrid();
+    std::uint8_t* obstacle = out + observationObstacle * planeSize;
+    const int arenaSize = config.sim.arenaSize;
+    for (int z = -arenaSize; z <= arenaSize; ++z) {
+        for (int x = -arenaSize; x <= arenaSize; ++x) {
+            Cell cell{x, z};
+            obstacle[CellOffset(cell)] = grid.IsStatic(cell) ? 1 : 0;
+        }
+    }
+}
+
+bool VectorEnv::LoadState(int index, const char* data, std::size_t size, std::uint8_t* observations) {
+    // A finished game would never be stepped into its auto-reset
+    Env& env = envs[index];
+    if (!env.sim.LoadState(data, size, false)) return false;
+
+    env.lastApple = env.sim.GetTick();
+    WriteObservation(index, observations + index * GetObservationSize());
+    Remember(env);
+    return true;
+}
+
+std::size_t VectorEnv::CellOffset(const Cell& cell) const {
+    const int arenaSize = config.sim.arenaSize;
+    return static_cast<std::size_t>(cell.z + arenaSize) * gridWidth + (cell.x + arenaSize);
+}
+
+int VectorEnv::GetEnvCount() const {
+    return static_cast<int>(envs.size());
+}
+
+int VectorEnv::GetGridWidth() const {
+    return gridWidth;
+}
+
+std::size_t VectorEnv::GetObservationSize() const {
+    return observationChannels * planeSize;
+}
+
+const Simulation& VectorEnv::GetSimulation(int env) const {
+    return envs[env].sim;
+}
+
+unsigned long long VectorEnv::GetStepCount() const {
+    return steps;
+}
+
+unsigned long long VectorEnv::GetEpisodeCount() const {
+    unsigned long long total = 0;
+    for (unsigned long long episodes : episodesPerEnv) {
+        total += episodes;
+    }
+    return total;
+}
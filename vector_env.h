@@ -0,0 +1,111 @@
+#ifndef VECTOR_ENV_H
+#define VECTOR_ENV_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TaskPool;
+
+// Observation channels, each a (2 * arenaSize + 1)^2 grid of 0/1 bytes
+// over the playable cells, row by row from -arenaSize on both axes
+enum ObservationChannel {
+    observationBody = 0,    // Every segment, head included
+    observationHead = 1,
+    observationApple = 2,
+    observationObstacle = 3,
+    observationChannels = 4
+};
+
+// VectorEnv::Step done flags
+static const std::uint8_t envRunning = 0;
+static const std::uint8_t envTerminated = 1;  // Died or cleared the board
+static const std::uint8_t envTruncated = 2;   // Cut off by maxTicks or starveTicks
+
+struct VectorEnvConfig {
+    int envCount = 64;
+    SimConfig sim;                         // Dense arenas only; chunked is ignored
+    std::uint64_t seed = 1;                // Env i plays stream i of the seed
+    unsigned long long maxTicks = 10000;   // Per episode
+    unsigned long long starveTicks = 0;    // Ticks without an apple before truncating, 0 = never
+    float appleReward = 1.0f;
+    float deathReward = -1.0f;
+};
+
+// A batch of independent games stepped together for reinforcement
+// learning. Every call writes into buffers the caller owns, laid out
+// contiguously per env, and allocates nothing:
+//
+//   observations  envCount * GetObservationSize() bytes, [env][channel][z][x]
+//   rewards       envCount floats
+//   dones         envCount bytes, one of the env* flags above
+//
+// A finished game restarts on a new layout in the same call, so its
+// reward and done flag describe the last step of the old episode while
+// its observation is already the first of the new one.
+//
+// Observations are kept up to date from each step's changes (new head,
+// vacated tail, moved apple) instead of being redrawn from the body, so
+// a step costs the same for any snake length. That needs the buffer to
+// hold the previous step's output: pass the same one every time. Any
+// other pointer is detected and gets a full redraw instead.
+class VectorEnv {
+public:
+    explicit VectorEnv(const VectorEnvConfig& config);
+
+    VectorEnv(const VectorEnv&) = delete;
+    VectorEnv& operator=(const VectorEnv&) = delete;
+
+    // New episodes everywhere. Envs start playing on construction, so this
+    // is only needed to restart them or to get the first observations.
+    void Reset(std::uint8_t* observations);
+
+    // actions: envCount Direction values (0 up, 1 down, 2 left, 3 right);
+    // a reversal or anything out of range keeps the current heading.
+    // Spread over the pool in blocks when one is given.
+    void Step(const int* actions, std::uint8_t* observations, float* rewards, std::uint8_t* dones,
+              TaskPool* pool = nullptr);
+
+    // Full redraw of one env, independent of any previous output
+    void WriteObservation(int env, std::uint8_t* out) const;
+
+    // Puts a Simulation::SaveState blob into one env and redraws its part
+    // of observations. The state has to come from this env's layout; a
+    // bad blob, a finished game or a body on walls or obstacles is turned
+    // down, leaving the env as it was.
+    bool LoadState(int env, const char* data, std::size_t size, std::uint8_t* observations);
+
+    int GetEnvCount() const;
+    int GetGridWidth() const;
+    std::size_t GetObservationSize() const;  // Bytes per env
+    const Simulation& GetSimulation(int env) const;
+    unsigned long long GetStepCount() const;
+    unsigned long long GetEpisodeCount() const;  // Finished ones
+
+private:
+    struct Env {
+        Simulation sim;
+        Cell head;       // As last written to the observation
+        Cell tail;
+        Cell apple;
+        bool hasApple;
+        unsigned long long lastApple;  // Tick of the latest apple, for starveTicks
+    };
+
+    void StepRange(int first, int last, const int* actions, std::uint8_t* observations,
+                   float* rewards, std::uint8_t* dones, bool redraw);
+    void StartEpisode(Env& env);
+    void Remember(Env& env);
+    std::size_t CellOffset(const Cell& cell) const;
+
+    VectorEnvConfig config;
+    int gridWidth;
+    std::size_t planeSize;  // Cells per channel
+    std::vector<Env> envs;
+    std::vector<unsigned long long> episodesPerEnv;
+    const std::uint8_t* lastObservations;  // Buffer the incremental updates are valid for
+    unsigned long long steps;
+};
+
+#endif // VECTOR_ENV_H
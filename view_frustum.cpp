@@ -0,0 +1,89 @@
+#include "view_frustum.h"
+#include <cmath>
+#include "raymath.h"
+#include "rlgl.h"  // Near and far clip distances BeginMode3D uses
+
+// Smallest projected diameters, in pixels, that still get level 0 and level 1
+static const float lodPixels[ViewFrustum::lodCount - 1] = { 24.0f, 8.0f };
+
+ViewFrustum::ViewFrustum() :
+    position(Vector3{0.0f, 0.0f, 0.0f}),
+    pixelsPerUnit(1.0f) {
+    for (auto& plane : planes) {
+        plane = Vector4{0.0f, 0.0f, 0.0f, 0.0f};
+    }
+}
+
+void ViewFrustum::Update(const Camera3D& camera, float aspect, float screenHeight) {
+    position = camera.position;
+
+    Vector3 forward = Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+    Vector3 right = Vector3Normalize(Vector3CrossProduct(forward, camera.up));
+    Vector3 up = Vector3CrossProduct(right, forward);
+
+    float tanHalfHeight = tanf(camera.fovy * 0.5f * DEG2RAD);
+    float tanHalfWidth = tanHalfHeight * aspect;
+    pixelsPerUnit = screenHeight / (2.0f * tanHalfHeight);
+
+    // Side planes pass through the camera; inside means in front of the edge
+    SetPlane(0, Vector3Subtract(Vector3Scale(forward, tanHalfWidth), right), 0.0f);   // Right
+    SetPlane(1, Vector3Add(Vector3Scale(forward, tanHalfWidth), right), 0.0f);        // Left
+    SetPlane(2, Vector3Subtract(Vector3Scale(forward, tanHalfHeight), up), 0.0f);     // Top
+    SetPlane(3, Vector3Add(Vector3Scale(forward, tanHalfHeight), up), 0.0f);          // Bottom
+    SetPlane(4, forward, -static_cast<float>(RL_CULL_DISTANCE_NEAR));                  // Near
+    SetPlane(5, Vector3Scale(forward, -1.0f), static_cast<float>(RL_CULL_DISTANCE_FAR));  // Far
+}
+
+void ViewFrustum::SetPlane(int index, Vector3 normal, float offset) {
+    // offset is measured from the camera along the normal
+    normal = Vector3Normalize(normal);
+    planes[index] = Vector4{normal.x, normal.y, normal.z, offset - Vector3DotProduct(normal, position)};
+}
+
+bool ViewFrustum::SphereVisible(Vector3 center, float radius) const {
+    for (const auto& plane : planes) {
+        if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ViewFrustum::BoxVisible(const BoundingBox& box) const {
+    for (const auto& plane : planes) {
+        // Only the corner furthest along the normal needs testing
+        float x = plane.x >= 0.0f ? box.max.x : box.min.x;
+        float y = plane.y >= 0.0f ? box.max.y : box.min.y;
+        float z = plane.z >= 0.0f ? box.max.z : box.min.z;
+        if (plane.x * x + plane.y * y + plane.z * z + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int ViewFrustum::SelectLod(float distance, float radius) const {
+    float pixels = 2.0f * radius * pixelsPerUnit / fmaxf(distance, 1e-3f);
+
+    int lod = 0;
+    while (lod < lodCount - 1 && pixels < lodPixels[lod]) {
+        lod++;
+    }
+    return lod;
+}
+
+void ViewFrustum::LodDistancesSquared(float radius, float* distancesSquared) const {
+    for (int i = 0; i < lodCount - 1; ++i) {
+        float distance = 2.0f * radius * pixelsPerUnit / lodPixels[i];
+        distancesSquared[i] = distance * distance;
+    }
+}
+
+float ViewFrustum::DistanceTo(const BoundingBox& box) const {
+    Vector3 closest = Vector3{
+        Clamp(position.x, box.min.x, box.max.x),
+        Clamp(position.y, box.min.y, box.max.y),
+        Clamp(position.z, box.min.z, box.max.z)
+    };
+    return Vector3Distance(position, closest);
+}
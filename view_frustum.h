@@ -0,0 +1,41 @@
+#ifndef VIEW_FRUSTUM_H
+#define VIEW_FRUSTUM_H
+
+#include "raylib.h"
+
+// The camera's view volume for one frame, used to skip whatever is off
+// screen and to pick a mesh detail level from how big things look. Built
+// straight from the camera vectors, so it matches BeginMode3D for the
+// perspective cameras the game uses.
+class ViewFrustum {
+public:
+    // Detail levels of generated meshes: 0 is full detail
+    static const int lodCount = 3;
+
+    ViewFrustum();
+
+    void Update(const Camera3D& camera, float aspect, float screenHeight);  // Once per frame
+
+    bool SphereVisible(Vector3 center, float radius) const;
+    bool BoxVisible(const BoundingBox& box) const;
+
+    // Level for something of this radius at this camera distance, from its projected diameter
+    int SelectLod(float distance, float radius) const;
+    // Squared camera distances at which a sphere of this radius drops to
+    // level 1 and level 2, so per-instance loops can skip the square root
+    void LodDistancesSquared(float radius, float* distancesSquared) const;
+
+    float DistanceTo(const BoundingBox& box) const;  // 0 when the camera is inside
+    Vector3 GetPosition() const { return position; }
+
+private:
+    void SetPlane(int index, Vector3 normal, float offset);
+
+    // Inward normal in xyz and offset in w: a point p is inside when
+    // Dot(normal, p) + offset >= 0 for all six planes
+    Vector4 planes[6];
+    Vector3 position;
+    float pixelsPerUnit;  // Projected size of one unit at distance one
+};
+
+#endif // VIEW_FRUSTUM_H